@@ -28,6 +28,10 @@ The manual and changelog are in the header file "lodepng.h"
 Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for C.
 */
 
+#if defined(LODEPNG_COMPILE_PROFILING) && !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L /*for clock_gettime, also with -ansi*/
+#endif
+
 #include "lodepng.h"
 
 #include <stdio.h>
@@ -37,6 +41,17 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include <fstream>
 #endif /*LODEPNG_COMPILE_CPP*/
 
+#ifdef LODEPNG_COMPILE_PROFILING
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#endif /*LODEPNG_COMPILE_PROFILING*/
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1310) /*Visual Studio: A few warning types are not desired here.*/
 #pragma warning( disable : 4244 ) /*implicit conversions: not warned by gcc -Wall -Wextra and requires too much casts*/
 #pragma warning( disable : 4996 ) /*VS does not like fopen, but fopen_s is not standard C so unusable here*/
@@ -1978,6 +1993,149 @@ static unsigned deflateFixed(ucvector* out, size_t* bp, Hash* hash,
   return error;
 }
 
+/*reverses the lowest n bits: deflate stores huffman codes starting with their most significant bit*/
+static unsigned reverseBits(unsigned code, unsigned n)
+{
+  unsigned result = 0, i;
+  for(i = 0; i != n; ++i) result |= ((code >> i) & 1u) << (n - 1 - i);
+  return result;
+}
+
+/*the largest hash table of deflateFast, smaller inputs get one of about their size*/
+#define FAST_HASH_BITS 14
+
+/*the 4 bytes at p as one value, and its hash for the table of last positions of deflateFast*/
+#define FAST_WORD(p) ((unsigned)p[0] | ((unsigned)p[1] << 8) | ((unsigned)p[2] << 16) | ((unsigned)p[3] << 24))
+#define FAST_HASH(word, hashbits) (unsigned)((((word) * 2654435761u) & 0xffffffffu) >> (32 - (hashbits)))
+
+/*appends count bits of value to the bit buffer of deflateFast. Writes 4 bytes, but only advances past the whole
+ones, which saves the branches of writing a byte at a time. With at most 7 bits left over and count at most 18, the
+bits fit in 32 bits.*/
+#define FAST_PUT_BITS(value, count)\
+{\
+  bits |= (unsigned long)(value) << numbits;\
+  numbits += (count);\
+  o[0] = (unsigned char)bits;\
+  o[1] = (unsigned char)(bits >> 8);\
+  o[2] = (unsigned char)(bits >> 16);\
+  o[3] = (unsigned char)(bits >> 24);\
+  o += numbits >> 3;\
+  bits >>= numbits & ~7u;\
+  numbits &= 7;\
+}
+
+/*
+The real-time deflate of LodePNGCompressSettings.fast: one block with the fixed huffman code, straight into the
+output buffer. At every position it tries a run of the previous 4 bytes (the previous pixel of RGBA, or zeroes of
+the Up filter), then the last position of the same 4 bytes from a hash table, and otherwise writes the 4 bytes as
+literals.
+*/
+static unsigned deflateFast(ucvector* out, const unsigned char* in, size_t insize)
+{
+  unsigned litcode[288], litlen[288], lencode[259], lenlen[259], distcode[30];
+  unsigned char distindex[512]; /*distance code of distances 1..256, then per 128 up to 32768*/
+  unsigned* table; /*per hash, 1 + the last position its 4 bytes were seen at, 0 if none, and those 4 bytes*/
+  unsigned long bits = 0;
+  unsigned numbits = 0, hashbits = 8;
+  size_t i, start = out->size;
+  unsigned char* o;
+  unsigned s, code;
+
+  /*the fixed huffman code, with the length symbols combined with their extra bits for every match length*/
+  for(s = 0; s != 288; ++s)
+  {
+    if(s < 144) { litcode[s] = reverseBits(0x30 + s, 8); litlen[s] = 8; }
+    else if(s < 256) { litcode[s] = reverseBits(0x190 + s - 144, 9); litlen[s] = 9; }
+    else if(s < 280) { litcode[s] = reverseBits(s - 256, 7); litlen[s] = 7; }
+    else { litcode[s] = reverseBits(0xc0 + s - 280, 8); litlen[s] = 8; }
+  }
+  /*the codes of increasing lengths and distances are found walking along the base tables, not searching them*/
+  for(s = 3, code = 0; s != 259; ++s)
+  {
+    while(code + 1 < 29 && LENGTHBASE[code + 1] <= s) ++code;
+    lencode[s] = litcode[FIRST_LENGTH_CODE_INDEX + code] | ((s - LENGTHBASE[code]) << litlen[FIRST_LENGTH_CODE_INDEX + code]);
+    lenlen[s] = litlen[FIRST_LENGTH_CODE_INDEX + code] + LENGTHEXTRA[code];
+  }
+  for(s = 0; s != 30; ++s) distcode[s] = reverseBits(s, 5);
+  for(s = 0, code = 0; s != 512; ++s)
+  {
+    unsigned distance = s < 256 ? s + 1 : ((s - 256) << 7) + 1;
+    if(s == 256) code = 0;
+    while(code + 1 < 30 && DISTANCEBASE[code + 1] <= distance) ++code;
+    distindex[s] = (unsigned char)code;
+  }
+
+  while(hashbits < FAST_HASH_BITS && ((size_t)1 << hashbits) < insize) ++hashbits;
+  table = (unsigned*)lodepng_malloc(2 * sizeof(unsigned) << hashbits);
+  if(!table) return 83; /*alloc fail*/
+  memset(table, 0, 2 * sizeof(unsigned) << hashbits);
+  /*at most 9 bits per byte, plus the block header, the end code and the 4 bytes FAST_PUT_BITS writes*/
+  if(!ucvector_resize(out, start + insize + insize / 8 + 16))
+  {
+    lodepng_free(table);
+    return 83; /*alloc fail*/
+  }
+  o = out->data + start;
+
+  FAST_PUT_BITS(3, 3); /*BFINAL 1, BTYPE 1*/
+  i = 0;
+  while(i < insize)
+  {
+    size_t length = 0, distance = 0, max = insize - i;
+    if(max > MAX_SUPPORTED_DEFLATE_LENGTH) max = MAX_SUPPORTED_DEFLATE_LENGTH;
+    if(max >= 4)
+    {
+      const unsigned char* p = &in[i];
+      unsigned word = FAST_WORD(p);
+      if(i >= 4 && word == FAST_WORD((p - 4))) distance = 4;
+      else
+      {
+        /*the bytes are kept next to the position, so a miss is found without reading the earlier data*/
+        unsigned* entry = &table[2 * FAST_HASH(word, hashbits)];
+        if(entry[1] == word && entry[0] && i + 1 - entry[0] <= 32768) distance = i + 1 - entry[0];
+        entry[0] = (unsigned)(i + 1);
+        entry[1] = word;
+      }
+      if(distance)
+      {
+        length = 4;
+        while(length < max && p[length] == p[length - distance]) ++length;
+      }
+    }
+
+    if(length)
+    {
+      unsigned index = distindex[distance <= 256 ? distance - 1 : 256 + ((distance - 1) >> 7)];
+      FAST_PUT_BITS(lencode[length], lenlen[length]);
+      FAST_PUT_BITS(distcode[index] | ((distance - DISTANCEBASE[index]) << 5), 5 + DISTANCEEXTRA[index]);
+      i += length;
+    }
+    else if(max >= 4)
+    {
+      /*no match: the 4 bytes as literals, two per write, and no search in between. Costs some compression of
+      unaligned matches but halves the time spent on photographic content*/
+      FAST_PUT_BITS(litcode[in[i]] | (litcode[in[i + 1]] << litlen[in[i]]), litlen[in[i]] + litlen[in[i + 1]]);
+      FAST_PUT_BITS(litcode[in[i + 2]] | (litcode[in[i + 3]] << litlen[in[i + 2]]), litlen[in[i + 2]] + litlen[in[i + 3]]);
+      i += 4;
+    }
+    else
+    {
+      FAST_PUT_BITS(litcode[in[i]], litlen[in[i]]);
+      ++i;
+    }
+  }
+  FAST_PUT_BITS(litcode[256], litlen[256]); /*end code*/
+  if(numbits) ++o; /*the last partial byte was already written*/
+
+  out->size = (size_t)(o - out->data);
+  lodepng_free(table);
+  return 0;
+}
+
+#undef FAST_PUT_BITS
+#undef FAST_WORD
+#undef FAST_HASH
+
 static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t insize,
                                  const LodePNGCompressSettings* settings)
 {
@@ -1987,6 +2145,7 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
   Hash hash;
 
   if(settings->btype > 2) return 61;
+  else if(settings->fast) return deflateFast(out, in, insize);
   else if(settings->btype == 0) return deflateNoCompression(out, in, insize);
   else if(settings->btype == 1) blocksize = insize;
   else /*if(settings->btype == 2)*/
@@ -2012,6 +2171,7 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
 
     if(settings->btype == 1) error = deflateFixed(out, &bp, &hash, in, start, end, settings, final);
     else if(settings->btype == 2) error = deflateDynamic(out, &bp, &hash, in, start, end, settings, final);
+    if(!error && settings->cancel) error = settings->cancel(out->size, settings);
   }
 
   hash_cleanup(&hash);
@@ -2032,20 +2192,6 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
   return error;
 }
 
-static unsigned deflate(unsigned char** out, size_t* outsize,
-                        const unsigned char* in, size_t insize,
-                        const LodePNGCompressSettings* settings)
-{
-  if(settings->custom_deflate)
-  {
-    return settings->custom_deflate(out, outsize, in, insize, settings);
-  }
-  else
-  {
-    return lodepng_deflate(out, outsize, in, insize, settings);
-  }
-}
-
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -2062,6 +2208,16 @@ static unsigned update_adler32(unsigned adler, const unsigned char* data, unsign
     /*at least 5550 sums can be done before the sums overflow, saving a lot of module divisions*/
     unsigned amount = len > 5550 ? 5550 : len;
     len -= amount;
+    /*8 bytes per step: s2 gains 8 times s1, plus every byte times the number of sums of s1 it takes part in. That
+    makes the chain of additions that each wait for the previous one 8 times shorter*/
+    while(amount >= 8)
+    {
+      s2 += 8 * s1 + 8 * data[0] + 7 * data[1] + 6 * data[2] + 5 * data[3]
+                   + 4 * data[4] + 3 * data[5] + 2 * data[6] + data[7];
+      s1 += data[0] + data[1] + data[2] + data[3] + data[4] + data[5] + data[6] + data[7];
+      data += 8;
+      amount -= 8;
+    }
     while(amount > 0)
     {
       s1 += (*data++);
@@ -2081,6 +2237,13 @@ static unsigned adler32(const unsigned char* data, unsigned len)
   return update_adler32(1L, data, len);
 }
 
+#ifdef LODEPNG_COMPILE_PROFILING
+unsigned lodepng_adler32(const unsigned char* data, unsigned len)
+{
+  return adler32(data, len);
+}
+#endif /*LODEPNG_COMPILE_PROFILING*/
+
 /* ////////////////////////////////////////////////////////////////////////// */
 /* / Zlib                                                                   / */
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -2149,16 +2312,11 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsi
 
 #ifdef LODEPNG_COMPILE_ENCODER
 
-unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsigned char* in,
-                               size_t insize, const LodePNGCompressSettings* settings)
+/*appends the zlib stream of in to out. The built-in deflate writes straight into out, without a copy*/
+static unsigned zlib_compressv(ucvector* out, const unsigned char* in, size_t insize,
+                               const LodePNGCompressSettings* settings)
 {
-  /*initially, *out must be NULL and outsize 0, if you just give some random *out
-  that's pointing to a non allocated buffer, this'll crash*/
-  ucvector outv;
-  size_t i;
   unsigned error;
-  unsigned char* deflatedata = 0;
-  size_t deflatesize = 0;
 
   /*zlib data: 1 byte CMF (CM+CINFO), 1 byte FLG, deflate data, 4 byte ADLER32 checksum of the Decompressed data*/
   unsigned CMF = 120; /*0b01111000: CM 8, CINFO 7. With CINFO 7, any window size up to 32768 can be used.*/
@@ -2168,21 +2326,36 @@ unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsig
   unsigned FCHECK = 31 - CMFFLG % 31;
   CMFFLG += FCHECK;
 
-  /*ucvector-controlled version of the output buffer, for dynamic array*/
-  ucvector_init_buffer(&outv, *out, *outsize);
-
-  ucvector_push_back(&outv, (unsigned char)(CMFFLG >> 8));
-  ucvector_push_back(&outv, (unsigned char)(CMFFLG & 255));
-
-  error = deflate(&deflatedata, &deflatesize, in, insize, settings);
+  ucvector_push_back(out, (unsigned char)(CMFFLG >> 8));
+  ucvector_push_back(out, (unsigned char)(CMFFLG & 255));
 
-  if(!error)
+  if(settings->custom_deflate)
   {
-    unsigned ADLER32 = adler32(in, (unsigned)insize);
-    for(i = 0; i != deflatesize; ++i) ucvector_push_back(&outv, deflatedata[i]);
-    lodepng_free(deflatedata);
-    lodepng_add32bitInt(&outv, ADLER32);
+    unsigned char* deflatedata = 0;
+    size_t deflatesize = 0;
+    size_t pos = out->size;
+    error = settings->custom_deflate(&deflatedata, &deflatesize, in, insize, settings);
+    if(!error && !ucvector_resize(out, pos + deflatesize)) error = 83; /*alloc fail*/
+    if(!error) memcpy(out->data + pos, deflatedata, deflatesize);
+    lodepng_free(deflatedata); /*also the partial output of a failed or cancelled deflate*/
   }
+  else error = lodepng_deflatev(out, in, insize, settings);
+
+  if(!error) lodepng_add32bitInt(out, adler32(in, (unsigned)insize));
+  return error;
+}
+
+unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsigned char* in,
+                               size_t insize, const LodePNGCompressSettings* settings)
+{
+  /*initially, *out must be NULL and outsize 0, if you just give some random *out
+  that's pointing to a non allocated buffer, this'll crash*/
+  ucvector outv;
+  unsigned error;
+
+  /*ucvector-controlled version of the output buffer, for dynamic array*/
+  ucvector_init_buffer(&outv, *out, *outsize);
+  error = zlib_compressv(&outv, in, insize, settings);
 
   *out = outv.data;
   *outsize = outv.size;
@@ -2243,13 +2416,15 @@ void lodepng_compress_settings_init(LodePNGCompressSettings* settings)
   settings->minmatch = 3;
   settings->nicematch = 128;
   settings->lazymatching = 1;
+  settings->fast = 0;
 
   settings->custom_zlib = 0;
   settings->custom_deflate = 0;
+  settings->cancel = 0;
   settings->custom_context = 0;
 }
 
-const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0};
+const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0, 0, 0};
 
 
 #endif /*LODEPNG_COMPILE_ENCODER*/
@@ -2319,12 +2494,262 @@ static unsigned lodepng_crc32_table[256] = {
   3009837614u, 3294710456u, 1567103746u,  711928724u, 3020668471u, 3272380065u, 1510334235u,  755167117u
 };
 
+/*the table above advanced by 1 to 7 more bytes, to process 8 bytes per step (slicing-by-8)*/
+static unsigned lodepng_crc32_slices[7][256] = {
+  {
+             0u,  421212481u,  842424962u,  724390851u, 1684849924u, 2105013317u, 1448781702u, 1329698503u,
+    3369699848u, 3519200073u, 4210026634u, 3824474571u, 2897563404u, 3048111693u, 2659397006u, 2274893007u,
+    1254232657u, 1406739216u, 2029285587u, 1643069842u,  783210325u,  934667796u,  479770071u,   92505238u,
+    2182846553u, 2600511768u, 2955803355u, 2838940570u, 3866582365u, 4285295644u, 3561045983u, 3445231262u,
+    2508465314u, 2359236067u, 2813478432u, 3198777185u, 4058571174u, 3908292839u, 3286139684u, 3670389349u,
+    1566420650u, 1145479147u, 1869335592u, 1987116393u,  959540142u,  539646703u,  185010476u,  303839341u,
+    3745920755u, 3327985586u, 3983561841u, 4100678960u, 3140154359u, 2721170102u, 2300350837u, 2416418868u,
+     396344571u,  243568058u,  631889529u, 1018359608u, 1945336319u, 1793607870u, 1103436669u, 1490954812u,
+    4034481925u, 3915546180u, 3259968903u, 3679722694u, 2484439553u, 2366552896u, 2787371139u, 3208174018u,
+     950060301u,  565965900u,  177645455u,  328046286u, 1556873225u, 1171730760u, 1861902987u, 2011255754u,
+    3132841300u, 2745199637u, 2290958294u, 2442530455u, 3738671184u, 3352078609u, 3974232786u, 4126854035u,
+    1919080284u, 1803150877u, 1079293406u, 1498383519u,  370020952u,  253043481u,  607678682u, 1025720731u,
+    1711106983u, 2095471334u, 1472923941u, 1322268772u,   26324643u,  411738082u,  866634785u,  717028704u,
+    2904875439u, 3024081134u, 2668790573u, 2248782444u, 3376948395u, 3495106026u, 4219356713u, 3798300520u,
+     792689142u,  908347575u,  487136116u,   68299317u, 1263779058u, 1380486579u, 2036719216u, 1618931505u,
+    3890672638u, 4278043327u, 3587215740u, 3435896893u, 2206873338u, 2593195963u, 2981909624u, 2829542713u,
+     998479947u,  580430090u,  162921161u,  279890824u, 1609522511u, 1190423566u, 1842954189u, 1958874764u,
+    4082766403u, 3930137346u, 3245109441u, 3631694208u, 2536953671u, 2385372678u, 2768287173u, 3155920004u,
+    1900120602u, 1750776667u, 1131931800u, 1517083097u,  355290910u,  204897887u,  656092572u, 1040194781u,
+    3113746450u, 2692952403u, 2343461520u, 2461357009u, 3723805974u, 3304059991u, 4022511508u, 4141455061u,
+    2919742697u, 3072101800u, 2620513899u, 2234183466u, 3396041197u, 3547351212u, 4166851439u, 3779471918u,
+    1725839073u, 2143618976u, 1424512099u, 1307796770u,   45282277u,  464110244u,  813994343u,  698327078u,
+    3838160568u, 4259225593u, 3606301754u, 3488152955u, 2158586812u, 2578602749u, 2996767038u, 2877569151u,
+     740041904u,  889656817u,  506086962u,  120682355u, 1215357364u, 1366020341u, 2051441462u, 1667084919u,
+    3422213966u, 3538019855u, 4190942668u, 3772220557u, 2945847882u, 3062702859u, 2644537544u, 2226864521u,
+      52649286u,  439905287u,  823476164u,  672009861u, 1733269570u, 2119477507u, 1434057408u, 1281543041u,
+    2167981343u, 2552493150u, 3004082077u, 2853541596u, 3847487515u, 4233048410u, 3613549209u, 3464057816u,
+    1239502615u, 1358593622u, 2077699477u, 1657543892u,  764250643u,  882293586u,  532408465u,  111204816u,
+    1585378284u, 1197851309u, 1816695150u, 1968414767u,  974272232u,  587794345u,  136598634u,  289367339u,
+    2527558116u, 2411481253u, 2760973158u, 3179948583u, 4073438432u, 3956313505u, 3237863010u, 3655790371u,
+     347922877u,  229101820u,  646611775u, 1066513022u, 1892689081u, 1774917112u, 1122387515u, 1543337850u,
+    3697634229u, 3313392372u, 3998419255u, 4148705398u, 3087642289u, 2702352368u, 2319436851u, 2468674930u
+  },
+  {
+             0u,   29518391u,   59036782u,   38190681u,  118073564u,  114017003u,   76381362u,   89069189u,
+     236147128u,  265370511u,  228034006u,  206958561u,  152762724u,  148411219u,  178138378u,  190596925u,
+     472294256u,  501532999u,  530741022u,  509615401u,  456068012u,  451764635u,  413917122u,  426358261u,
+     305525448u,  334993663u,  296822438u,  275991697u,  356276756u,  352202787u,  381193850u,  393929805u,
+     944588512u,  965684439u, 1003065998u,  973863097u, 1061482044u, 1049003019u, 1019230802u, 1023561829u,
+     912136024u,  933002607u,  903529270u,  874031361u,  827834244u,  815125939u,  852716522u,  856752605u,
+     611050896u,  631869351u,  669987326u,  640506825u,  593644876u,  580921211u,  551983394u,  556069653u,
+     712553512u,  733666847u,  704405574u,  675154545u,  762387700u,  749958851u,  787859610u,  792175277u,
+    1889177024u, 1901651959u, 1931368878u, 1927033753u, 2006131996u, 1985040171u, 1947726194u, 1976933189u,
+    2122964088u, 2135668303u, 2098006038u, 2093965857u, 2038461604u, 2017599123u, 2047123658u, 2076625661u,
+    1824272048u, 1836991623u, 1866005214u, 1861914857u, 1807058540u, 1786244187u, 1748062722u, 1777547317u,
+    1655668488u, 1668093247u, 1630251878u, 1625932113u, 1705433044u, 1684323811u, 1713505210u, 1742760333u,
+    1222101792u, 1226154263u, 1263738702u, 1251046777u, 1339974652u, 1310460363u, 1281013650u, 1301863845u,
+    1187289752u, 1191637167u, 1161842422u, 1149379777u, 1103966788u, 1074747507u, 1112139306u, 1133218845u,
+    1425107024u, 1429406311u, 1467333694u, 1454888457u, 1408811148u, 1379576507u, 1350309090u, 1371438805u,
+    1524775400u, 1528845279u, 1499917702u, 1487177649u, 1575719220u, 1546255107u, 1584350554u, 1605185389u,
+    3778354048u, 3774312887u, 3803303918u, 3816007129u, 3862737756u, 3892238699u, 3854067506u, 3833203973u,
+    4012263992u, 4007927823u, 3970080342u, 3982554209u, 3895452388u, 3924658387u, 3953866378u, 3932773565u,
+    4245928176u, 4241609415u, 4271336606u, 4283762345u, 4196012076u, 4225268251u, 4187931714u, 4166823541u,
+    4076923208u, 4072833919u, 4035198246u, 4047918865u, 4094247316u, 4123732899u, 4153251322u, 4132437965u,
+    3648544096u, 3636082519u, 3673983246u, 3678331705u, 3732010428u, 3753090955u, 3723829714u, 3694611429u,
+    3614117080u, 3601426159u, 3572488374u, 3576541825u, 3496125444u, 3516976691u, 3555094634u, 3525581405u,
+    3311336976u, 3298595879u, 3336186494u, 3340255305u, 3260503756u, 3281337595u, 3251864226u, 3222399125u,
+    3410866088u, 3398419871u, 3368647622u, 3372945905u, 3427010420u, 3448139075u, 3485520666u, 3456284973u,
+    2444203584u, 2423127159u, 2452308526u, 2481530905u, 2527477404u, 2539934891u, 2502093554u, 2497740997u,
+    2679949304u, 2659102159u, 2620920726u, 2650438049u, 2562027300u, 2574714131u, 2603727690u, 2599670141u,
+    2374579504u, 2353749767u, 2383274334u, 2412743529u, 2323684844u, 2336421851u, 2298759554u, 2294686645u,
+    2207933576u, 2186809023u, 2149495014u, 2178734801u, 2224278612u, 2236720739u, 2266437690u, 2262135309u,
+    2850214048u, 2820717207u, 2858812622u, 2879680249u, 2934667388u, 2938704459u, 2909776914u, 2897069605u,
+    2817622296u, 2788420399u, 2759153014u, 2780249921u, 2700618180u, 2704950259u, 2742877610u, 2730399645u,
+    3049550800u, 3020298727u, 3057690558u, 3078802825u, 2999835404u, 3004150075u, 2974355298u, 2961925461u,
+    3151438440u, 3121956959u, 3092510214u, 3113327665u, 3168701108u, 3172786307u, 3210370778u, 3197646061u
+  },
+  {
+             0u, 3099354981u, 2852767883u,  313896942u, 2405603159u,  937357362u,  627793884u, 2648127673u,
+    3316918511u, 2097696650u, 1874714724u, 3607201537u, 1255587768u, 4067088605u, 3772741427u, 1482887254u,
+    1343838111u, 3903140090u, 4195393300u, 1118632049u, 3749429448u, 1741137837u, 1970407491u, 3452858150u,
+    2511175536u,  756094997u, 1067759611u, 2266550430u,  449832999u, 2725482306u, 2965774508u,  142231497u,
+    2687676222u,  412010587u,  171665333u, 2995192016u,  793786473u, 2548850444u, 2237264098u, 1038456711u,
+    1703315409u, 3711623348u, 3482275674u, 1999841343u, 3940814982u, 1381529571u, 1089329165u, 4166106984u,
+    4029413537u, 1217896388u, 1512189994u, 3802027855u, 2135519222u, 3354724499u, 3577784189u, 1845280792u,
+     899665998u, 2367928107u, 2677414085u,  657096608u, 3137160985u,   37822588u,  284462994u, 2823350519u,
+    2601801789u,  598228824u,  824021174u, 2309093331u,  343330666u, 2898962447u, 3195996129u,  113467524u,
+    1587572946u, 3860600759u, 4104763481u, 1276501820u, 3519211397u, 1769898208u, 2076913422u, 3279374443u,
+    3406630818u, 1941006535u, 1627703081u, 3652755532u, 1148164341u, 4241751952u, 3999682686u, 1457141531u,
+     247015245u, 3053797416u, 2763059142u,  470583459u, 2178658330u,  963106687u,  735213713u, 2473467892u,
+     992409347u, 2207944806u, 2435792776u,  697522413u, 3024379988u,  217581361u,  508405983u, 2800865210u,
+    4271038444u, 1177467017u, 1419450215u, 3962007554u, 1911572667u, 3377213406u, 3690561584u, 1665525589u,
+    1799331996u, 3548628985u, 3241568279u, 2039091058u, 3831314379u, 1558270126u, 1314193216u, 4142438437u,
+    2928380019u,  372764438u,   75645176u, 3158189981u,  568925988u, 2572515393u, 2346768303u,  861712586u,
+    3982079547u, 1441124702u, 1196457648u, 4293663189u, 1648042348u, 3666298377u, 3358779879u, 1888390786u,
+     686661332u, 2421291441u, 2196002399u,  978858298u, 2811169155u,  523464422u,  226935048u, 3040519789u,
+    3175145892u,  100435649u,  390670639u, 2952089162u,  841119475u, 2325614998u, 2553003640u,  546822429u,
+    2029308235u, 3225988654u, 3539796416u, 1782671013u, 4153826844u, 1328167289u, 1570739863u, 3844338162u,
+    1298864389u, 4124540512u, 3882013070u, 1608431339u, 3255406162u, 2058742071u, 1744848601u, 3501990332u,
+    2296328682u,  811816591u,  584513889u, 2590678532u,  129869501u, 3204563416u, 2914283062u,  352848211u,
+     494030490u, 2781751807u, 3078325777u,  264757620u, 2450577869u,  715964072u,  941166918u, 2158327331u,
+    3636881013u, 1618608400u, 1926213374u, 3396585883u, 1470427426u, 4011365959u, 4255988137u, 1158766284u,
+    1984818694u, 3471935843u, 3695453837u, 1693991400u, 4180638033u, 1100160564u, 1395044826u, 3952793279u,
+    3019491049u,  189112716u,  435162722u, 2706139399u, 1016811966u, 2217162459u, 2526189877u,  774831696u,
+     643086745u, 2666061564u, 2354934034u,  887166583u, 2838900430u,  294275499u,   54519365u, 3145957664u,
+    3823145334u, 1532818963u, 1240029693u, 4048895640u, 1820460577u, 3560857924u, 3331051178u, 2117577167u,
+    3598663992u, 1858283101u, 2088143283u, 3301633750u, 1495127663u, 3785470218u, 4078182116u, 1269332353u,
+     332098007u, 2876706482u, 3116540252u,   25085497u, 2628386432u,  605395429u,  916469259u, 2384220526u,
+    2254837415u, 1054503362u,  745528876u, 2496903497u,  151290352u, 2981684885u, 2735556987u,  464596510u,
+    1137851976u, 4218313005u, 3923506883u, 1365741990u, 3434129695u, 1946996346u, 1723425172u, 3724871409u
+  },
+  {
+             0u, 1029712304u, 2059424608u, 1201699536u, 4118849216u, 3370159984u, 2403399072u, 2988497936u,
+     812665793u,  219177585u, 1253054625u, 2010132753u, 3320900865u, 4170237105u, 3207642721u, 2186319825u,
+    1625331586u, 1568718386u,  438355170u,  658566482u, 2506109250u, 2818578674u, 4020265506u, 3535817618u,
+    1351670851u, 1844508147u,  709922595u,  389064339u, 2769320579u, 2557498163u, 3754961379u, 3803185235u,
+    3250663172u, 4238411444u, 3137436772u, 2254525908u,  876710340u,  153198708u, 1317132964u, 1944187668u,
+    4054934725u, 3436268917u, 2339452837u, 3054575125u,   70369797u,  961670069u, 2129760613u, 1133623509u,
+    2703341702u, 2621542710u, 3689016294u, 3867263574u, 1419845190u, 1774270454u,  778128678u,  318858390u,
+    2438067015u, 2888948471u, 3952189479u, 3606153623u, 1691440519u, 1504803895u,  504432359u,  594620247u,
+    1492342857u, 1704161785u,  573770537u,  525542041u, 2910060169u, 2417219385u, 3618876905u, 3939730521u,
+    1753420680u, 1440954936u,  306397416u,  790849880u, 2634265928u, 2690882808u, 3888375336u, 3668168600u,
+     940822475u,   91481723u, 1121164459u, 2142483739u, 3448989963u, 4042473659u, 3075684971u, 2318603227u,
+     140739594u,  889433530u, 1923340138u, 1338244826u, 4259521226u, 3229813626u, 2267247018u, 3124975642u,
+    2570221389u, 2756861693u, 3824297005u, 3734113693u, 1823658381u, 1372780605u,  376603373u,  722643805u,
+    2839690380u, 2485261628u, 3548540908u, 4007806556u, 1556257356u, 1638052860u,  637716780u,  459464860u,
+    4191346895u, 3300051327u, 2199040943u, 3195181599u,  206718479u,  825388991u, 1989285231u, 1274166495u,
+    3382881038u, 4106388158u, 3009607790u, 2382549470u, 1008864718u,   21111934u, 1189240494u, 2072147742u,
+    2984685714u, 2357631266u, 3408323570u, 4131834434u, 1147541074u, 2030452706u, 1051084082u,   63335554u,
+    2174155603u, 3170292451u, 4216760371u, 3325460867u, 1947622803u, 1232499747u,  248909555u,  867575619u,
+    3506841360u, 3966111392u, 2881909872u, 2527485376u,  612794832u,  434546784u, 1581699760u, 1663499008u,
+    3782634705u, 3692447073u, 2612412337u, 2799048193u,  351717905u,  697754529u, 1849071985u, 1398190273u,
+    1881644950u, 1296545318u,  182963446u,  931652934u, 2242328918u, 3100053734u, 4284967478u, 3255255942u,
+    1079497815u, 2100821479u,  983009079u,  133672583u, 3050795671u, 2293717799u, 3474399735u, 4067887175u,
+     281479188u,  765927844u, 1778867060u, 1466397380u, 3846680276u, 3626469220u, 2676489652u, 2733102084u,
+     548881365u,  500656741u, 1517752501u, 1729575173u, 3577210133u, 3898068133u, 2952246901u, 2459410373u,
+    3910527195u, 3564487019u, 2480257979u, 2931134987u,  479546907u,  569730987u, 1716854139u, 1530213579u,
+    3647316762u, 3825568426u, 2745561210u, 2663766474u,  753206746u,  293940330u, 1445287610u, 1799716618u,
+    2314567513u, 3029685993u, 4080348217u, 3461678473u, 2088098201u, 1091956777u,  112560889u, 1003856713u,
+    3112514712u, 2229607720u, 3276105720u, 4263857736u, 1275433560u, 1902492648u,  918929720u,  195422344u,
+     685033439u,  364179055u, 1377080511u, 1869921551u, 3713294623u, 3761522863u, 2811507327u, 2599689167u,
+     413436958u,  633644462u, 1650777982u, 1594160846u, 3978570462u, 3494118254u, 2548332990u, 2860797966u,
+    1211387997u, 1968470509u,  854852413u,  261368461u, 3182753437u, 2161434413u, 3346310653u, 4195650637u,
+    2017729436u, 1160000044u,   42223868u, 1071931724u, 2378480988u, 2963576044u, 4144295484u, 3395602316u
+  },
+  {
+             0u, 3411858341u, 1304994059u, 2257875630u, 2609988118u, 1355649459u, 3596215069u,  486879416u,
+    3964895853u,  655315400u, 2711298918u, 1791488195u, 2009251963u, 3164476382u,  973758832u, 4048990933u,
+      64357019u, 3364540734u, 1310630800u, 2235723829u, 2554806413u, 1394316072u, 3582976390u,  517157411u,
+    4018503926u,  618222419u, 2722963965u, 1762783832u, 1947517664u, 3209171269u,  970744811u, 4068520014u,
+     128714038u, 3438335635u, 1248109629u, 2167961496u, 2621261600u, 1466012805u, 3522553387u,  447296910u,
+    3959392091u,  547575038u, 2788632144u, 1835791861u, 1886307661u, 3140622056u, 1034314822u, 4143626211u,
+      75106221u, 3475428360u, 1236444838u, 2196665603u, 2682996155u, 1421317662u, 3525567664u,  427767573u,
+    3895035328u,  594892389u, 2782995659u, 1857943406u, 1941489622u, 3101955187u, 1047553757u, 4113347960u,
+     257428076u, 3288652233u, 1116777319u, 2311878850u, 2496219258u, 1603640287u, 3640781169u,  308099796u,
+    3809183745u,  676813732u, 2932025610u, 1704983215u, 2023410199u, 3016104370u,  894593820u, 4262377657u,
+     210634999u, 3352484690u, 1095150076u, 2316991065u, 2535410401u, 1547934020u, 3671583722u,  294336591u,
+    3772615322u,  729897279u, 2903845777u, 1716123700u, 2068629644u, 2953845545u,  914647431u, 4258839074u,
+     150212442u, 3282623743u, 1161604689u, 2388688372u, 2472889676u, 1480171241u, 3735940167u,  368132066u,
+    3836185911u,  805002898u, 2842635324u, 1647574937u, 2134298401u, 3026852996u,  855535146u, 4188192143u,
+     186781121u, 3229539940u, 1189784778u, 2377547631u, 2427670487u, 1542429810u, 3715886812u,  371670393u,
+    3882979244u,  741170185u, 2864262823u, 1642462466u, 2095107514u, 3082559007u,  824732849u, 4201955092u,
+     514856152u, 3589064573u, 1400419795u, 2552522358u, 2233554638u, 1316849003u, 3370776517u,   62202976u,
+    4075001525u,  968836368u, 3207280574u, 1954014235u, 1769133219u, 2720925446u,  616199592u, 4024870413u,
+     493229635u, 3594175974u, 1353627464u, 2616354029u, 2264355925u, 1303087088u, 3409966430u,    6498043u,
+    4046820398u,  979978123u, 3170710821u, 2007099008u, 1789187640u, 2717386141u,  661419827u, 3962610838u,
+     421269998u, 3527459403u, 1423225061u, 2676515648u, 2190300152u, 1238466653u, 3477467891u,   68755798u,
+    4115633027u, 1041448998u, 3095868040u, 1943789869u, 1860096405u, 2776760880u,  588673182u, 3897205563u,
+     449450869u, 3516317904u, 1459794558u, 2623431131u, 2170245475u, 1242006214u, 3432247400u,  131015629u,
+    4137259288u, 1036337853u, 3142660115u, 1879958454u, 1829294862u, 2790523051u,  549483013u, 3952910752u,
+     300424884u, 3669282065u, 1545650111u, 2541513754u, 2323209378u, 1092980487u, 3350330793u,  216870412u,
+    4256931033u,  921128828u, 2960342482u, 2066738807u, 1714085583u, 2910195050u,  736264132u, 3770592353u,
+     306060335u, 3647131530u, 1610005796u, 2494197377u, 2309971513u, 1123257756u, 3295149874u,  255536279u,
+    4268596802u,  892423655u, 3013951305u, 2029645036u, 1711070292u, 2929725425u,  674528607u, 3815288570u,
+     373562242u, 3709388839u, 1535949449u, 2429577516u, 2379569556u, 1183418929u, 3223189663u,  188820282u,
+    4195850735u,  827017802u, 3084859620u, 2089020225u, 1636228089u, 2866415708u,  743340786u, 3876759895u,
+     361896217u, 3738094268u, 1482340370u, 2466671543u, 2382584591u, 1163888810u, 3284924932u,  144124321u,
+    4190215028u,  849168593u, 3020503679u, 2136336858u, 1649465698u, 2836138695u,  798521449u, 3838094284u
+  },
+  {
+             0u, 2792819636u, 2543784233u,  837294749u, 4098827283u, 1379413927u, 1674589498u, 3316072078u,
+     871321191u, 2509784531u, 2758827854u,   34034938u, 3349178996u, 1641505216u, 1346337629u, 4131942633u,
+    1742642382u, 3249117050u, 4030828007u, 1446413907u, 2475800797u,  904311657u,   68069876u, 2725880384u,
+    1412551337u, 4064729373u, 3283010432u, 1708771380u, 2692675258u,  101317902u,  937551763u, 2442587175u,
+    3485284764u, 1774858792u, 1478633653u, 4266992385u, 1005723023u, 2642744891u, 2892827814u,  169477906u,
+    4233263099u, 1512406095u, 1808623314u, 3451546982u,  136139752u, 2926205020u, 2676114113u,  972376437u,
+    2825102674u,  236236518u, 1073525883u, 2576072655u, 1546420545u, 4200303349u, 3417542760u, 1841601500u,
+    2609703733u, 1039917185u,  202635804u, 2858742184u, 1875103526u, 3384067218u, 4166835727u, 1579931067u,
+    1141601657u, 3799809741u, 3549717584u, 1977839588u, 2957267306u,  372464350u,  668680259u, 2175552503u,
+    2011446046u, 3516084394u, 3766168119u, 1175200131u, 2209029901u,  635180217u,  338955812u, 2990736784u,
+     601221559u, 2242044419u, 3024812190u,  306049834u, 3617246628u, 1911408144u, 1074125965u, 3866285881u,
+     272279504u, 3058543716u, 2275784441u,  567459149u, 3832906691u, 1107462263u, 1944752874u, 3583875422u,
+    2343980261u,  767641425u,  472473036u, 3126744696u, 2147051766u, 3649987394u, 3899029983u, 1309766251u,
+    3092841090u,  506333494u,  801510315u, 2310084639u, 1276520081u, 3932237093u, 3683203000u, 2113813516u,
+    3966292011u, 1243601823u, 2079834370u, 3716205238u,  405271608u, 3192979340u, 2411259153u,  701492901u,
+    3750207052u, 2045810168u, 1209569125u, 4000285905u,  734575199u, 2378150379u, 3159862134u,  438345922u,
+    2283203314u,  778166598u,  529136603u, 3120492655u, 2086260449u, 3660498261u, 3955679176u, 1303499900u,
+    3153699989u,  495890209u,  744928700u, 2316418568u, 1337360518u, 3921775410u, 3626602927u, 2120129051u,
+    4022892092u, 1237286280u, 2018993941u, 3726666913u,  461853231u, 3186645403u, 2350400262u,  711936178u,
+    3693557851u, 2052076527u, 1270360434u, 3989775046u,  677911624u, 2384402428u, 3220639073u,  427820757u,
+    1202443118u, 3789347034u, 3493118535u, 1984154099u, 3018127229u,  362020041u,  612099668u, 2181885408u,
+    1950653705u, 3526596285u, 3822816288u, 1168934804u, 2148251930u,  645706414u,  395618355u, 2984485767u,
+     544559008u, 2248295444u, 3085590153u,  295523645u, 3560598451u, 1917673479u, 1134918298u, 3855773998u,
+     328860103u, 3052210803u, 2214924526u,  577903450u, 3889505748u, 1101147744u, 1883911421u, 3594338121u,
+    3424493451u, 1785369663u, 1535282850u, 4260726038u,  944946072u, 2653270060u, 2949491377u,  163225861u,
+    4294103532u, 1501944408u, 1752023237u, 3457862513u,  196998655u, 2915761739u, 2619532502u,  978710370u,
+    2881684293u,  229902577u, 1012666988u, 2586515928u, 1603020630u, 4193987810u, 3356702335u, 1852063179u,
+    2553040162u, 1046169238u,  263412747u, 2848217023u, 1818454321u, 3390333573u, 4227627032u, 1569420204u,
+      60859927u, 2782375331u, 2487203646u,  843627658u, 4159668740u, 1368951216u, 1617990445u, 3322386585u,
+     810543216u, 2520310724u, 2815490393u,   27783917u, 3288386659u, 1652017111u, 1402985802u, 4125677310u,
+    1685994201u, 3255382381u, 4091620336u, 1435902020u, 2419138250u,  910562686u,  128847843u, 2715354199u,
+    1469150398u, 4058414858u, 3222168983u, 1719234083u, 2749255853u,   94984985u,  876691844u, 2453031472u
+  },
+  {
+             0u, 3433693342u, 1109723005u, 2391738339u, 2219446010u, 1222643300u, 3329165703u,  180685081u,
+    3555007413u,  525277995u, 2445286600u, 1567235158u, 1471092047u, 2600801745u,  361370162u, 3642757804u,
+    2092642603u, 2953916853u, 1050555990u, 4063508168u, 4176560081u,  878395215u, 3134470316u, 1987983410u,
+    2942184094u, 1676945920u, 3984272867u,  567356797u,  722740324u, 3887998202u, 1764827929u, 2778407815u,
+    4185285206u,  903635656u, 3142804779u, 2012833205u, 2101111980u, 2979425330u, 1058630609u, 4088621903u,
+     714308067u, 3862526333u, 1756790430u, 2753330688u, 2933487385u, 1651734407u, 3975966820u,  542535930u,
+    2244825981u, 1231508451u, 3353891840u,  188896414u,   25648519u, 3442302233u, 1134713594u, 2399689316u,
+    1445480648u, 2592229462u,  336416693u, 3634843435u, 3529655858u,  516441772u, 2420588879u, 1559052753u,
+     698204909u, 3845636723u, 1807271312u, 2803025166u, 2916600855u, 1635634313u, 4025666410u,  593021940u,
+    4202223960u,  919787974u, 3093159461u, 1962401467u, 2117261218u, 2996361020u, 1008193759u, 4038971457u,
+    1428616134u, 2576151384u,  386135227u, 3685348389u, 3513580860u,  499580322u, 2471098945u, 1608776415u,
+    2260985971u, 1248454893u, 3303468814u,  139259792u,   42591881u, 3458459159u, 1085071860u, 2349261162u,
+    3505103035u,  474062885u, 2463016902u, 1583654744u, 1419882049u, 2550902495u,  377792828u, 3660491170u,
+      51297038u, 3483679632u, 1093385331u, 2374089965u, 2269427188u, 1273935210u, 3311514249u,  164344343u,
+    2890961296u, 1627033870u, 4000683757u,  585078387u,  672833386u, 3836780532u, 1782552599u, 2794821769u,
+    2142603813u, 3005188795u, 1032883544u, 4047146438u, 4227826911u,  928351297u, 3118105506u, 1970307900u,
+    1396409818u, 2677114180u,  287212199u, 3719594553u, 3614542624u,  467372990u, 2505346141u, 1509854403u,
+    2162073199u, 1282711281u, 3271268626u,  240228748u,   76845205u, 3359543307u, 1186043880u, 2317064054u,
+     796964081u, 3811226735u, 1839575948u, 2702160658u, 2882189835u, 1734392469u, 3924802934u,  625327592u,
+    4234522436u,  818917338u, 3191908409u, 1927981223u, 2016387518u, 3028656416u,  973776579u, 4137723485u,
+    2857232268u, 1726474002u, 3899187441u,  616751215u,  772270454u, 3803048424u, 1814228491u, 2693328533u,
+    2041117753u, 3036871847u,  999160644u, 4146592730u, 4259508931u,  826864221u, 3217552830u, 1936586016u,
+    3606501031u,  442291769u, 2496909786u, 1484378436u, 1388107869u, 2652297411u,  278519584u, 3694387134u,
+      85183762u, 3384397196u, 1194773103u, 2342308593u, 2170143720u, 1307820918u, 3279733909u,  265733131u,
+    2057717559u, 3054258089u,  948125770u, 4096344276u, 4276898253u,  843467091u, 3167309488u, 1885556270u,
+    2839764098u, 1709792284u, 3949353983u,  667704161u,  755585656u, 3785577190u, 1865176325u, 2743489947u,
+     102594076u, 3401021058u, 1144549729u, 2291298815u, 2186770662u, 1325234296u, 3228729243u,  215514885u,
+    3589828009u,  424832311u, 2547870420u, 1534552650u, 1370645331u, 2635621325u,  328688686u, 3745342640u,
+    2211456353u, 1333405183u, 3254067740u,  224338562u,  127544219u, 3408931589u, 1170156774u, 2299866232u,
+    1345666772u, 2627681866u,  303053225u, 3736746295u, 3565105198u,  416624816u, 2522494803u, 1525692365u,
+    4285207626u,  868291796u, 3176010551u, 1910772649u, 2065767088u, 3079346734u,  956571085u, 4121828691u,
+     747507711u, 3760459617u, 1856702594u, 2717976604u, 2831417605u, 1684930971u, 3940615800u,  642451174u
+  }
+};
+
 /*Return the CRC of the bytes buf[0..len-1].*/
 unsigned lodepng_crc32(const unsigned char* data, size_t length)
 {
   unsigned r = 0xffffffffu;
-  size_t i;
-  for(i = 0; i < length; ++i)
+  size_t i = 0;
+  for(; i + 8 <= length; i += 8)
+  {
+    r ^= (unsigned)data[i] | ((unsigned)data[i + 1] << 8) | ((unsigned)data[i + 2] << 16) | ((unsigned)data[i + 3] << 24);
+    r = lodepng_crc32_slices[6][r & 0xff] ^ lodepng_crc32_slices[5][(r >> 8) & 0xff]
+      ^ lodepng_crc32_slices[4][(r >> 16) & 0xff] ^ lodepng_crc32_slices[3][(r >> 24) & 0xff]
+      ^ lodepng_crc32_slices[2][data[i + 4]] ^ lodepng_crc32_slices[1][data[i + 5]]
+      ^ lodepng_crc32_slices[0][data[i + 6]] ^ lodepng_crc32_table[data[i + 7]];
+  }
+  for(; i < length; ++i)
   {
     r = lodepng_crc32_table[(r ^ data[i]) & 0xff] ^ (r >> 8);
   }
@@ -2345,15 +2770,11 @@ static unsigned char readBitFromReversedStream(size_t* bitpointer, const unsigne
   return result;
 }
 
-static unsigned readBitsFromReversedStream(size_t* bitpointer, const unsigned char* bitstream, size_t nbits)
+/*reads the value of the pixel with index i from an image with 1, 2 or 4 bit pixels, which never cross a byte*/
+static unsigned readPackedValue(const unsigned char* in, size_t i, unsigned bitdepth)
 {
-  unsigned result = 0;
-  size_t i;
-  for(i = nbits - 1; i < nbits; --i)
-  {
-    result += (unsigned)readBitFromReversedStream(bitpointer, bitstream) << i;
-  }
-  return result;
+  size_t bit = i * bitdepth;
+  return (in[bit >> 3] >> (8 - bitdepth - (bit & 7))) & ((1u << bitdepth) - 1u);
 }
 
 #ifdef LODEPNG_COMPILE_DECODER
@@ -3163,8 +3584,7 @@ static void getPixelColorRGBA8(unsigned char* r, unsigned char* g,
     else
     {
       unsigned highest = ((1U << mode->bitdepth) - 1U); /*highest possible value for this bit depth*/
-      size_t j = i * mode->bitdepth;
-      unsigned value = readBitsFromReversedStream(&j, in, mode->bitdepth);
+      unsigned value = readPackedValue(in, i, mode->bitdepth);
       *r = *g = *b = (value * 255) / highest;
       if(mode->key_defined && value == mode->key_r) *a = 0;
       else *a = 255;
@@ -3191,13 +3611,7 @@ static void getPixelColorRGBA8(unsigned char* r, unsigned char* g,
   }
   else if(mode->colortype == LCT_PALETTE)
   {
-    unsigned index;
-    if(mode->bitdepth == 8) index = in[i];
-    else
-    {
-      size_t j = i * mode->bitdepth;
-      index = readBitsFromReversedStream(&j, in, mode->bitdepth);
-    }
+    unsigned index = mode->bitdepth == 8 ? in[i] : readPackedValue(in, i, mode->bitdepth);
 
     if(index >= mode->palettesize)
     {
@@ -3246,6 +3660,75 @@ static void getPixelColorRGBA8(unsigned char* r, unsigned char* g,
   }
 }
 
+/*
+Converts palette images and greyscale images below 8 bit to RGBA8 or RGB8 (see getPixelColorsRGBA8) with a lookup
+table of the color of every value a pixel can have, which takes care of color keys and out of range palette indices
+in advance. The input is read a byte at a time; each byte holds 8 / bitdepth pixels.
+*/
+static void unpackColors(unsigned char* buffer, size_t numpixels, unsigned has_alpha,
+                         const unsigned char* in, const LodePNGColorMode* mode)
+{
+  unsigned char colors[256 * 4];
+  unsigned num_channels = has_alpha ? 4 : 3;
+  unsigned bitdepth = mode->bitdepth;
+  unsigned mask = (1u << bitdepth) - 1u; /*also the highest value*/
+  unsigned value;
+  size_t i;
+
+  for(value = 0; value <= mask; ++value)
+  {
+    unsigned char* color = &colors[value * 4];
+    if(mode->colortype == LCT_GREY)
+    {
+      color[0] = color[1] = color[2] = (value * 255) / mask;
+      color[3] = mode->key_defined && value == mode->key_r ? 0 : 255;
+    }
+    else if(value < mode->palettesize)
+    {
+      color[0] = mode->palette[value * 4 + 0];
+      color[1] = mode->palette[value * 4 + 1];
+      color[2] = mode->palette[value * 4 + 2];
+      color[3] = mode->palette[value * 4 + 3];
+    }
+    else
+    {
+      /*This is an error according to the PNG spec, but most PNG decoders make it black instead.
+      Done here too, slightly faster due to no error handling needed.*/
+      color[0] = color[1] = color[2] = 0;
+      color[3] = 255;
+    }
+  }
+
+  if(bitdepth == 8)
+  {
+    for(i = 0; i != numpixels; ++i, buffer += num_channels)
+    {
+      const unsigned char* color = &colors[in[i] * 4];
+      buffer[0] = color[0];
+      buffer[1] = color[1];
+      buffer[2] = color[2];
+      if(has_alpha) buffer[3] = color[3];
+    }
+    return;
+  }
+
+  for(i = 0; i != numpixels; ++in)
+  {
+    unsigned byte = *in;
+    unsigned shift = 8;
+    for(; shift != 0 && i != numpixels; ++i, buffer += num_channels)
+    {
+      const unsigned char* color;
+      shift -= bitdepth;
+      color = &colors[((byte >> shift) & mask) * 4];
+      buffer[0] = color[0];
+      buffer[1] = color[1];
+      buffer[2] = color[2];
+      if(has_alpha) buffer[3] = color[3];
+    }
+  }
+}
+
 /*Similar to getPixelColorRGBA8, but with all the for loops inside of the color
 mode test cases, optimized to convert the colors much faster, when converting
 to RGBA or RGB with 8 bit per cannel. buffer must be RGBA or RGB output with
@@ -3275,17 +3758,7 @@ static void getPixelColorsRGBA8(unsigned char* buffer, size_t numpixels,
         if(has_alpha) buffer[3] = mode->key_defined && 256U * in[i * 2 + 0] + in[i * 2 + 1] == mode->key_r ? 0 : 255;
       }
     }
-    else
-    {
-      unsigned highest = ((1U << mode->bitdepth) - 1U); /*highest possible value for this bit depth*/
-      size_t j = 0;
-      for(i = 0; i != numpixels; ++i, buffer += num_channels)
-      {
-        unsigned value = readBitsFromReversedStream(&j, in, mode->bitdepth);
-        buffer[0] = buffer[1] = buffer[2] = (value * 255) / highest;
-        if(has_alpha) buffer[3] = mode->key_defined && value == mode->key_r ? 0 : 255;
-      }
-    }
+    else unpackColors(buffer, numpixels, has_alpha, in, mode);
   }
   else if(mode->colortype == LCT_RGB)
   {
@@ -3316,28 +3789,7 @@ static void getPixelColorsRGBA8(unsigned char* buffer, size_t numpixels,
   }
   else if(mode->colortype == LCT_PALETTE)
   {
-    unsigned index;
-    size_t j = 0;
-    for(i = 0; i != numpixels; ++i, buffer += num_channels)
-    {
-      if(mode->bitdepth == 8) index = in[i];
-      else index = readBitsFromReversedStream(&j, in, mode->bitdepth);
-
-      if(index >= mode->palettesize)
-      {
-        /*This is an error according to the PNG spec, but most PNG decoders make it black instead.
-        Done here too, slightly faster due to no error handling needed.*/
-        buffer[0] = buffer[1] = buffer[2] = 0;
-        if(has_alpha) buffer[3] = 255;
-      }
-      else
-      {
-        buffer[0] = mode->palette[index * 4 + 0];
-        buffer[1] = mode->palette[index * 4 + 1];
-        buffer[2] = mode->palette[index * 4 + 2];
-        if(has_alpha) buffer[3] = mode->palette[index * 4 + 3];
-      }
-    }
+    unpackColors(buffer, numpixels, has_alpha, in, mode);
   }
   else if(mode->colortype == LCT_GREY_ALPHA)
   {
@@ -3426,6 +3878,7 @@ unsigned lodepng_convert(unsigned char* out, const unsigned char* in,
   size_t i;
   ColorTree tree;
   size_t numpixels = w * h;
+  unsigned error = 0;
 
   if(lodepng_color_mode_equal(mode_out, mode_in))
   {
@@ -3476,10 +3929,10 @@ unsigned lodepng_convert(unsigned char* out, const unsigned char* in,
   else
   {
     unsigned char r = 0, g = 0, b = 0, a = 0;
-    for(i = 0; i != numpixels; ++i)
+    for(i = 0; i != numpixels && !error; ++i)
     {
       getPixelColorRGBA8(&r, &g, &b, &a, in, i, mode_in);
-      CERROR_TRY_RETURN(rgba8ToPixel(out, i, mode_out, &tree, r, g, b, a));
+      error = rgba8ToPixel(out, i, mode_out, &tree, r, g, b, a);
     }
   }
 
@@ -3488,7 +3941,7 @@ unsigned lodepng_convert(unsigned char* out, const unsigned char* in,
     color_tree_cleanup(&tree);
   }
 
-  return 0; /*no error*/
+  return error;
 }
 
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -3823,6 +4276,83 @@ static void Adam7_getpassvalues(unsigned passw[7], unsigned passh[7], size_t fil
   }
 }
 
+/*
+Copies count whole byte pixels, reading one every instride bytes and writing one every outstride bytes. The Adam7
+code uses it to move one row of a reduced image from or to its row in the full image. Each PNG bytewidth has its
+own loop with a constant size, which compilers turn into a single load and store per pixel.
+*/
+static void Adam7_copyPixels(unsigned char* out, size_t outstride, const unsigned char* in, size_t instride,
+                             unsigned count, size_t bytewidth)
+{
+  unsigned x;
+  switch(bytewidth)
+  {
+    case 1: for(x = 0; x != count; ++x) out[x * outstride] = in[x * instride]; break;
+    case 2: for(x = 0; x != count; ++x) memcpy(&out[x * outstride], &in[x * instride], 2); break;
+    case 3: for(x = 0; x != count; ++x) memcpy(&out[x * outstride], &in[x * instride], 3); break;
+    case 4: for(x = 0; x != count; ++x) memcpy(&out[x * outstride], &in[x * instride], 4); break;
+    case 6: for(x = 0; x != count; ++x) memcpy(&out[x * outstride], &in[x * instride], 6); break;
+    case 8: for(x = 0; x != count; ++x) memcpy(&out[x * outstride], &in[x * instride], 8); break;
+    default: for(x = 0; x != count; ++x) memcpy(&out[x * outstride], &in[x * instride], bytewidth); break;
+  }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* / Profiling                                                              / */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+/*
+The PROFILE_ macros time a stage into the LodePNGProfile of a state. Without LODEPNG_COMPILE_PROFILING they expand
+to nothing. PROFILE_TIMER declares the start time and goes with the declarations at the start of a block.
+pre- and postProcessScanlines consist of several stages and get the profile as an extra parameter through
+PROFILE_PARAM and PROFILE_ARG.
+*/
+#ifdef LODEPNG_COMPILE_PROFILING
+static double lodepng_profile_time(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER t, f;
+  QueryPerformanceCounter(&t);
+  QueryPerformanceFrequency(&f);
+  return (double)t.QuadPart / (double)f.QuadPart;
+#else
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+static void lodepng_profile_clear(LodePNGProfile* profile)
+{
+  unsigned i;
+  for(i = 0; i != LPS_NUM_STAGES; ++i)
+  {
+    profile->seconds[i] = 0;
+    profile->bytes[i] = 0;
+  }
+}
+
+static void lodepng_profile_add(LodePNGProfile* profile, LodePNGProfileStage stage, double start, size_t bytes)
+{
+  profile->seconds[stage] += lodepng_profile_time() - start;
+  profile->bytes[stage] += bytes;
+}
+
+#define PROFILE_TIMER(t) double t;
+#define PROFILE_START(t) t = lodepng_profile_time()
+#define PROFILE_STOP(profile, stage, t, bytes) lodepng_profile_add(profile, stage, t, bytes)
+#define PROFILE_CLEAR(profile) lodepng_profile_clear(profile)
+#define PROFILE_PARAM , LodePNGProfile* profile
+#define PROFILE_ARG(profile) , profile
+#else /*LODEPNG_COMPILE_PROFILING*/
+#define PROFILE_TIMER(t)
+#define PROFILE_START(t)
+#define PROFILE_STOP(profile, stage, t, bytes)
+#define PROFILE_CLEAR(profile)
+#define PROFILE_PARAM
+#define PROFILE_ARG(profile)
+#endif /*LODEPNG_COMPILE_PROFILING*/
+
 #ifdef LODEPNG_COMPILE_DECODER
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -4022,20 +4552,17 @@ static void Adam7_deinterlace(unsigned char* out, const unsigned char* in, unsig
 
   if(bpp >= 8)
   {
+    /*fill the image row by row from the reduced images that have a row there, so each image row is completed while
+    it's in cache, and each reduced image is still read from front to back*/
+    unsigned y;
+    size_t bytewidth = bpp / 8;
+    for(y = 0; y != h; ++y)
     for(i = 0; i != 7; ++i)
     {
-      unsigned x, y, b;
-      size_t bytewidth = bpp / 8;
-      for(y = 0; y < passh[i]; ++y)
-      for(x = 0; x < passw[i]; ++x)
-      {
-        size_t pixelinstart = passstart[i] + (y * passw[i] + x) * bytewidth;
-        size_t pixeloutstart = ((ADAM7_IY[i] + y * ADAM7_DY[i]) * w + ADAM7_IX[i] + x * ADAM7_DX[i]) * bytewidth;
-        for(b = 0; b < bytewidth; ++b)
-        {
-          out[pixeloutstart + b] = in[pixelinstart + b];
-        }
-      }
+      if(passw[i] == 0 || y < ADAM7_IY[i] || (y - ADAM7_IY[i]) % ADAM7_DY[i] != 0) continue;
+      Adam7_copyPixels(&out[((size_t)y * w + ADAM7_IX[i]) * bytewidth], ADAM7_DX[i] * bytewidth,
+                       &in[passstart[i] + (size_t)((y - ADAM7_IY[i]) / ADAM7_DY[i]) * passw[i] * bytewidth],
+                       bytewidth, passw[i], bytewidth);
     }
   }
   else /*bpp < 8: Adam7 with pixels < 8 bit is a bit trickier: with bit pointers*/
@@ -4075,17 +4602,44 @@ static void removePaddingBits(unsigned char* out, const unsigned char* in,
   only useful if (ilinebits - olinebits) is a value in the range 1..7
   */
   unsigned y;
-  size_t diff = ilinebits - olinebits;
-  size_t ibp = 0, obp = 0; /*input and output bit pointers*/
-  for(y = 0; y < h; ++y)
+  size_t obp = 0; /*output bit pointer*/
+  if(ilinebits % 8 != 0)
+  {
+    /*input scanlines that don't start at a byte go bit by bit; padded PNG scanlines always start at a byte*/
+    size_t diff = ilinebits - olinebits;
+    size_t ibp = 0; /*input bit pointer*/
+    for(y = 0; y < h; ++y)
+    {
+      size_t x;
+      for(x = 0; x < olinebits; ++x)
+      {
+        unsigned char bit = readBitFromReversedStream(&ibp, in);
+        setBitOfReversedStream(&obp, out, bit);
+      }
+      ibp += diff;
+    }
+    return;
+  }
+
+  /*
+  Every input scanline starts at a byte, so it's moved a byte at a time: each input byte is split over two output
+  bytes at the bit offset of the output scanline. An output byte only gets written after the input bytes it overlaps
+  were read, so this works in place.
+  */
+  for(y = 0; y < h; ++y, in += ilinebits / 8)
   {
     size_t x;
-    for(x = 0; x < olinebits; ++x)
+    for(x = 0; x < olinebits; x += 8, obp += 8)
     {
-      unsigned char bit = readBitFromReversedStream(&ibp, in);
-      setBitOfReversedStream(&obp, out, bit);
+      unsigned shift = obp & 7;
+      unsigned char* o = &out[obp >> 3];
+      unsigned char byte = in[x >> 3];
+      size_t bits = olinebits - x < 8 ? olinebits - x : 8;
+      if(bits < 8) byte &= (unsigned char)(0xff00u >> bits); /*the padding bits at the end of the scanline*/
+      o[0] = (unsigned char)((o[0] & (0xff00u >> shift)) | (byte >> shift));
+      if(shift + bits > 8) o[1] = (unsigned char)(byte << (8 - shift));
     }
-    ibp += diff;
+    obp -= x - olinebits; /*the last step may have been less than 8 bits*/
   }
 }
 
@@ -4093,7 +4647,7 @@ static void removePaddingBits(unsigned char* out, const unsigned char* in,
 the IDAT chunks (with filter index bytes and possible padding bits)
 return value is error*/
 static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
-                                     unsigned w, unsigned h, const LodePNGInfo* info_png)
+                                     unsigned w, unsigned h, const LodePNGInfo* info_png PROFILE_PARAM)
 {
   /*
   This function converts the filtered-padded-interlaced data into pure 2D image buffer with the PNG's colortype.
@@ -4103,8 +4657,10 @@ static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
   NOTE: the in buffer will be overwritten with intermediate data!
   */
   unsigned bpp = lodepng_get_bpp(&info_png->color);
+  PROFILE_TIMER(t)
   if(bpp == 0) return 31; /*error: invalid colortype*/
 
+  PROFILE_START(t);
   if(info_png->interlace_method == 0)
   {
     if(bpp < 8 && w * bpp != ((w * bpp + 7) / 8) * 8)
@@ -4114,6 +4670,7 @@ static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
     }
     /*we can immediately filter into the out buffer, no other steps needed*/
     else CERROR_TRY_RETURN(unfilter(out, in, w, h, bpp));
+    PROFILE_STOP(profile, LPS_UNFILTER, t, lodepng_get_raw_size_idat(w, h, &info_png->color) + h);
   }
   else /*interlace_method is 1 (Adam7)*/
   {
@@ -4135,8 +4692,11 @@ static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
                           ((passw[i] * bpp + 7) / 8) * 8, passh[i]);
       }
     }
+    PROFILE_STOP(profile, LPS_UNFILTER, t, filter_passstart[7]);
 
+    PROFILE_START(t);
     Adam7_deinterlace(out, in, w, h, bpp);
+    PROFILE_STOP(profile, LPS_DEINTERLACE, t, lodepng_get_raw_size(w, h, &info_png->color));
   }
 
   return 0;
@@ -4449,9 +5009,11 @@ static unsigned readChunk_pHYs(LodePNGInfo* info, const unsigned char* data, siz
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
 /*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
+/*decodes into dest if given, which must be zero-filled and have room for the image in the PNG's color mode,
+otherwise into a newly allocated buffer*/
 static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
                           LodePNGState* state,
-                          const unsigned char* in, size_t insize)
+                          const unsigned char* in, size_t insize, unsigned char* dest)
 {
   unsigned char IEND = 0;
   const unsigned char* chunk;
@@ -4460,6 +5022,7 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   ucvector scanlines;
   size_t predict;
   size_t numpixels;
+  PROFILE_TIMER(t)
 
   /*for unknown chunk order*/
   unsigned unknown = 0;
@@ -4491,6 +5054,7 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     unsigned chunkLength;
     const unsigned char* data; /*the data in the chunk*/
 
+    PROFILE_START(t);
     /*error: size of the in buffer too small to contain next chunk*/
     if((size_t)((chunk - in) + 12) > insize || chunk < in) CERROR_BREAK(state->error, 30);
 
@@ -4597,9 +5161,13 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
     }
 
+    PROFILE_STOP(&state->profile, LPS_CHUNKS, t, chunkLength + 12);
+
     if(!state->decoder.ignore_crc && !unknown) /*check CRC if wanted, only on known chunk types*/
     {
+      PROFILE_START(t);
       if(lodepng_chunk_check_crc(chunk)) CERROR_BREAK(state->error, 57); /*invalid CRC*/
+      PROFILE_STOP(&state->profile, LPS_CRC, t, chunkLength + 4);
     }
 
     if(!IEND) chunk = lodepng_chunk_next_const(chunk);
@@ -4629,8 +5197,10 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   if(!state->error && !ucvector_reserve(&scanlines, predict)) state->error = 83; /*alloc fail*/
   if(!state->error)
   {
+    PROFILE_START(t);
     state->error = zlib_decompress(&scanlines.data, &scanlines.size, idat.data,
                                    idat.size, &state->decoder.zlibsettings);
+    PROFILE_STOP(&state->profile, LPS_INFLATE, t, scanlines.size);
     if(!state->error && scanlines.size != predict) state->error = 91; /*decompressed size doesn't match prediction*/
   }
   ucvector_cleanup(&idat);
@@ -4638,20 +5208,39 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   if(!state->error)
   {
     size_t outsize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
-    *out = (unsigned char*)lodepng_malloc(outsize);
-    if(!*out) state->error = 83; /*alloc fail*/
-    for(i = 0; i < outsize; i++) (*out)[i] = 0;
-    if(!state->error) state->error = postProcessScanlines(*out, scanlines.data, *w, *h, &state->info_png);
+    *out = dest;
+    if(!dest)
+    {
+      *out = (unsigned char*)lodepng_malloc(outsize);
+      if(!*out) state->error = 83; /*alloc fail*/
+      else for(i = 0; i < outsize; i++) (*out)[i] = 0;
+    }
+    if(!state->error) state->error = postProcessScanlines(*out, scanlines.data, *w, *h, &state->info_png
+                                                           PROFILE_ARG(&state->profile));
   }
   ucvector_cleanup(&scanlines);
 }
 
-unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
-                        LodePNGState* state,
-                        const unsigned char* in, size_t insize)
+/*lodepng_decode, but into dest if given. dest must be zero-filled and have room for the image in the mode it is
+returned in: info_raw if color_convert is set, the PNG's color mode otherwise. Lets the C++ wrapper decode straight
+into its output instead of copying the decoded image there.*/
+static unsigned decodeInto(unsigned char** out, unsigned* w, unsigned* h,
+                           LodePNGState* state,
+                           const unsigned char* in, size_t insize, unsigned char* dest)
 {
+  unsigned char* raw = dest; /*where the scanlines are decoded to, a temporary buffer if they need converting*/
+  PROFILE_TIMER(t)
   *out = 0;
-  decodeGeneric(out, w, h, state, in, insize);
+  PROFILE_CLEAR(&state->profile);
+  if(dest)
+  {
+    /*the PNG's color mode decides whether the image can be decoded straight into dest or is converted into it*/
+    state->error = lodepng_inspect(w, h, state, in, insize);
+    if(state->error) return state->error;
+    if(state->decoder.color_convert && (!lodepng_color_mode_equal(&state->info_raw, &state->info_png.color)
+       || state->info_png.color.colortype == LCT_PALETTE)) raw = 0; /*palettes are only known after decoding*/
+  }
+  decodeGeneric(out, w, h, state, in, insize, raw);
   if(state->error) return state->error;
   if(!state->decoder.color_convert || lodepng_color_mode_equal(&state->info_raw, &state->info_png.color))
   {
@@ -4663,6 +5252,13 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
       state->error = lodepng_color_mode_copy(&state->info_raw, &state->info_png.color);
       if(state->error) return state->error;
     }
+    if(dest && *out != dest)
+    {
+      /*the palette turned out to be the same*/
+      memcpy(dest, *out, lodepng_get_raw_size(*w, *h, &state->info_raw));
+      lodepng_free(*out);
+      *out = dest;
+    }
   }
   else
   {
@@ -4679,18 +5275,37 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
     }
 
     outsize = lodepng_get_raw_size(*w, *h, &state->info_raw);
-    *out = (unsigned char*)lodepng_malloc(outsize);
+    if(dest && data == dest)
+    {
+      /*a tRNS color key made the modes differ after the header said they match, so the image was decoded into
+      dest already: convert from a copy of it. Both modes have the same color type and bit depth here.*/
+      data = (unsigned char*)lodepng_malloc(outsize);
+      if(!data) return state->error = 83; /*alloc fail*/
+      memcpy(data, dest, outsize);
+    }
+    *out = dest ? dest : (unsigned char*)lodepng_malloc(outsize);
     if(!(*out))
     {
       state->error = 83; /*alloc fail*/
     }
-    else state->error = lodepng_convert(*out, data, &state->info_raw,
-                                        &state->info_png.color, *w, *h);
+    else
+    {
+      PROFILE_START(t);
+      state->error = lodepng_convert(*out, data, &state->info_raw, &state->info_png.color, *w, *h);
+      PROFILE_STOP(&state->profile, LPS_CONVERT, t, outsize);
+    }
     lodepng_free(data);
   }
   return state->error;
 }
 
+unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
+                        LodePNGState* state,
+                        const unsigned char* in, size_t insize)
+{
+  return decodeInto(out, w, h, state, in, insize, 0);
+}
+
 unsigned lodepng_decode_memory(unsigned char** out, unsigned* w, unsigned* h, const unsigned char* in,
                                size_t insize, LodePNGColorType colortype, unsigned bitdepth)
 {
@@ -4764,6 +5379,7 @@ void lodepng_state_init(LodePNGState* state)
   lodepng_color_mode_init(&state->info_raw);
   lodepng_info_init(&state->info_png);
   state->error = 1;
+  PROFILE_CLEAR(&state->profile);
 }
 
 void lodepng_state_cleanup(LodePNGState* state)
@@ -4900,6 +5516,26 @@ static unsigned addChunk_IDAT(ucvector* out, const unsigned char* data, size_t d
   ucvector zlibdata;
   unsigned error = 0;
 
+#ifdef LODEPNG_COMPILE_ZLIB
+  if(!zlibsettings->custom_zlib)
+  {
+    /*compress straight into the chunk, then fill in the length and type in front of it and the CRC behind it*/
+    size_t start = out->size;
+    if(!ucvector_resize(out, start + 8)) return 83; /*alloc fail*/
+    error = zlib_compressv(out, data, datasize, zlibsettings);
+    if(!error && !ucvector_resize(out, out->size + 4)) error = 83; /*alloc fail*/
+    if(error)
+    {
+      out->size = start;
+      return error;
+    }
+    lodepng_set32bitInt(&out->data[start], (unsigned)(out->size - start - 12));
+    memcpy(&out->data[start + 4], "IDAT", 4);
+    lodepng_chunk_generate_crc(&out->data[start]);
+    return 0;
+  }
+#endif /*LODEPNG_COMPILE_ZLIB*/
+
   /*compress with the Zlib compressor*/
   ucvector_init(&zlibdata);
   error = zlib_compress(&zlibdata.data, &zlibdata.size, data, datasize, zlibsettings);
@@ -5180,6 +5816,17 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
       prevline = &in[inindex];
     }
   }
+  else if(strategy == LFS_UP)
+  {
+    for(y = 0; y != h; ++y)
+    {
+      size_t outindex = (1 + linebytes) * y; /*the extra filterbyte added to each row*/
+      size_t inindex = linebytes * y;
+      out[outindex] = 2; /*filter type byte*/
+      filterScanline(&out[outindex + 1], &in[inindex], prevline, linebytes, bytewidth, 2);
+      prevline = &in[inindex];
+    }
+  }
   else if(strategy == LFS_MINSUM)
   {
     /*adaptive filtering*/
@@ -5395,20 +6042,17 @@ static void Adam7_interlace(unsigned char* out, const unsigned char* in, unsigne
 
   if(bpp >= 8)
   {
+    /*go through the image row by row and give each reduced image that has a row there its pixels, the reverse of
+    Adam7_deinterlace*/
+    unsigned y;
+    size_t bytewidth = bpp / 8;
+    for(y = 0; y != h; ++y)
     for(i = 0; i != 7; ++i)
     {
-      unsigned x, y, b;
-      size_t bytewidth = bpp / 8;
-      for(y = 0; y < passh[i]; ++y)
-      for(x = 0; x < passw[i]; ++x)
-      {
-        size_t pixelinstart = ((ADAM7_IY[i] + y * ADAM7_DY[i]) * w + ADAM7_IX[i] + x * ADAM7_DX[i]) * bytewidth;
-        size_t pixeloutstart = passstart[i] + (y * passw[i] + x) * bytewidth;
-        for(b = 0; b < bytewidth; ++b)
-        {
-          out[pixeloutstart + b] = in[pixelinstart + b];
-        }
-      }
+      if(passw[i] == 0 || y < ADAM7_IY[i] || (y - ADAM7_IY[i]) % ADAM7_DY[i] != 0) continue;
+      Adam7_copyPixels(&out[passstart[i] + (size_t)((y - ADAM7_IY[i]) / ADAM7_DY[i]) * passw[i] * bytewidth],
+                       bytewidth, &in[((size_t)y * w + ADAM7_IX[i]) * bytewidth], ADAM7_DX[i] * bytewidth,
+                       passw[i], bytewidth);
     }
   }
   else /*bpp < 8: Adam7 with pixels < 8 bit is a bit trickier: with bit pointers*/
@@ -5438,7 +6082,8 @@ static void Adam7_interlace(unsigned char* out, const unsigned char* in, unsigne
 return value is error**/
 static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const unsigned char* in,
                                     unsigned w, unsigned h,
-                                    const LodePNGInfo* info_png, const LodePNGEncoderSettings* settings)
+                                    const LodePNGInfo* info_png, const LodePNGEncoderSettings* settings
+                                    PROFILE_PARAM)
 {
   /*
   This function converts the pure 2D image with the PNG's colortype, into filtered-padded-interlaced data. Steps:
@@ -5447,6 +6092,7 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
   */
   unsigned bpp = lodepng_get_bpp(&info_png->color);
   unsigned error = 0;
+  PROFILE_TIMER(t)
 
   if(info_png->interlace_method == 0)
   {
@@ -5454,6 +6100,7 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
     *out = (unsigned char*)lodepng_malloc(*outsize);
     if(!(*out) && (*outsize)) error = 83; /*alloc fail*/
 
+    PROFILE_START(t);
     if(!error)
     {
       /*non multiple of 8 bits per scanline, padding bits needed per scanline*/
@@ -5474,6 +6121,7 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
         error = filter(*out, in, w, h, &info_png->color, settings);
       }
     }
+    PROFILE_STOP(profile, LPS_FILTER, t, *outsize);
   }
   else /*interlace_method is 1 (Adam7)*/
   {
@@ -5494,7 +6142,11 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
     {
       unsigned i;
 
+      PROFILE_START(t);
       Adam7_interlace(adam7, in, w, h, bpp);
+      PROFILE_STOP(profile, LPS_INTERLACE, t, lodepng_get_raw_size(w, h, &info_png->color));
+
+      PROFILE_START(t);
       for(i = 0; i != 7; ++i)
       {
         if(bpp < 8)
@@ -5515,6 +6167,7 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
 
         if(error) break;
       }
+      PROFILE_STOP(profile, LPS_FILTER, t, *outsize);
     }
 
     lodepng_free(adam7);
@@ -5571,11 +6224,13 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
   ucvector outv;
   unsigned char* data = 0; /*uncompressed version of the IDAT chunk data*/
   size_t datasize = 0;
+  PROFILE_TIMER(t)
 
   /*provide some proper output values if error will happen*/
   *out = 0;
   *outsize = 0;
   state->error = 0;
+  PROFILE_CLEAR(&state->profile);
 
   lodepng_info_init(&info);
   lodepng_info_copy(&info, &state->info_png);
@@ -5589,7 +6244,9 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
 
   if(state->encoder.auto_convert)
   {
+    PROFILE_START(t);
     state->error = lodepng_auto_choose_color(&info.color, image, w, h, &state->info_raw);
+    PROFILE_STOP(&state->profile, LPS_AUTO_CONVERT, t, lodepng_get_raw_size(w, h, &state->info_raw));
   }
   if(state->error) return state->error;
 
@@ -5616,12 +6273,17 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
     if(!converted && size) state->error = 83; /*alloc fail*/
     if(!state->error)
     {
+      PROFILE_START(t);
       state->error = lodepng_convert(converted, image, &info.color, &state->info_raw, w, h);
+      PROFILE_STOP(&state->profile, LPS_CONVERT, t, size);
+    }
+    if(!state->error)
+    {
+      preProcessScanlines(&data, &datasize, converted, w, h, &info, &state->encoder PROFILE_ARG(&state->profile));
     }
-    if(!state->error) preProcessScanlines(&data, &datasize, converted, w, h, &info, &state->encoder);
     lodepng_free(converted);
   }
-  else preProcessScanlines(&data, &datasize, image, w, h, &info, &state->encoder);
+  else preProcessScanlines(&data, &datasize, image, w, h, &info, &state->encoder PROFILE_ARG(&state->profile));
 
   ucvector_init(&outv);
   while(!state->error) /*while only executed once, to break on error*/
@@ -5673,7 +6335,9 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
     }
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
     /*IDAT (multiple IDAT chunks must be consecutive)*/
+    PROFILE_START(t);
     state->error = addChunk_IDAT(&outv, data, datasize, &state->encoder.zlibsettings);
+    PROFILE_STOP(&state->profile, LPS_DEFLATE, t, datasize);
     if(state->error) break;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
     /*tIME*/
@@ -5924,6 +6588,17 @@ const char* lodepng_error_text(unsigned code)
     case 92: return "too many pixels, not supported";
     case 93: return "zero width or height is invalid";
     case 94: return "header chunk must have a size of 13 bytes";
+    /*the APNG errors are given by the APNG functions of lodepng_util*/
+    case 95: return "invalid APNG acTL chunk, it must have a size of 8 bytes and at least 1 frame";
+    case 96: return "invalid APNG fcTL chunk size, or a frame delay that doesn't fit in 16 bits";
+    case 97: return "APNG frame is empty or outside of the canvas, or the first frame doesn't cover the canvas";
+    case 98: return "APNG chunk sequence number out of order";
+    case 99: return "invalid APNG dispose or blend op";
+    case 100: return "APNG fdAT chunk without fcTL chunk before it, or APNG frame without image data";
+    case 101: return "APNG frames differ in color type, bit depth, interlace method or palette";
+    case 102: return "no APNG frames left to decode";
+    /*given by lodepng_util's palette quantizer*/
+    case 103: return "palette quantization needs from 1 to 256 colors and an image of at least 1 pixel";
   }
   return "unknown error code";
 }
@@ -5939,6 +6614,59 @@ const char* lodepng_error_text(unsigned code)
 namespace lodepng
 {
 
+Buffer::Buffer() : data_(0), size_(0)
+{
+}
+
+Buffer::~Buffer()
+{
+  lodepng_free(data_);
+}
+
+#ifdef LODEPNG_COMPILE_CPP11
+Buffer::Buffer(Buffer&& other) : data_(other.data_), size_(other.size_)
+{
+  other.data_ = 0;
+  other.size_ = 0;
+}
+
+Buffer& Buffer::operator=(Buffer&& other)
+{
+  if(this != &other)
+  {
+    reset(other.data_, other.size_);
+    other.data_ = 0;
+    other.size_ = 0;
+  }
+  return *this;
+}
+#endif /*LODEPNG_COMPILE_CPP11*/
+
+void Buffer::reset(unsigned char* data, size_t size)
+{
+  if(data != data_) lodepng_free(data_);
+  data_ = data;
+  size_ = data ? size : 0;
+}
+
+unsigned char* Buffer::release()
+{
+  unsigned char* data = data_;
+  data_ = 0;
+  size_ = 0;
+  return data;
+}
+
+void Buffer::swap(Buffer& other)
+{
+  unsigned char* data = data_;
+  size_t size = size_;
+  data_ = other.data_;
+  size_ = other.size_;
+  other.data_ = data;
+  other.size_ = size;
+}
+
 #ifdef LODEPNG_COMPILE_DISK
 unsigned load_file(std::vector<unsigned char>& buffer, const std::string& filename)
 {
@@ -6043,18 +6771,10 @@ State& State::operator=(const State& other)
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h, const unsigned char* in,
                 size_t insize, LodePNGColorType colortype, unsigned bitdepth)
 {
-  unsigned char* buffer;
-  unsigned error = lodepng_decode_memory(&buffer, &w, &h, in, insize, colortype, bitdepth);
-  if(buffer && !error)
-  {
-    State state;
-    state.info_raw.colortype = colortype;
-    state.info_raw.bitdepth = bitdepth;
-    size_t buffersize = lodepng_get_raw_size(w, h, &state.info_raw);
-    out.insert(out.end(), &buffer[0], &buffer[buffersize]);
-    lodepng_free(buffer);
-  }
-  return error;
+  State state;
+  state.info_raw.colortype = colortype;
+  state.info_raw.bitdepth = bitdepth;
+  return decode(out, w, h, state, in, insize);
 }
 
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
@@ -6068,13 +6788,30 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 const unsigned char* in, size_t insize)
 {
   unsigned char* buffer = NULL;
-  unsigned error = lodepng_decode(&buffer, &w, &h, &state, in, insize);
-  if(buffer && !error)
+  unsigned char* dest = NULL;
+  size_t oldsize = out.size(), buffersize = 0;
+  unsigned error = lodepng_inspect(&w, &h, &state, in, insize);
+  if(error) return error;
+  /*grow out to the decoded size and decode into it, unless the header claims more than the compressed data
+  could possibly expand to: then it's corrupt, and decoding into a temporary buffer finds that out without
+  allocating the claimed size first. Deflate expands at most 1032 times, conversion at most 64 times.*/
+  if(w != 0 && h != 0 && (size_t)w * h / h == w)
   {
-    size_t buffersize = lodepng_get_raw_size(w, h, &state.info_raw);
+    buffersize = lodepng_get_raw_size(w, h, state.decoder.color_convert ? &state.info_raw : &state.info_png.color);
+    if(buffersize / 64 / 1032 <= insize)
+    {
+      out.resize(oldsize + buffersize);
+      dest = &out[oldsize];
+    }
+  }
+  error = decodeInto(&buffer, &w, &h, &state, in, insize, dest);
+  if(!dest && buffer && !error)
+  {
+    buffersize = lodepng_get_raw_size(w, h, &state.info_raw);
     out.insert(out.end(), &buffer[0], &buffer[buffersize]);
   }
-  lodepng_free(buffer);
+  if(buffer != dest) lodepng_free(buffer);
+  if(dest && error) out.resize(oldsize);
   return error;
 }
 
@@ -6085,6 +6822,30 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
   return decode(out, w, h, state, in.empty() ? 0 : &in[0], in.size());
 }
 
+unsigned decode(Buffer& out, unsigned& w, unsigned& h, const unsigned char* in,
+                size_t insize, LodePNGColorType colortype, unsigned bitdepth)
+{
+  State state;
+  state.info_raw.colortype = colortype;
+  state.info_raw.bitdepth = bitdepth;
+  return decode(out, w, h, state, in, insize);
+}
+
+unsigned decode(Buffer& out, unsigned& w, unsigned& h,
+                State& state,
+                const unsigned char* in, size_t insize)
+{
+  unsigned char* buffer = NULL;
+  unsigned error = lodepng_decode(&buffer, &w, &h, &state, in, insize);
+  if(error)
+  {
+    lodepng_free(buffer);
+    out.reset();
+  }
+  else out.reset(buffer, lodepng_get_raw_size(w, h, &state.info_raw));
+  return error;
+}
+
 #ifdef LODEPNG_COMPILE_DISK
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h, const std::string& filename,
                 LodePNGColorType colortype, unsigned bitdepth)
@@ -6094,6 +6855,15 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h, const
   if(error) return error;
   return decode(out, w, h, buffer, colortype, bitdepth);
 }
+
+unsigned decode(Buffer& out, unsigned& w, unsigned& h, const std::string& filename,
+                LodePNGColorType colortype, unsigned bitdepth)
+{
+  std::vector<unsigned char> buffer;
+  unsigned error = load_file(buffer, filename);
+  if(error) return error;
+  return decode(out, w, h, buffer.empty() ? 0 : &buffer[0], buffer.size(), colortype, bitdepth);
+}
 #endif /* LODEPNG_COMPILE_DECODER */
 #endif /* LODEPNG_COMPILE_DISK */
 
@@ -6120,6 +6890,17 @@ unsigned encode(std::vector<unsigned char>& out,
   return encode(out, in.empty() ? 0 : &in[0], w, h, colortype, bitdepth);
 }
 
+unsigned encode(Buffer& out, const unsigned char* in, unsigned w, unsigned h,
+                LodePNGColorType colortype, unsigned bitdepth)
+{
+  unsigned char* buffer = NULL;
+  size_t buffersize = 0;
+  unsigned error = lodepng_encode_memory(&buffer, &buffersize, in, w, h, colortype, bitdepth);
+  out.reset(buffer, buffersize);
+  if(error) out.reset();
+  return error;
+}
+
 unsigned encode(std::vector<unsigned char>& out,
                 const unsigned char* in, unsigned w, unsigned h,
                 State& state)
@@ -6143,6 +6924,18 @@ unsigned encode(std::vector<unsigned char>& out,
   return encode(out, in.empty() ? 0 : &in[0], w, h, state);
 }
 
+unsigned encode(Buffer& out,
+                const unsigned char* in, unsigned w, unsigned h,
+                State& state)
+{
+  unsigned char* buffer = NULL;
+  size_t buffersize = 0;
+  unsigned error = lodepng_encode(&buffer, &buffersize, in, w, h, &state);
+  out.reset(buffer, buffersize);
+  if(error) out.reset();
+  return error;
+}
+
 #ifdef LODEPNG_COMPILE_DISK
 unsigned encode(const std::string& filename,
                 const unsigned char* in, unsigned w, unsigned h,
@@ -74,6 +74,10 @@ source files with custom allocators.*/
 #ifndef LODEPNG_NO_COMPILE_ALLOCATORS
 #define LODEPNG_COMPILE_ALLOCATORS
 #endif
+/*per-stage time and byte counters in LodePNGState, see LodePNGProfile. Unlike the sections above this one is off
+unless you define it, e.g. -DLODEPNG_COMPILE_PROFILING for gcc. When off, neither the counters nor the code that
+updates them exist, so it costs nothing.*/
+/*#define LODEPNG_COMPILE_PROFILING*/
 /*compile the C++ version (you can disable the C++ wrapper here even when compiling for C++)*/
 #ifdef __cplusplus
 #ifndef LODEPNG_NO_COMPILE_CPP
@@ -81,6 +85,14 @@ source files with custom allocators.*/
 #endif
 #endif
 
+/*use rvalue references in the C++ wrapper where available: C++11, or Visual Studio 2010 and later, which support
+them without reporting C++11 in __cplusplus*/
+#ifdef LODEPNG_COMPILE_CPP
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+#define LODEPNG_COMPILE_CPP11
+#endif
+#endif
+
 #ifdef LODEPNG_COMPILE_CPP
 #include <vector>
 #include <string>
@@ -198,15 +210,53 @@ unsigned lodepng_encode24_file(const char* filename,
 #ifdef LODEPNG_COMPILE_CPP
 namespace lodepng
 {
+/*
+Owning buffer for the output of the C functions. It adopts the buffer they allocate instead of
+copying it into an std::vector, and frees it like they expect (free, or the lodepng_free of
+LODEPNG_NO_COMPILE_ALLOCATORS builds). It can't be copied: use swap or
+release (or, with C++11, move) to pass the buffer on.
+*/
+class Buffer
+{
+  public:
+    Buffer();
+    ~Buffer();
+#ifdef LODEPNG_COMPILE_CPP11
+    Buffer(Buffer&& other);
+    Buffer& operator=(Buffer&& other);
+#endif /*LODEPNG_COMPILE_CPP11*/
+    unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    unsigned char* begin() const { return data_; }
+    unsigned char* end() const { return data_ + size_; }
+    unsigned char& operator[](size_t i) const { return data_[i]; }
+    /*frees the current buffer and takes ownership of data, which must be allocated like LodePNG's output*/
+    void reset(unsigned char* data = 0, size_t size = 0);
+    /*gives up ownership of the buffer, to be freed by the caller like LodePNG's output*/
+    unsigned char* release();
+    void swap(Buffer& other);
+  private:
+    Buffer(const Buffer&);
+    Buffer& operator=(const Buffer&);
+    unsigned char* data_;
+    size_t size_;
+};
+
 #ifdef LODEPNG_COMPILE_DECODER
 /*Same as lodepng_decode_memory, but decodes to an std::vector. The colortype
-is the format to output the pixels to. Default is RGBA 8-bit per channel.*/
+is the format to output the pixels to. Default is RGBA 8-bit per channel.
+The image is appended to out, and decoded straight into its storage rather than copied there.*/
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 const unsigned char* in, size_t insize,
                 LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8);
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 const std::vector<unsigned char>& in,
                 LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8);
+/*Same as lodepng_decode_memory, out adopts the decoded buffer. Replaces the contents of out.*/
+unsigned decode(Buffer& out, unsigned& w, unsigned& h,
+                const unsigned char* in, size_t insize,
+                LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8);
 #ifdef LODEPNG_COMPILE_DISK
 /*
 Converts PNG file from disk to raw pixel data in memory.
@@ -215,6 +265,9 @@ Same as the other decode functions, but instead takes a filename as input.
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 const std::string& filename,
                 LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8);
+unsigned decode(Buffer& out, unsigned& w, unsigned& h,
+                const std::string& filename,
+                LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8);
 #endif /* LODEPNG_COMPILE_DISK */
 #endif /* LODEPNG_COMPILE_DECODER */
 
@@ -227,6 +280,11 @@ unsigned encode(std::vector<unsigned char>& out,
 unsigned encode(std::vector<unsigned char>& out,
                 const std::vector<unsigned char>& in, unsigned w, unsigned h,
                 LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8);
+/*Same as lodepng_encode_memory, out adopts the encoded buffer. Replaces the contents of out.
+The encoded size isn't known in advance, so this avoids the copy the std::vector version makes.*/
+unsigned encode(Buffer& out,
+                const unsigned char* in, unsigned w, unsigned h,
+                LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8);
 #ifdef LODEPNG_COMPILE_DISK
 /*
 Converts 32-bit RGBA raw pixel data into a PNG file on disk.
@@ -290,6 +348,14 @@ struct LodePNGCompressSettings /*deflate = compress*/
   unsigned minmatch; /*mininum lz77 length. 3 is normally best, 6 can be better for some PNGs. Default: 0*/
   unsigned nicematch; /*stop searching if >= this length found. Set to 258 for best compression. Default: 128*/
   unsigned lazymatching; /*use lazy matching: better compression but a bit slower. Default: true*/
+  /*real-time compression, for screenshots and frame capture: a single block with the fixed Huffman code, with
+  LZ77 matches only for repeats of the previous 4 bytes (a pixel) and for 4-byte sequences found through a small hash
+  table of their last position. Several times faster than btype 1 or 2, for a bigger result. Ignores btype (other
+  than checking it), use_lz77, windowsize, minmatch, nicematch and lazymatching. Best used with LFS_UP. Default: false.
+  Measured on one core with lodepng_benchmark's "encode fast" stage, RGBA in and RGB out, the whole encode runs at
+  about 600 MB/s of input for a 1280x720 rendered frame, and 270 MB/s for a photograph, whose bytes are mostly
+  literals*/
+  unsigned fast;
 
   /*use custom zlib encoder instead of built in one (default: null)*/
   unsigned (*custom_zlib)(unsigned char**, size_t*,
@@ -301,6 +367,10 @@ struct LodePNGCompressSettings /*deflate = compress*/
   unsigned (*custom_deflate)(unsigned char**, size_t*,
                              const unsigned char*, size_t,
                              const LodePNGCompressSettings*);
+  /*optional, called by the built in deflate after every block with the size of the compressed data so far. A
+  nonzero return stops the compression and is returned as its error code, so a caller trying out several settings
+  can give up on one that can no longer beat the best result (default: null)*/
+  unsigned (*cancel)(size_t, const LodePNGCompressSettings*);
 
   const void* custom_context; /*optional custom settings for custom functions*/
 };
@@ -551,7 +621,10 @@ typedef enum LodePNGFilterStrategy
   */
   LFS_BRUTE_FORCE,
   /*use predefined_filters buffer: you specify the filter type for each scanline*/
-  LFS_PREDEFINED
+  LFS_PREDEFINED,
+  /*every filter at Up, which turns areas that repeat the row above into runs of zeroes. The fixed filter of the
+  real-time mode, see LodePNGCompressSettings.fast*/
+  LFS_UP
 } LodePNGFilterStrategy;
 
 /*Gives characteristics about the colors of the image, which helps decide which color model to use for encoding.
@@ -619,6 +692,35 @@ void lodepng_encoder_settings_init(LodePNGEncoderSettings* settings);
 
 #if defined(LODEPNG_COMPILE_DECODER) || defined(LODEPNG_COMPILE_ENCODER)
 /*The settings, state and information for extended encoding and decoding.*/
+#ifdef LODEPNG_COMPILE_PROFILING
+/*The stages of the decoder and encoder that the profiling counters are kept for, and what their bytes count*/
+typedef enum LodePNGProfileStage
+{
+  LPS_CHUNKS = 0, /*decoder: parsing the chunks and gathering the IDAT data, excluding CRC checks. Chunk bytes*/
+  LPS_CRC = 1, /*decoder: checking the chunk CRCs. Bytes checksummed*/
+  LPS_INFLATE = 2, /*decoder: zlib decompression of the IDAT data, including the Adler-32 check. Scanline bytes*/
+  LPS_UNFILTER = 3, /*decoder: unfiltering and removing padding bits. Scanline bytes*/
+  LPS_DEINTERLACE = 4, /*decoder: Adam7 deinterlacing. Image bytes*/
+  LPS_CONVERT = 5, /*decoder and encoder: color conversion from or to info_raw. Output bytes*/
+  LPS_AUTO_CONVERT = 6, /*encoder: choosing the PNG color mode when auto_convert is on. Image bytes*/
+  LPS_INTERLACE = 7, /*encoder: Adam7 interlacing. Image bytes*/
+  LPS_FILTER = 8, /*encoder: adding padding bits, choosing the filters and filtering. Scanline bytes*/
+  LPS_DEFLATE = 9, /*encoder: zlib compression of the scanlines and writing the IDAT chunk. Scanline bytes*/
+  LPS_NUM_STAGES = 10
+} LodePNGProfileStage;
+
+/*
+Where the time of the last lodepng_decode or lodepng_encode with a state went (this includes the C++ functions
+that take a State). Both clear it when they start. Stages that didn't run are 0, and the time spent outside the
+stages (allocation, reading the header, writing the other chunks) isn't counted.
+*/
+typedef struct LodePNGProfile
+{
+  double seconds[LPS_NUM_STAGES]; /*wall clock time per stage*/
+  size_t bytes[LPS_NUM_STAGES]; /*bytes per stage, see LodePNGProfileStage for what they count*/
+} LodePNGProfile;
+#endif /*LODEPNG_COMPILE_PROFILING*/
+
 typedef struct LodePNGState
 {
 #ifdef LODEPNG_COMPILE_DECODER
@@ -630,6 +732,9 @@ typedef struct LodePNGState
   LodePNGColorMode info_raw; /*specifies the format in which you would like to get the raw pixel buffer*/
   LodePNGInfo info_png; /*info of the PNG image obtained after decoding*/
   unsigned error;
+#ifdef LODEPNG_COMPILE_PROFILING
+  LodePNGProfile profile; /*per-stage counters of the last decode or encode*/
+#endif /*LODEPNG_COMPILE_PROFILING*/
 #ifdef LODEPNG_COMPILE_CPP
   /* For the lodepng::State subclass. */
   virtual ~LodePNGState(){}
@@ -788,6 +893,11 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
                          const LodePNGCompressSettings* settings);
 
 #endif /*LODEPNG_COMPILE_ENCODER*/
+
+#ifdef LODEPNG_COMPILE_PROFILING
+/*Adler-32 checksum of the zlib format. Only there with profiling, so a benchmark can time it on its own.*/
+unsigned lodepng_adler32(const unsigned char* data, unsigned len);
+#endif /*LODEPNG_COMPILE_PROFILING*/
 #endif /*LODEPNG_COMPILE_ZLIB*/
 
 #ifdef LODEPNG_COMPILE_DISK
@@ -834,6 +944,9 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 State& state,
                 const std::vector<unsigned char>& in);
+unsigned decode(Buffer& out, unsigned& w, unsigned& h,
+                State& state,
+                const unsigned char* in, size_t insize);
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -844,6 +957,9 @@ unsigned encode(std::vector<unsigned char>& out,
 unsigned encode(std::vector<unsigned char>& out,
                 const std::vector<unsigned char>& in, unsigned w, unsigned h,
                 State& state);
+unsigned encode(Buffer& out,
+                const unsigned char* in, unsigned w, unsigned h,
+                State& state);
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 #ifdef LODEPNG_COMPILE_DISK
@@ -1029,6 +1145,9 @@ using a struct from the C version to avoid exploits and memory leaks.
 
 The C++ version has extra functions with std::vectors in the interface and the
 lodepng::State class which is a LodePNGState with constructor and destructor.
+The std::vector decode functions decode straight into the vector. The
+lodepng::Buffer overloads take over the buffer the C functions allocate, so
+decoding and encoding with them costs no copy either.
 
 These files work without modification for both C and C++ compilers because all
 the additional C++ code is in "#ifdef __cplusplus" blocks that make C-compilers
@@ -1171,6 +1290,10 @@ can encode the colors of all pixels without information loss.
    true for proper compression.
 *) windowsize: the window size used by the LZ77 encoder (1 - 32768). Has value
    2048 by default, but can be set to 32768 for better, but slow, compression.
+*) fast: real-time compression, for capturing frames as they are rendered. Use it
+   together with filter_strategy LFS_UP and auto_convert off: every row gets the
+   Up filter, and the deflate data is a single fixed huffman block with only runs
+   and short LZ77 matches, found without hash chains.
 *) force_palette: if colortype is 2 or 6, you can make the encoder write a PLTE
    chunk if force_palette is true. This can used as suggested palette to convert
    to by viewers that don't support more than 256 colors (if those still exist)
@@ -1457,7 +1580,9 @@ lodepng.h where needed, and your program can read/write PNG files.
 It is compatible with C90 and up, and C++03 and up.
 
 If performance is important, use optimization when compiling! For both the
-encoder and decoder, this makes a large difference.
+encoder and decoder, this makes a large difference. To see which stages of a
+particular image are slow, compile with LODEPNG_COMPILE_PROFILING defined and
+read state.profile after decoding or encoding, see LodePNGProfile.
 
 Make sure that LodePNG is compiled with the same compiler of the same version
 and with the same settings as the rest of the program, or the interfaces with
@@ -1582,7 +1707,9 @@ state.encoder.zlibsettings.windowsize: tweak LZ77 windowsize
 state.encoder.zlibsettings.minmatch: tweak min LZ77 length to match
 state.encoder.zlibsettings.nicematch: tweak LZ77 match where to stop searching
 state.encoder.zlibsettings.lazymatching: try one more LZ77 matching
+state.encoder.zlibsettings.fast: real-time compression, for frame capture, together with LFS_UP
 state.encoder.zlibsettings.custom_...: use custom deflate function
+state.encoder.zlibsettings.cancel: stop an encode that is no longer useful
 state.encoder.auto_convert: choose optimal PNG color type, if 0 uses info_png
 state.encoder.filter_palette_zero: PNG filter strategy for palette
 state.encoder.filter_strategy: PNG filter strategy to encode with
@@ -1596,6 +1723,7 @@ state.info_png.color.colortype: desired color type if auto_convert is false
 state.info_png.color.bitdepth: desired bit depth if auto_convert is false
 state.info_png.color....: more color settings, see struct LodePNGColorMode
 state.info_png....: more PNG related settings, see struct LodePNGInfo
+state.profile: time and bytes per stage of the last decode or encode, only with LODEPNG_COMPILE_PROFILING
 
 
 12. changes
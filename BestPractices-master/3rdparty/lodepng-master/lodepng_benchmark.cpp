@@ -23,12 +23,55 @@ freely, subject to the following restrictions:
     distribution.
 */
 
-//g++ lodepng.cpp lodepng_benchmark.cpp -Wall -Wextra -pedantic -ansi -lSDL -O3
-//g++ lodepng.cpp lodepng_benchmark.cpp -Wall -Wextra -pedantic -ansi -lSDL -O3 && ./a.out
+
+//g++ lodepng.cpp lodepng_benchmark.cpp -Wall -Wextra -pedantic -ansi -O3
+//g++ lodepng.cpp lodepng_benchmark.cpp -Wall -Wextra -pedantic -ansi -O3 && ./a.out -r 9 -json results.json testdata
+//g++ lodepng.cpp lodepng_benchmark.cpp -Wall -Wextra -pedantic -ansi -O3 -DLODEPNG_COMPILE_PROFILING
+
+/*
+Usage: lodepng_benchmark [-v] [-r repetitions] [-json file] [files and directories...]
+
+Every PNG is taken apart into the stages of the codec and each stage is timed on its own. Directories are scanned for
+*.png files, so a whole corpus can be given at once. Without arguments the testdata images and a few synthetic
+patterns are used. "-json -" writes the JSON report to stdout instead of a file.
+
+Stages timed directly:
+decode:   the whole decode to RGBA8
+encode:   the whole encode of the RGBA8 image with the default settings
+encode fast: the whole encode with the real-time settings of frame capture: RGB out, LFS_UP and the fast deflate
+crc:      lodepng_crc32 over every chunk of the file
+inflate:  lodepng_inflate of the IDAT data
+convert:  lodepng_convert from the color mode of the PNG to RGBA8
+Stages timed as the difference of two runs that only differ in that stage:
+adler:    zlib decompression with minus without the Adler-32 check
+unfilter: decode without color conversion and checksums minus zlib decompression (includes Adam7 if interlaced)
+filter:   encode with filter strategy minsum minus filter zero, both with stored deflate blocks
+huffman:  deflate with dynamic Huffman blocks but no LZ77 minus stored blocks
+lz77:     deflate with LZ77 minus without, both with dynamic Huffman blocks
+A difference can be far smaller than the run-to-run noise of the runs it comes from. When it is within the scaled
+median absolute deviation of either run, the stage is reported as noise instead of with a throughput.
+
+Compiled with LODEPNG_COMPILE_PROFILING, adler, unfilter and filter are timed directly instead: adler with
+lodepng_adler32 over the scanlines, unfilter (with Adam7) and filter (with padding bits and choosing the minsum
+filters) with the profiling counters of the same runs as above.
+
+Throughput is in MB/s (10^6 bytes) of the uncompressed side of the stage: the image for pixel stages, the filtered
+scanlines for zlib stages and the file for crc. Cycles are time stamp counter ticks, which run at the nominal and not
+the turbo clock; they are 0 on targets without a time stamp counter.
+
+Every stage runs once to warm up and then the given number of repetitions. Repetitions further than 3 scaled median
+absolute deviations from the median are rejected as outliers and the rest is averaged.
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L //for clock_gettime and opendir with -ansi
+#endif
 
 #include "lodepng.h"
 
+#include <algorithm>
 #include <cmath>
+#include <fstream>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -37,22 +80,43 @@ freely, subject to the following restrictions:
 #include <stdio.h>
 #include <stdlib.h>
 
-#include <SDL/SDL.h> //SDL is used for timing.
-
-#define NUM_DECODE 5 //set to 0 for not benchmarking encoding at all, 1 for normal, higher for decoding multiple times to measure better
-
-double total_dec_time = 0;
-double total_enc_time = 0;
-size_t total_enc_size = 0;
-size_t total_in_size = 0; // This is the uncompressed data in the raw color format
-
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <dirent.h>
+#include <time.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+#endif
+
+int repetitions = 7;
 bool verbose = false;
 
 ////////////////////////////////////////////////////////////////////////////////
 
 double getTime()
 {
-  return SDL_GetTicks() / 1000.0;
+#ifdef _WIN32
+  LARGE_INTEGER t, f;
+  QueryPerformanceCounter(&t);
+  QueryPerformanceFrequency(&f);
+  return (double)t.QuadPart / (double)f.QuadPart;
+#else
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+double getCycles()
+{
+#if (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))) || defined(__i386__) || defined(__x86_64__)
+  return (double)__rdtsc();
+#else
+  return 0;
+#endif
 }
 
 void fail()
@@ -91,80 +155,404 @@ struct Image
   unsigned bitDepth;
 };
 
-//Utility for debug messages
-template<typename T>
-std::string valtostr(const T& val)
+//A PNG and everything prepared from it that the stages take as input
+struct Sample
 {
-  std::ostringstream sstream;
-  sstream << val;
-  return sstream.str();
+  std::string name;
+  std::vector<unsigned char> png;
+  unsigned width;
+  unsigned height;
+  lodepng::State state; //info_png describes the PNG, info_raw is the same color mode
+  std::vector<unsigned char> raw; //the image in the color mode of the PNG
+  std::vector<unsigned char> rgba; //the image as RGBA8
+  std::vector<unsigned char> zlib; //the concatenated IDAT data
+  std::vector<unsigned char> scanlines; //the filtered scanlines the IDAT data decompresses to
+};
+
+//Every stage run allocates and frees its own output, so repeating it never leaks.
+typedef unsigned (*StageFunction)(const Sample& s);
+
+volatile unsigned sink; //keeps results that are otherwise unused from being optimized away
+
+//A run can set this to the seconds of the part of it that is the stage, measure then takes that instead of the run
+double reported = -1;
+
+unsigned runDecode(const Sample& s)
+{
+  unsigned char* out = 0;
+  unsigned w, h;
+  unsigned error = lodepng_decode_memory(&out, &w, &h, &s.png[0], s.png.size(), LCT_RGBA, 8);
+  free(out);
+  return error;
 }
 
-template<typename T>
-void printValue(const std::string& name, const T& value, const std::string& unit = "")
+unsigned runDecodeRaw(const Sample& s)
 {
-  std::cout << name << ": " << value << unit << std::endl;
+  unsigned char* out = 0;
+  unsigned w, h;
+  LodePNGState state;
+  lodepng_state_init(&state);
+  state.decoder.color_convert = 0;
+  state.decoder.ignore_crc = 1;
+  state.decoder.zlibsettings.ignore_adler32 = 1;
+  unsigned error = lodepng_decode(&out, &w, &h, &state, &s.png[0], s.png.size());
+#ifdef LODEPNG_COMPILE_PROFILING
+  reported = state.profile.seconds[LPS_UNFILTER] + state.profile.seconds[LPS_DEINTERLACE];
+#endif
+  lodepng_state_cleanup(&state);
+  free(out);
+  return error;
 }
 
-template<typename T, typename U>
-void printValue(const std::string& name, const T& value, const std::string& s2, const U& value2, const std::string& unit = "")
+unsigned runCrc(const Sample& s)
+{
+  const unsigned char* end = &s.png[0] + s.png.size();
+  const unsigned char* chunk = &s.png[8];
+  unsigned sum = 0;
+  while(chunk + 12 <= end && lodepng_chunk_length(chunk) <= (size_t)(end - chunk) - 12)
+  {
+    sum += lodepng_crc32(chunk + 4, lodepng_chunk_length(chunk) + 4);
+    chunk = lodepng_chunk_next_const(chunk);
+  }
+  sink = sum;
+  return 0;
+}
+
+unsigned runInflate(const Sample& s)
+{
+  unsigned char* out = 0;
+  size_t outsize = 0;
+  //skip the 2 byte zlib header and the 4 byte Adler-32 at the end
+  unsigned error = lodepng_inflate(&out, &outsize, &s.zlib[2], s.zlib.size() - 6, &lodepng_default_decompress_settings);
+  free(out);
+  return error;
+}
+
+unsigned zlibDecompress(const Sample& s, unsigned ignore_adler32)
+{
+  unsigned char* out = 0;
+  size_t outsize = 0;
+  LodePNGDecompressSettings settings = lodepng_default_decompress_settings;
+  settings.ignore_adler32 = ignore_adler32;
+  unsigned error = lodepng_zlib_decompress(&out, &outsize, &s.zlib[0], s.zlib.size(), &settings);
+  free(out);
+  return error;
+}
+
+unsigned runZlib(const Sample& s) { return zlibDecompress(s, 0); }
+unsigned runZlibNoAdler(const Sample& s) { return zlibDecompress(s, 1); }
+
+#ifdef LODEPNG_COMPILE_PROFILING
+unsigned runAdler(const Sample& s)
+{
+  sink = lodepng_adler32(&s.scanlines[0], (unsigned)s.scanlines.size());
+  return 0;
+}
+#endif
+
+unsigned runConvert(const Sample& s)
 {
-  std::cout << name << ": " << value << s2 << value2 << unit << std::endl;
+  LodePNGColorMode rgba;
+  lodepng_color_mode_init(&rgba);
+  unsigned char* out = (unsigned char*)malloc(s.rgba.size());
+  unsigned error = lodepng_convert(out, &s.raw[0], &rgba, &s.state.info_png.color, s.width, s.height);
+  free(out);
+  return error;
 }
 
-//Test LodePNG encoding and decoding the encoded result, using the C interface
-void doCodecTest(Image& image)
+unsigned runEncode(const Sample& s)
+{
+  unsigned char* out = 0;
+  size_t outsize = 0;
+  unsigned error = lodepng_encode_memory(&out, &outsize, &s.rgba[0], s.width, s.height, LCT_RGBA, 8);
+  free(out);
+  return error;
+}
+
+//Encodes with the real-time settings that frame capture uses: RGBA in, RGB out, Up filter and the fast deflate
+unsigned runEncodeFast(const Sample& s)
+{
+  unsigned char* out = 0;
+  size_t outsize = 0;
+  LodePNGState state;
+  lodepng_state_init(&state);
+  state.info_png.color.colortype = LCT_RGB;
+  state.encoder.auto_convert = 0;
+  state.encoder.filter_strategy = LFS_UP;
+  state.encoder.zlibsettings.fast = 1;
+  unsigned error = lodepng_encode(&out, &outsize, &s.rgba[0], s.width, s.height, &state);
+  lodepng_state_cleanup(&state);
+  free(out);
+  return error;
+}
+
+//Encodes the image in its own color mode with stored deflate blocks, so only filtering costs more than a copy
+unsigned encodeStored(const Sample& s, LodePNGFilterStrategy strategy)
+{
+  unsigned char* out = 0;
+  size_t outsize = 0;
+  LodePNGState state;
+  lodepng_state_init(&state);
+  state.encoder.auto_convert = 0;
+  state.encoder.filter_palette_zero = 0;
+  state.encoder.filter_strategy = strategy;
+  state.encoder.zlibsettings.btype = 0;
+  unsigned error = lodepng_color_mode_copy(&state.info_raw, &s.state.info_png.color);
+  if(!error) error = lodepng_color_mode_copy(&state.info_png.color, &s.state.info_png.color);
+  if(!error) error = lodepng_encode(&out, &outsize, &s.raw[0], s.width, s.height, &state);
+#ifdef LODEPNG_COMPILE_PROFILING
+  reported = state.profile.seconds[LPS_FILTER];
+#endif
+  lodepng_state_cleanup(&state);
+  free(out);
+  return error;
+}
+
+unsigned runFilterMinsum(const Sample& s) { return encodeStored(s, LFS_MINSUM); }
+unsigned runFilterZero(const Sample& s) { return encodeStored(s, LFS_ZERO); }
+
+unsigned deflate(const Sample& s, unsigned btype, unsigned use_lz77)
+{
+  unsigned char* out = 0;
+  size_t outsize = 0;
+  LodePNGCompressSettings settings = lodepng_default_compress_settings;
+  settings.btype = btype;
+  settings.use_lz77 = use_lz77;
+  unsigned error = lodepng_deflate(&out, &outsize, &s.scanlines[0], s.scanlines.size(), &settings);
+  free(out);
+  return error;
+}
+
+unsigned runDeflateLZ77(const Sample& s) { return deflate(s, 2, 1); }
+unsigned runDeflateHuffman(const Sample& s) { return deflate(s, 2, 0); }
+unsigned runDeflateStored(const Sample& s) { return deflate(s, 0, 0); }
+
+//Time of one stage, averaged over the repetitions that are not outliers
+struct Timing
+{
+  double seconds;
+  double cycles;
+  unsigned kept; //repetitions left after outlier rejection
+  double deviation; //scaled median absolute deviation of the repetitions in seconds
+  bool noise; //a difference within the deviation of the runs it comes from, the time means nothing
+};
+
+double median(std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+  return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+Timing measure(StageFunction stage, const Sample& s, const std::string& name)
+{
+  assertEquals(0, stage(s), name + " error in " + s.name); //warm up
+
+  std::vector<double> seconds, cycles;
+  for(int i = 0; i < repetitions; i++)
+  {
+    reported = -1;
+    double t0 = getTime();
+    double c0 = getCycles();
+    stage(s);
+    double c1 = getCycles();
+    double t1 = getTime();
+    //the cycles of a reported part are its share of the run's cycles
+    if(reported >= 0) c1 = c0 + (t1 > t0 ? (c1 - c0) * reported / (t1 - t0) : 0);
+    seconds.push_back(reported >= 0 ? reported : t1 - t0);
+    cycles.push_back(c1 - c0);
+  }
+
+  //1.4826 scales the median absolute deviation to the standard deviation of a normal distribution
+  double m = median(seconds);
+  std::vector<double> deviations;
+  for(size_t i = 0; i < seconds.size(); i++) deviations.push_back(std::fabs(seconds[i] - m));
+  double deviation = 1.4826 * median(deviations);
+  double limit = 3 * deviation;
+
+  Timing timing = { 0, 0, 0, deviation, false };
+  for(size_t i = 0; i < seconds.size(); i++)
+  {
+    if(std::fabs(seconds[i] - m) > limit) continue;
+    timing.seconds += seconds[i];
+    timing.cycles += cycles[i];
+    timing.kept++;
+  }
+  timing.seconds /= timing.kept;
+  timing.cycles /= timing.kept;
+  return timing;
+}
+
+//The part of a that b doesn't do. Measurement noise can make the difference of cheap stages negative, or positive
+//but meaningless, so it is flagged as noise when it doesn't stand out from the deviation of either run.
+Timing difference(const Timing& a, const Timing& b)
+{
+  Timing timing;
+  timing.seconds = a.seconds > b.seconds ? a.seconds - b.seconds : 0;
+  timing.cycles = a.cycles > b.cycles ? a.cycles - b.cycles : 0;
+  timing.kept = a.kept < b.kept ? a.kept : b.kept;
+  timing.deviation = a.deviation > b.deviation ? a.deviation : b.deviation;
+  timing.noise = a.seconds - b.seconds <= timing.deviation;
+  return timing;
+}
+
+struct StageResult
+{
+  std::string stage;
+  double bytes; //uncompressed bytes the stage processes
+  Timing timing;
+};
+
+struct SampleResult
 {
-  unsigned char* encoded = 0;
-  size_t encoded_size = 0;
-  unsigned char* decoded = 0;
-  unsigned decoded_w;
-  unsigned decoded_h;
+  std::string name;
+  unsigned width;
+  unsigned height;
+  LodePNGColorType colorType;
+  unsigned bitDepth;
+  unsigned interlace;
+  size_t fileSize;
+  size_t rawSize;
+  std::vector<StageResult> stages;
+};
 
-  double t_enc0 = getTime();
+std::vector<SampleResult> results;
+std::vector<StageResult> totals;
 
-  unsigned error_enc = lodepng_encode_memory(&encoded, &encoded_size, &image.data[0],
-                                             image.width, image.height, image.colorType, image.bitDepth);
+double megabytesPerSecond(const StageResult& r)
+{
+  return r.timing.seconds > 0 ? r.bytes / r.timing.seconds / 1e6 : 0;
+}
 
-  double t_enc1 = getTime();
+double cyclesPerByte(const StageResult& r)
+{
+  return r.bytes > 0 ? r.timing.cycles / r.bytes : 0;
+}
 
-  assertEquals(0, error_enc, "encoder error C");
+void addStage(SampleResult& result, const std::string& stage, double bytes, const Timing& timing)
+{
+  StageResult r;
+  r.stage = stage;
+  r.bytes = bytes;
+  r.timing = timing;
+  result.stages.push_back(r);
+
+  size_t i = 0;
+  while(i < totals.size() && totals[i].stage != stage) i++;
+  if(i == totals.size())
+  {
+    StageResult total;
+    total.stage = stage;
+    total.bytes = 0;
+    Timing zero = { 0, 0, timing.kept, 0, false };
+    total.timing = zero;
+    totals.push_back(total);
+  }
+  totals[i].bytes += bytes;
+  totals[i].timing.seconds += timing.seconds;
+  totals[i].timing.cycles += timing.cycles;
+  if(timing.kept < totals[i].timing.kept) totals[i].timing.kept = timing.kept; //the worst image
+  totals[i].timing.deviation += timing.deviation;
+  if(timing.noise) totals[i].timing.noise = true; //a total with noise in it isn't a throughput either
+}
 
-  double t_dec0 = getTime();
-  for(int i = 0; i < NUM_DECODE; i++)
+void printStages(const std::vector<StageResult>& stages)
+{
+  for(size_t i = 0; i < stages.size(); i++)
   {
-    unsigned error_dec = lodepng_decode_memory(&decoded, &decoded_w, &decoded_h,
-                                               encoded, encoded_size, image.colorType, image.bitDepth);
-    assertEquals(0, error_dec, "decoder error C");
+    const StageResult& r = stages[i];
+    if(r.timing.noise)
+    {
+      printf("  %-11s %10.3f ms   within noise of +-%.3f ms\n", r.stage.c_str(), r.timing.seconds * 1000,
+             r.timing.deviation * 1000);
+      continue;
+    }
+    printf("  %-11s %10.3f ms %10.1f MB/s %8.2f cycles/byte\n", r.stage.c_str(), r.timing.seconds * 1000,
+           megabytesPerSecond(r), cyclesPerByte(r));
   }
-  double t_dec1 = getTime();
+}
 
+//Decodes the PNG in the ways the stages need it and extracts the IDAT data
+unsigned prepareSample(Sample& s)
+{
+  unsigned error = lodepng::decode(s.rgba, s.width, s.height, s.png);
+  if(error) return error;
 
-  assertEquals(image.width, decoded_w);
-  assertEquals(image.height, decoded_h);
+  s.state.decoder.color_convert = 0;
+  error = lodepng::decode(s.raw, s.width, s.height, s.state, s.png);
+  if(error) return error;
 
-  total_enc_size += encoded_size;
-  total_enc_time += (t_enc1 - t_enc0);
-  total_dec_time += (t_dec1 - t_dec0);
-  LodePNGColorMode colormode;
-  colormode.colortype = image.colorType;
-  colormode.bitdepth = image.bitDepth;
-  total_in_size += lodepng_get_raw_size(image.width, image.height, &colormode);
+  const unsigned char* end = &s.png[0] + s.png.size();
+  for(const unsigned char* chunk = &s.png[8]; chunk + 12 <= end; chunk = lodepng_chunk_next_const(chunk))
+  {
+    if(lodepng_chunk_length(chunk) > (size_t)(end - chunk) - 12) break;
+    if(!lodepng_chunk_type_equals(chunk, "IDAT")) continue;
+    const unsigned char* data = lodepng_chunk_data_const(chunk);
+    s.zlib.insert(s.zlib.end(), data, data + lodepng_chunk_length(chunk));
+  }
+  if(s.zlib.size() < 6) return 53; /*same code as the decoder uses for bad zlib data*/
 
-  if(verbose)
+  return lodepng::decompress(s.scanlines, s.zlib);
+}
+
+void benchmark(Sample& s)
+{
+  unsigned error = prepareSample(s);
+  if(error)
   {
-    printValue("encoding time", t_enc1 - t_enc0, "s");
-    std::cout << "compression: " << ((double)(encoded_size) / (double)(image.data.size())) * 100 << "%"
-              << " ratio: " << ((double)(image.data.size()) / (double)(encoded_size))
-              << " size: " << encoded_size << std::endl;
-    if(NUM_DECODE> 0) printValue("decoding time", t_dec1 - t_dec0, "/", NUM_DECODE, " s");
-    std::cout << std::endl;
+    std::cout << "skipping " << s.name << ": " << lodepng_error_text(error) << std::endl;
+    return;
   }
+  if(verbose) std::cout << s.name << " " << s.width << "x" << s.height << ", " << s.png.size() << " bytes" << std::endl;
+
+  double png = s.png.size(), raw = s.raw.size(), rgba = s.rgba.size(), scanlines = s.scanlines.size();
+
+  Timing deflateLZ77 = measure(runDeflateLZ77, s, "deflate");
+  Timing deflateHuffman = measure(runDeflateHuffman, s, "deflate");
+
+  SampleResult result;
+  result.name = s.name;
+  result.width = s.width;
+  result.height = s.height;
+  result.colorType = s.state.info_png.color.colortype;
+  result.bitDepth = s.state.info_png.color.bitdepth;
+  result.interlace = s.state.info_png.interlace_method;
+  result.fileSize = s.png.size();
+  result.rawSize = s.raw.size();
+  addStage(result, "decode", rgba, measure(runDecode, s, "decode"));
+  addStage(result, "encode", rgba, measure(runEncode, s, "encode"));
+  addStage(result, "encode fast", rgba, measure(runEncodeFast, s, "encode"));
+  addStage(result, "crc", png, measure(runCrc, s, "crc"));
+  addStage(result, "inflate", scanlines, measure(runInflate, s, "inflate"));
+#ifdef LODEPNG_COMPILE_PROFILING
+  addStage(result, "adler", scanlines, measure(runAdler, s, "adler"));
+  addStage(result, "unfilter", raw, measure(runDecodeRaw, s, "decode"));
+  addStage(result, "convert", rgba, measure(runConvert, s, "convert"));
+  addStage(result, "filter", raw, measure(runFilterMinsum, s, "encode"));
+#else
+  Timing zlib = measure(runZlib, s, "zlib");
+  Timing zlibNoAdler = measure(runZlibNoAdler, s, "zlib");
+  addStage(result, "adler", scanlines, difference(zlib, zlibNoAdler));
+  addStage(result, "unfilter", raw, difference(measure(runDecodeRaw, s, "decode"), zlibNoAdler));
+  addStage(result, "convert", rgba, measure(runConvert, s, "convert"));
+  addStage(result, "filter", raw, difference(measure(runFilterMinsum, s, "encode"), measure(runFilterZero, s, "encode")));
+#endif
+  addStage(result, "huffman", scanlines, difference(deflateHuffman, measure(runDeflateStored, s, "deflate")));
+  addStage(result, "lz77", scanlines, difference(deflateLZ77, deflateHuffman));
+  results.push_back(result);
+
+  if(verbose) printStages(result.stages);
+}
 
-  //LodePNG_saveFile(encoded, encoded_size, "test.png");
+//Encodes a generated image once and benchmarks the resulting PNG
+void doCodecTest(Image& image, const std::string& name)
+{
+  Sample s;
+  s.name = name;
+  unsigned error = lodepng::encode(s.png, &image.data[0], image.width, image.height, image.colorType, image.bitDepth);
+  assertEquals(0, error, "encoder error C");
 
-  free(encoded);
-  free(decoded);
+  benchmark(s);
 }
 
 static const int IMGSIZE = 4096;
@@ -197,7 +585,7 @@ void testPatternSine()
     image.data[4 * w * y + 4 * x + 3] = (unsigned char)(127 * (1 + std::sin(((w - x - 1) * (w - x - 1) + (h - y - 1) * (h - y - 1)) / (w * h / 8.0))));
   }
 
-  doCodecTest(image);
+  doCodecTest(image, "sine pattern");
 }
 
 void testPatternSineNoAlpha()
@@ -227,7 +615,7 @@ void testPatternSineNoAlpha()
     image.data[3 * w * y + 3 * x + 2] = (unsigned char)(127 * (1 + std::sin((                    x * x + (h - y - 1) * (h - y - 1)) / (w * h / 8.0))));
   }
 
-  doCodecTest(image);
+  doCodecTest(image, "sine w/o alpha pattern");
 }
 
 void testPatternXor()
@@ -250,7 +638,7 @@ void testPatternXor()
     image.data[3 * w * y + 3 * x + 2] = x ^ y;
   }
 
-  doCodecTest(image);
+  doCodecTest(image, "xor pattern");
 }
 
 static unsigned int m_w = 1;
@@ -285,7 +673,7 @@ void testPatternPseudoRan()
     image.data[3 * w * y + 3 * x + 2] = (random >> 16) % 256;
   }
 
-  doCodecTest(image);
+  doCodecTest(image, "pseudorandom pattern");
 }
 
 void testPatternSineXor()
@@ -314,7 +702,7 @@ void testPatternSineXor()
     image.data[4 * w * y + 4 * x + 3] = image.data[4 * w * y + 4 * x + 3] / 2 + ((x ^ y) % 256) / 2;
   }
 
-  doCodecTest(image);
+  doCodecTest(image, "sine+xor pattern");
 }
 
 void testPatternGreyMandel()
@@ -354,7 +742,7 @@ void testPatternGreyMandel()
     image.data[w * y + x] = i % 256;
   }
 
-  doCodecTest(image);
+  doCodecTest(image, "grey mandelbrot pattern");
 }
 
 void testPatternGreyMandelSmall()
@@ -394,7 +782,7 @@ void testPatternGreyMandelSmall()
     image.data[w * y + x] = i % 256;
   }
 
-  doCodecTest(image);
+  doCodecTest(image, "grey mandelbrot small pattern");
 }
 
 void testPatternX()
@@ -415,7 +803,7 @@ void testPatternX()
     image.data[w * y + x + 0] = x % 256;
   }
 
-  doCodecTest(image);
+  doCodecTest(image, "x pattern");
 }
 
 void testPatternY()
@@ -436,19 +824,108 @@ void testPatternY()
     image.data[w * y + x + 0] = y % 256;
   }
 
-  doCodecTest(image);
+  doCodecTest(image, "y pattern");
 }
 
 void testPatternDisk(const std::string& filename)
 {
-  if(verbose) std::cout << "file " << filename << std::endl;
+  Sample s;
+  s.name = filename;
+  if(lodepng::load_file(s.png, filename) || s.png.size() < 8)
+  {
+    std::cout << "skipping " << filename << ": cannot read the file" << std::endl;
+    return;
+  }
 
-  Image image;
-  image.colorType = LCT_RGB;
-  image.bitDepth = 8;
-  lodepng::decode(image.data, image.width, image.height, filename, image.colorType, image.bitDepth);
+  benchmark(s);
+}
 
-  doCodecTest(image);
+bool hasPNGExtension(const std::string& name)
+{
+  if(name.size() < 4) return false;
+  std::string ext = name.substr(name.size() - 4);
+  for(size_t i = 0; i < ext.size(); i++) ext[i] = (char)tolower(ext[i]);
+  return ext == ".png";
+}
+
+//Adds the *.png files in the directory in sorted order, returns false if it isn't a directory
+bool listDirectory(const std::string& dir, std::vector<std::string>& files)
+{
+  std::vector<std::string> names;
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE find = FindFirstFileA((dir + "\\*").c_str(), &data);
+  if(find == INVALID_HANDLE_VALUE) return false;
+  do
+  {
+    if(!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && hasPNGExtension(data.cFileName)) names.push_back(data.cFileName);
+  } while(FindNextFileA(find, &data));
+  FindClose(find);
+#else
+  DIR* d = opendir(dir.c_str());
+  if(!d) return false;
+  while(dirent* entry = readdir(d))
+  {
+    if(hasPNGExtension(entry->d_name)) names.push_back(entry->d_name);
+  }
+  closedir(d);
+#endif
+  std::sort(names.begin(), names.end());
+  for(size_t i = 0; i < names.size(); i++) files.push_back(dir + "/" + names[i]);
+  return true;
+}
+
+std::string jsonString(const std::string& s)
+{
+  std::string result = "\"";
+  for(size_t i = 0; i < s.size(); i++)
+  {
+    unsigned char c = s[i];
+    if(c == '"' || c == '\\') result += '\\';
+    if(c < 32)
+    {
+      char escaped[8];
+      sprintf(escaped, "\\u%04x", c);
+      result += escaped;
+    }
+    else result += (char)c;
+  }
+  return result + "\"";
+}
+
+void writeStagesJSON(std::ostream& out, const std::vector<StageResult>& stages, const std::string& indent)
+{
+  for(size_t i = 0; i < stages.size(); i++)
+  {
+    const StageResult& r = stages[i];
+    out << indent << jsonString(r.stage) << ": {\"ms\": " << r.timing.seconds * 1000;
+    if(r.timing.noise) out << ", \"mbps\": null, \"cycles_per_byte\": null";
+    else out << ", \"mbps\": " << megabytesPerSecond(r) << ", \"cycles_per_byte\": " << cyclesPerByte(r);
+    out << ", \"deviation_ms\": " << r.timing.deviation * 1000 << ", \"noise\": " << (r.timing.noise ? "true" : "false")
+        << ", \"bytes\": " << r.bytes << ", \"kept\": " << r.timing.kept << "}"
+        << (i + 1 < stages.size() ? "," : "") << "\n";
+  }
+}
+
+void writeJSON(std::ostream& out)
+{
+  out.precision(9);
+  out << "{\n  \"repetitions\": " << repetitions << ",\n  \"images\": [\n";
+  for(size_t i = 0; i < results.size(); i++)
+  {
+    const SampleResult& r = results[i];
+    out << "    {\n      \"file\": " << jsonString(r.name) << ",\n"
+        << "      \"width\": " << r.width << ", \"height\": " << r.height
+        << ", \"colortype\": " << r.colorType << ", \"bitdepth\": " << r.bitDepth
+        << ", \"interlace\": " << r.interlace << ",\n"
+        << "      \"file_size\": " << r.fileSize << ", \"raw_size\": " << r.rawSize << ",\n"
+        << "      \"stages\": {\n";
+    writeStagesJSON(out, r.stages, "        ");
+    out << "      }\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ],\n  \"total\": {\n";
+  writeStagesJSON(out, totals, "    ");
+  out << "  }\n}\n";
 }
 
 int main(int argc, char *argv[])
@@ -456,21 +933,27 @@ int main(int argc, char *argv[])
   verbose = false;
 
   std::vector<std::string> files;
+  std::string json;
+  bool inputs = false;
 
   for(int i = 1; i < argc; i++)
   {
     std::string arg = argv[i];
     if(arg == "-v") verbose = true;
-    else files.push_back(arg);
+    else if(arg == "-r" && i + 1 < argc) repetitions = atoi(argv[++i]);
+    else if(arg == "-json" && i + 1 < argc) json = argv[++i];
+    else
+    {
+      if(!listDirectory(arg, files)) files.push_back(arg);
+      inputs = true;
+    }
   }
+  if(repetitions < 1) repetitions = 1;
 
-  std::cout << "NUM_DECODE: " << NUM_DECODE << std::endl;
+  if(json != "-") std::cout << "repetitions: " << repetitions << std::endl;
 
-  if(files.empty())
+  if(!inputs)
   {
-    //testPatternDisk("testdata/frymire.png");
-    //testPatternGreyMandel();
-
     testPatternDisk("testdata/Ecce_homo_by_Hieronymus_Bosch.png");
     testPatternDisk("testdata/ephyse_franco-chon-s-butchery.png");
     testPatternDisk("testdata/jwbalsley_subway-rats.png");
@@ -486,10 +969,6 @@ int main(int argc, char *argv[])
     testPatternGreyMandel();
     //testPatternX();
     //testPatternY();
-    //testPatternDisk("Data/purplesmall.png");
-
-    /*testPatternDisk("testdata/Ecce_homo_by_Hieronymus_Bosch.png");
-    testPatternSine();*/
   }
   else
   {
@@ -499,10 +978,29 @@ int main(int argc, char *argv[])
     }
   }
 
-  std::cout << "Total decoding time: " << total_dec_time/NUM_DECODE << "s" << std::endl;
-  std::cout << "Total encoding time: " << total_enc_time << "s" << std::endl;
+  if(json == "-")
+  {
+    writeJSON(std::cout);
+    return 0;
+  }
+
+  size_t total_in_size = 0, total_enc_size = 0;
+  for(size_t i = 0; i < results.size(); i++)
+  {
+    total_in_size += results[i].rawSize;
+    total_enc_size += results[i].fileSize;
+  }
+  std::cout << "Images: " << results.size() << std::endl;
   std::cout << "Total input size  : " << total_in_size << std::endl;
   std::cout << "Total encoded size: " << total_enc_size << std::endl;
+  printStages(totals);
+
+  if(!json.empty())
+  {
+    std::ofstream out(json.c_str());
+    writeJSON(out);
+    if(!out) std::cout << "cannot write " << json << std::endl;
+  }
 
   if(verbose) std::cout << "benchmark done" << std::endl;
 }
@@ -1361,6 +1361,33 @@ void testCustomDeflate()
   ASSERT_EQUALS(5555, error);
 }
 
+//the cancel callback sees the output grow block by block, and its error code stops the encoder
+void testCancelCompression()
+{
+  std::cout << "testCancelCompression" << std::endl;
+  std::vector<unsigned char> data(1000000);
+  for(size_t i = 0; i < data.size(); i++) data[i] = (unsigned char)((i * i) >> 7);
+
+  struct TestFun {
+    static unsigned cancel(size_t outsize, const LodePNGCompressSettings* settings)
+    {
+      std::vector<size_t>& sizes = *(std::vector<size_t>*)(settings->custom_context);
+      if(!sizes.empty()) ASSERT_EQUALS(true, outsize > sizes.back());
+      sizes.push_back(outsize);
+      return sizes.size() == 3 ? 6666 : 0;
+    }
+  };
+
+  std::vector<size_t> sizes;
+  LodePNGCompressSettings settings;
+  lodepng_compress_settings_init(&settings);
+  settings.cancel = TestFun::cancel;
+  settings.custom_context = &sizes;
+  std::vector<unsigned char> compressed;
+  ASSERT_EQUALS(6666, lodepng::compress(compressed, data, settings));
+  ASSERT_EQUALS(3, sizes.size());
+}
+
 void testCustomZlibDecompress()
 {
   std::cout << "testCustomZlibDecompress" << std::endl;
@@ -1577,6 +1604,203 @@ void testChunkUtil()
   assertNoPNGError(lodepng::decode(image, w, h, png));
 }
 
+void testHighPrecisionDecode()
+{
+  std::cout << "testHighPrecisionDecode" << std::endl;
+  //8-bit: the extremes and 128, which sRGB decodes to 0.2158605
+  unsigned char rgba8[8] = { 0, 128, 255, 128, 255, 0, 128, 0 };
+  std::vector<unsigned char> png;
+  assertNoPNGError(lodepng::encode(png, rgba8, 2, 1));
+  std::vector<unsigned short> rgba16, half;
+  std::vector<float> rgba32f;
+  unsigned w, h;
+  assertNoPNGError(lodepng::decodeRGBA16(rgba16, w, h, png));
+  ASSERT_EQUALS(8, rgba16.size());
+  for(size_t i = 0; i < 8; i++) ASSERT_EQUALS(rgba8[i] * 257, rgba16[i]);
+  assertNoPNGError(lodepng::decodeRGBA32F(rgba32f, w, h, png, true));
+  ASSERT_EQUALS(true, std::fabs(0.2158605 - rgba32f[1]) < 1e-6);
+  ASSERT_EQUALS(true, std::fabs(128 / 255.0 - rgba32f[3]) < 1e-6); //alpha stays linear
+  ASSERT_EQUALS(true, std::fabs(1.0 - rgba32f[4]) < 1e-6);
+  assertNoPNGError(lodepng::decodeRGBA16F(half, w, h, png));
+  ASSERT_EQUALS(0x0000, half[0]);
+  ASSERT_EQUALS(0x3c00, half[2]);
+  ASSERT_EQUALS(0x3804, half[1]); //128 / 255 = 0.50196 rounds to 0.50195
+
+  //16-bit: 1 is a subnormal half float, 0x8000 rounds to 0.5
+  unsigned char rgba16be[8] = { 0, 1, 0x80, 0, 0xff, 0xff, 0x12, 0x34 };
+  png.clear();
+  assertNoPNGError(lodepng::encode(png, rgba16be, 1, 1, LCT_RGBA, 16));
+  assertNoPNGError(lodepng::decodeRGBA16(rgba16, w, h, png));
+  ASSERT_EQUALS(1, rgba16[0]);
+  ASSERT_EQUALS(0x8000, rgba16[1]);
+  ASSERT_EQUALS(0x1234, rgba16[3]);
+  assertNoPNGError(lodepng::decodeRGBA16F(half, w, h, png));
+  ASSERT_EQUALS(0x0100, half[0]);
+  ASSERT_EQUALS(0x3800, half[1]);
+  ASSERT_EQUALS(0x3c00, half[2]);
+  assertNoPNGError(lodepng::decodeRGBA32F(rgba32f, w, h, png));
+  ASSERT_EQUALS(true, std::fabs(0x1234 / 65535.0 - rgba32f[3]) < 1e-7);
+}
+
+//runs the tasks backwards, to check that the quantizer doesn't depend on their order
+void reverseTasks(void (*task)(void*, size_t), void* context, size_t count, const lodepng::QuantizeSettings* settings)
+{
+  (*(size_t*)settings->custom_context) += count;
+  for(size_t i = count; i > 0; i--) task(context, i - 1);
+}
+
+void testQuantize()
+{
+  std::cout << "testQuantize" << std::endl;
+  //a few colors are kept exactly
+  unsigned char few[16] = { 255, 0, 0, 255, 0, 0, 0, 0, 255, 0, 0, 255, 10, 20, 30, 40 };
+  std::vector<unsigned char> palette, indices;
+  assertNoPNGError(lodepng::quantize(palette, indices, few, 2, 2));
+  ASSERT_EQUALS(12, palette.size());
+  for(size_t i = 0; i < 4; i++)
+  {
+    for(size_t c = 0; c < 4; c++) ASSERT_EQUALS(few[i * 4 + c], palette[indices[i] * 4 + c]);
+  }
+
+  //a gradient of 4096 colors to 16
+  unsigned w = 64, h = 64;
+  std::vector<unsigned char> image(w * h * 4);
+  for(size_t i = 0; i < w * h; i++)
+  {
+    image[i * 4 + 0] = (unsigned char)((i % w) * 4);
+    image[i * 4 + 1] = (unsigned char)((i / w) * 4);
+    image[i * 4 + 2] = 128;
+    image[i * 4 + 3] = 255;
+  }
+  lodepng::QuantizeSettings settings;
+  settings.max_colors = 16;
+  for(int dither = 0; dither < 2; dither++)
+  {
+    settings.dither = dither != 0;
+    settings.custom_parallel = 0;
+    assertNoPNGError(lodepng::quantize(palette, indices, &image[0], w, h, settings));
+    std::vector<unsigned char> serial = indices;
+
+    size_t tasks = 0;
+    settings.custom_parallel = reverseTasks;
+    settings.custom_context = &tasks;
+    std::vector<unsigned char> png, decoded;
+    assertNoPNGError(lodepng::encodeQuantized(png, &image[0], w, h, settings));
+    ASSERT_EQUALS(true, tasks > 0);
+
+    lodepng::State state;
+    unsigned w2, h2;
+    assertNoPNGError(lodepng::decode(decoded, w2, h2, state, png));
+    ASSERT_EQUALS(LCT_PALETTE, state.info_png.color.colortype);
+    ASSERT_EQUALS(4, state.info_png.color.bitdepth);
+    ASSERT_EQUALS(16, state.info_png.color.palettesize);
+    std::vector<unsigned char> decodedIndices;
+    state.decoder.color_convert = 0;
+    assertNoPNGError(lodepng::decode(decodedIndices, w2, h2, state, png));
+    for(size_t i = 0; i < w * h; i++) ASSERT_EQUALS(serial[i], (decodedIndices[i / 2] >> (i % 2 ? 0 : 4)) & 15);
+
+    //16 colors for a 64x64 gradient leave an average error of a few steps per channel
+    double error = 0;
+    for(size_t i = 0; i < image.size(); i++) error += std::fabs((double)decoded[i] - image[i]);
+    ASSERT_EQUALS(true, error / image.size() < 12);
+  }
+
+  settings.max_colors = 0;
+  ASSERT_EQUALS(103, lodepng::quantize(palette, indices, &image[0], w, h, settings));
+}
+
+void testAPNG()
+{
+  std::cout << "testAPNG" << std::endl;
+  //4x3 frames: the second changes one pixel, the third equals the second, the fourth changes two corners
+  unsigned w = 4, h = 3;
+  std::vector<std::vector<unsigned char> > frames(4, std::vector<unsigned char>(w * h * 4));
+  for(size_t i = 0; i < frames[0].size(); i++) frames[0][i] = (unsigned char)(i * 7 % 256);
+  frames[1] = frames[0];
+  frames[1][(1 * w + 2) * 4 + 1] ^= 255;
+  frames[2] = frames[1];
+  frames[3] = frames[2];
+  frames[3][0] ^= 255;
+  frames[3][(2 * w + 3) * 4 + 3] ^= 255;
+
+  unsigned x, y, rw, rh;
+  ASSERT_EQUALS(true, lodepng::getDirtyRect(x, y, rw, rh, &frames[0][0], &frames[1][0], w, h));
+  ASSERT_EQUALS(2, x); ASSERT_EQUALS(1, y); ASSERT_EQUALS(1, rw); ASSERT_EQUALS(1, rh);
+  ASSERT_EQUALS(false, lodepng::getDirtyRect(x, y, rw, rh, &frames[1][0], &frames[2][0], w, h));
+
+  std::vector<unsigned char> png;
+  assertNoPNGError(lodepng::encodeAPNG(png, frames, w, h, 1, 10));
+
+  //a decoder that doesn't know APNG shows the first frame
+  std::vector<unsigned char> image;
+  unsigned w2, h2;
+  assertNoPNGError(lodepng::decode(image, w2, h2, png));
+  ASSERT_EQUALS(true, image == frames[0]);
+
+  lodepng::APNGDecoder decoder;
+  lodepng::APNGFrame frame;
+  assertNoPNGError(decoder.open(png));
+  ASSERT_EQUALS(3, decoder.num_frames);
+  ASSERT_EQUALS(false, decoder.default_image_hidden);
+  assertNoPNGError(decoder.next(frame));
+  ASSERT_EQUALS(w, frame.width);
+  ASSERT_EQUALS(true, decoder.canvas == frames[0]);
+  assertNoPNGError(decoder.next(frame));
+  ASSERT_EQUALS(2, frame.x_offset); ASSERT_EQUALS(1, frame.y_offset);
+  ASSERT_EQUALS(1, frame.width); ASSERT_EQUALS(1, frame.height);
+  ASSERT_EQUALS(2, frame.delay_num); //the equal third frame is merged into this one
+  ASSERT_EQUALS(2, decoder.dirty_x); ASSERT_EQUALS(1, decoder.dirty_width);
+  ASSERT_EQUALS(true, decoder.canvas == frames[1]);
+  assertNoPNGError(decoder.next(frame));
+  ASSERT_EQUALS(w, frame.width); ASSERT_EQUALS(h, frame.height);
+  ASSERT_EQUALS(true, decoder.canvas == frames[3]);
+  ASSERT_EQUALS(true, decoder.done());
+  ASSERT_EQUALS(102, decoder.next(frame));
+
+  //blend and dispose ops: a half transparent blue pixel over red, restored by the next frame
+  unsigned char red[16] = { 255,0,0,255, 255,0,0,255, 255,0,0,255, 255,0,0,255 };
+  unsigned char blue[4] = { 0,0,255,128 };
+  unsigned char green[4] = { 0,255,0,255 };
+  std::vector<unsigned char> p0, p1, p2;
+  lodepng::State state;
+  state.info_png.color.colortype = LCT_RGBA;
+  state.encoder.auto_convert = 0;
+  assertNoPNGError(lodepng::encode(p0, red, 2, 2, state));
+  assertNoPNGError(lodepng::encode(p1, blue, 1, 1, state));
+  assertNoPNGError(lodepng::encode(p2, green, 1, 1, state));
+  lodepng::APNGBuilder builder;
+  lodepng::APNGFrameControl control;
+  control.width = control.height = 2;
+  assertNoPNGError(builder.add(control, p0));
+  control.x_offset = control.y_offset = 1;
+  control.width = control.height = 1;
+  control.blend_op = lodepng::APNG_BLEND_OVER;
+  control.dispose_op = lodepng::APNG_DISPOSE_PREVIOUS;
+  assertNoPNGError(builder.add(control, p1));
+  control.x_offset = control.y_offset = 0;
+  control.blend_op = lodepng::APNG_BLEND_SOURCE;
+  control.dispose_op = lodepng::APNG_DISPOSE_NONE;
+  assertNoPNGError(builder.add(control, p2));
+  control.x_offset = 2; //outside of the canvas
+  ASSERT_EQUALS(97, builder.add(control, p2));
+  png.clear();
+  assertNoPNGError(builder.finish(png));
+
+  assertNoPNGError(decoder.open(png));
+  ASSERT_EQUALS(3, decoder.num_frames);
+  assertNoPNGError(decoder.next(frame));
+  assertNoPNGError(decoder.next(frame));
+  ASSERT_EQUALS(127, decoder.canvas[12]);
+  ASSERT_EQUALS(128, decoder.canvas[14]);
+  ASSERT_EQUALS(255, decoder.canvas[15]);
+  assertNoPNGError(decoder.next(frame));
+  ASSERT_EQUALS(255, decoder.canvas[12]);
+  ASSERT_EQUALS(0, decoder.canvas[14]);
+  ASSERT_EQUALS(255, decoder.canvas[1]);
+  //the restored pixel and the new frame
+  ASSERT_EQUALS(0, decoder.dirty_x); ASSERT_EQUALS(2, decoder.dirty_width); ASSERT_EQUALS(2, decoder.dirty_height);
+}
+
 //Test that when decoding to 16-bit per channel, it always uses big endian consistently.
 //It should always output big endian, the convention used inside of PNG, even though x86 CPU's are little endian.
 void test16bitColorEndianness()
@@ -1672,6 +1896,38 @@ void testPredefinedFilters() {
   for(size_t i = 0; i < h; i++) ASSERT_EQUALS(3, outfilters[i]);
 }
 
+//Real-time encoding: fixed Up filter and the fast deflate, with runs, repeats, noise and a tail that isn't whole pixels
+void testFastEncode() {
+  std::cout << "testFastEncode" << std::endl;
+  for(int channels = 3; channels <= 4; channels++) {
+    unsigned w = 257, h = 40;
+    std::vector<unsigned char> image(w * h * 4, 0);
+    for(size_t i = 0; i < image.size(); i++) {
+      if(i % 4 == 3) image[i] = 255;
+      else if(i < image.size() / 4) image[i] = (unsigned char)(i * 7 / 4); //gradients
+      else if(i < image.size() / 2) image[i] = (unsigned char)((i / 64) % 3 * 100); //long runs
+      else image[i] = (unsigned char)(rand() % 256);
+    }
+
+    lodepng::State state;
+    state.info_png.color.colortype = channels == 3 ? LCT_RGB : LCT_RGBA;
+    state.encoder.auto_convert = 0;
+    state.encoder.filter_strategy = LFS_UP;
+    state.encoder.zlibsettings.fast = 1;
+    std::vector<unsigned char> png;
+    assertNoPNGError(lodepng::encode(png, &image[0], w, h, state));
+
+    std::vector<unsigned char> filters;
+    assertNoPNGError(lodepng::getFilterTypes(filters, png));
+    for(size_t i = 0; i < h; i++) ASSERT_EQUALS(2, filters[i]);
+
+    std::vector<unsigned char> decoded;
+    unsigned w2, h2;
+    assertNoPNGError(lodepng::decode(decoded, w2, h2, png));
+    ASSERT_EQUALS(true, decoded == image);
+  }
+}
+
 void testWrongWindowSizeGivesError() {
   std::vector<unsigned char> png;
   unsigned w = 32, h = 32;
@@ -1907,6 +2163,192 @@ void testPaletteToPaletteDecode2() {
   free(image2);
 }
 
+//the Buffer overloads adopt the C buffers, the std::vector decode appends to what is already there
+void testBufferCodec()
+{
+  std::cout << "testBufferCodec" << std::endl;
+  unsigned error;
+  unsigned w = 13, h = 7;
+  std::vector<unsigned char> image(w * h * 4);
+  for(size_t i = 0; i < image.size(); i++) image[i] = (unsigned char)(i * 7 + (i >> 3));
+
+  lodepng::Buffer png;
+  error = lodepng::encode(png, &image[0], w, h);
+  assertNoPNGError(error);
+  ASSERT_EQUALS(false, png.empty());
+  std::vector<unsigned char> png2;
+  error = lodepng::encode(png2, image, w, h);
+  assertNoPNGError(error);
+  ASSERT_EQUALS(png2.size(), png.size());
+
+  lodepng::Buffer image2;
+  unsigned w2, h2;
+  error = lodepng::decode(image2, w2, h2, png.data(), png.size());
+  assertNoPNGError(error);
+  ASSERT_EQUALS(w, w2);
+  ASSERT_EQUALS(h, h2);
+  ASSERT_EQUALS(image.size(), image2.size());
+  for(size_t i = 0; i < image.size(); i++) ASSERT_EQUALS((int)image[i], (int)image2[i]);
+
+  //decoded with conversion to RGB, after existing contents
+  std::vector<unsigned char> image3(5, 42);
+  error = lodepng::decode(image3, w2, h2, png.data(), png.size(), LCT_RGB, 8);
+  assertNoPNGError(error);
+  ASSERT_EQUALS(5 + w * h * 3, image3.size());
+  ASSERT_EQUALS(42, image3[4]);
+  for(size_t i = 0; i < w * h; i++) ASSERT_EQUALS((int)image[i * 4 + 2], (int)image3[5 + i * 3 + 2]);
+
+  //a failed decode leaves the vector as it was and empties the buffer
+  png[png.size() - 1] ^= 1; //IEND CRC
+  error = lodepng::decode(image3, w2, h2, png.data(), png.size());
+  ASSERT_EQUALS(true, error != 0);
+  ASSERT_EQUALS(5 + w * h * 3, image3.size());
+  error = lodepng::decode(image2, w2, h2, png.data(), png.size());
+  ASSERT_EQUALS(true, error != 0);
+  ASSERT_EQUALS(true, image2.empty());
+
+  //a tRNS color key is only known after decoding has started into the output, which is then converted from a copy
+  lodepng::State keyed;
+  keyed.encoder.auto_convert = 0;
+  keyed.info_raw.colortype = keyed.info_png.color.colortype = LCT_RGB;
+  keyed.info_png.color.key_defined = 1;
+  keyed.info_png.color.key_r = image[0];
+  keyed.info_png.color.key_g = image[1];
+  keyed.info_png.color.key_b = image[2];
+  std::vector<unsigned char> rgb(w * h * 3), keypng, image4(3, 42);
+  for(size_t i = 0; i < w * h * 3; i++) rgb[i] = image[i / 3 * 4 + i % 3];
+  assertNoPNGError(lodepng::encode(keypng, rgb, w, h, keyed));
+  error = lodepng::decode(image4, w2, h2, keypng, LCT_RGB, 8);
+  assertNoPNGError(error);
+  ASSERT_EQUALS(3 + rgb.size(), image4.size());
+  for(size_t i = 0; i < rgb.size(); i++) ASSERT_EQUALS((int)rgb[i], (int)image4[3 + i]);
+  lodepng::Buffer image5;
+  error = lodepng::decode(image5, w2, h2, &keypng[0], keypng.size(), LCT_RGB, 8);
+  assertNoPNGError(error);
+  ASSERT_EQUALS(rgb.size(), image5.size());
+  for(size_t i = 0; i < rgb.size(); i++) ASSERT_EQUALS((int)rgb[i], (int)image5.data()[i]);
+
+  //ownership passes with release and swap
+  lodepng::Buffer other;
+  other.swap(png);
+  ASSERT_EQUALS(true, png.empty());
+  unsigned char* released = other.release();
+  ASSERT_EQUALS(true, other.empty());
+  free(released);
+}
+
+//Interlaced round trip in every whole byte color mode, at the small sizes where Adam7 passes are empty
+void testAdam7Bytewidths()
+{
+  std::cout << "testAdam7Bytewidths" << std::endl;
+  const LodePNGColorType types[] = { LCT_GREY, LCT_GREY_ALPHA, LCT_RGB, LCT_RGBA };
+  for(unsigned bitdepth = 8; bitdepth <= 16; bitdepth += 8)
+  for(size_t t = 0; t < 4; t++)
+  for(unsigned w = 1; w <= 11; w += 2)
+  for(unsigned h = 1; h <= 10; h += 3)
+  {
+    lodepng::State state;
+    state.encoder.auto_convert = 0;
+    state.info_png.interlace_method = 1;
+    state.info_png.color.colortype = state.info_raw.colortype = types[t];
+    state.info_png.color.bitdepth = state.info_raw.bitdepth = bitdepth;
+    std::vector<unsigned char> image(lodepng_get_raw_size(w, h, &state.info_raw));
+    for(size_t i = 0; i < image.size(); i++) image[i] = (unsigned char)(i * 31 + 7);
+
+    std::vector<unsigned char> png, decoded;
+    unsigned w2, h2;
+    assertNoPNGError(lodepng::encode(png, image, w, h, state));
+    state.decoder.color_convert = 0;
+    assertNoPNGError(lodepng::decode(decoded, w2, h2, state, png));
+    ASSERT_EQUALS(1, state.info_png.interlace_method);
+    ASSERT_EQUALS(image.size(), decoded.size());
+    for(size_t i = 0; i < image.size(); i++) ASSERT_EQUALS((int)image[i], (int)decoded[i]);
+  }
+}
+
+//Grey and palette images below 8 bit at widths that need padding bits, decoded as is and to RGBA
+void testLowBitDepthUnpack()
+{
+  std::cout << "testLowBitDepthUnpack" << std::endl;
+  for(unsigned bitdepth = 1; bitdepth <= 4; bitdepth *= 2)
+  for(unsigned palette = 0; palette <= 1; palette++)
+  for(unsigned interlace = 0; interlace <= 1; interlace++)
+  for(unsigned w = 1; w <= 13; w += 3)
+  {
+    unsigned h = 5, mask = (1u << bitdepth) - 1u;
+    lodepng::State state;
+    state.encoder.auto_convert = 0;
+    state.info_png.interlace_method = interlace;
+    state.info_png.color.colortype = state.info_raw.colortype = palette ? LCT_PALETTE : LCT_GREY;
+    state.info_png.color.bitdepth = state.info_raw.bitdepth = bitdepth;
+    for(unsigned i = 0; palette && i <= mask; i++)
+    {
+      lodepng_palette_add(&state.info_png.color, i * 40, 255 - i, i * 7, 200);
+      lodepng_palette_add(&state.info_raw, i * 40, 255 - i, i * 7, 200);
+    }
+    std::vector<unsigned char> image(lodepng_get_raw_size(w, h, &state.info_raw));
+    for(size_t i = 0; i < image.size(); i++) image[i] = (unsigned char)(i * 73 + 11);
+    //the bits after the last pixel aren't part of the image
+    unsigned rest = (w * h * bitdepth) % 8;
+    if(rest) image.back() &= (unsigned char)(0xff00u >> rest);
+
+    std::vector<unsigned char> png, raw, rgba;
+    unsigned w2, h2;
+    assertNoPNGError(lodepng::encode(png, image, w, h, state));
+    state.decoder.color_convert = 0;
+    assertNoPNGError(lodepng::decode(raw, w2, h2, state, png));
+    ASSERT_EQUALS(image.size(), raw.size());
+    for(size_t i = 0; i < image.size(); i++) ASSERT_EQUALS((int)image[i], (int)raw[i]);
+
+    assertNoPNGError(lodepng::decode(rgba, w2, h2, png));
+    for(size_t i = 0; i < w * h; i++)
+    {
+      unsigned value = (image[i * bitdepth / 8] >> (8 - bitdepth - i * bitdepth % 8)) & mask;
+      ASSERT_EQUALS(palette ? value * 40 % 256 : value * 255 / mask, rgba[i * 4 + 0]);
+      ASSERT_EQUALS(palette ? 200 : 255, rgba[i * 4 + 3]);
+    }
+  }
+}
+
+#ifdef LODEPNG_COMPILE_PROFILING
+void testProfile()
+{
+  std::cout << "testProfile" << std::endl;
+  unsigned error;
+  unsigned w = 21, h = 9;
+  std::vector<unsigned char> image(w * h * 4);
+  for(size_t i = 0; i < image.size(); i++) image[i] = (unsigned char)(i * 13 + (i >> 5));
+
+  lodepng::State state;
+  state.info_png.interlace_method = 1;
+  std::vector<unsigned char> png;
+  error = lodepng::encode(png, image, w, h, state);
+  assertNoPNGError(error);
+  ASSERT_EQUALS(w * h * 4, state.profile.bytes[LPS_AUTO_CONVERT]);
+  ASSERT_EQUALS(w * h * 4, state.profile.bytes[LPS_INTERLACE]);
+  ASSERT_EQUALS(state.profile.bytes[LPS_FILTER], state.profile.bytes[LPS_DEFLATE]);
+  ASSERT_EQUALS(0, state.profile.bytes[LPS_INFLATE]);
+
+  //decoding clears the encoder counters
+  lodepng::State state2;
+  std::vector<unsigned char> image2;
+  unsigned w2, h2;
+  error = lodepng::decode(image2, w2, h2, state2, png);
+  assertNoPNGError(error);
+  ASSERT_EQUALS(png.size() - 8, state2.profile.bytes[LPS_CHUNKS] + 13 + 12);
+  ASSERT_EQUALS(state.profile.bytes[LPS_DEFLATE], state2.profile.bytes[LPS_INFLATE]);
+  ASSERT_EQUALS(state2.profile.bytes[LPS_INFLATE], state2.profile.bytes[LPS_UNFILTER]);
+  ASSERT_EQUALS(w * h * 4, state2.profile.bytes[LPS_DEINTERLACE]);
+  ASSERT_EQUALS(0, state2.profile.bytes[LPS_CONVERT]);
+  ASSERT_EQUALS(true, state2.profile.bytes[LPS_CRC] > 0);
+  state2.info_raw.colortype = LCT_RGB;
+  error = lodepng::decode(image2, w2, h2, state2, png);
+  assertNoPNGError(error);
+  ASSERT_EQUALS(w * h * 3, state2.profile.bytes[LPS_CONVERT]);
+  ASSERT_EQUALS(0, state2.profile.bytes[LPS_FILTER]);
+}
+#endif /*LODEPNG_COMPILE_PROFILING*/
+
 void doMain()
 {
   //PNG
@@ -1915,10 +2357,17 @@ void doMain()
   testPaletteFilterTypesZero();
   testComplexPNG();
   testPredefinedFilters();
+  testFastEncode();
   testFuzzing();
   testWrongWindowSizeGivesError();
   testPaletteToPaletteDecode();
   testPaletteToPaletteDecode2();
+  testBufferCodec();
+  testAdam7Bytewidths();
+  testLowBitDepthUnpack();
+#ifdef LODEPNG_COMPILE_PROFILING
+  testProfile();
+#endif /*LODEPNG_COMPILE_PROFILING*/
 
   //Colors
   testColorKeyConvert();
@@ -1936,11 +2385,15 @@ void doMain()
   testCustomZlibCompress();
   testCustomZlibCompress2();
   testCustomDeflate();
+  testCancelCompression();
   testCustomZlibDecompress();
   testCustomInflate();
 
   //lodepng_util
   testChunkUtil();
+  testHighPrecisionDecode();
+  testAPNG();
+  testQuantize();
 
   std::cout << "\ntest successful" << std::endl;
 }
@@ -24,6 +24,9 @@ freely, subject to the following restrictions:
 */
 
 #include "lodepng_util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 namespace lodepng
@@ -285,6 +288,1025 @@ int getPaletteValue(const unsigned char* data, size_t i, int bits)
   else return 0;
 }
 
+//Decodes to RGBA with 8 bits per channel, or 16 for 16-bit PNGs, the bit depth the conversion tables are made for
+static unsigned decodeRGBA(std::vector<unsigned char>& image, unsigned& bitdepth, unsigned& w, unsigned& h,
+                           const std::vector<unsigned char>& png)
+{
+  if(png.empty()) return 48; //empty input buffer
+  lodepng::State state;
+  unsigned error = lodepng_inspect(&w, &h, &state, &png[0], png.size());
+  if(error) return error;
+  bitdepth = state.info_png.color.bitdepth == 16 ? 16 : 8;
+  return lodepng::decode(image, w, h, png, LCT_RGBA, bitdepth);
+}
+
+//Looks up every channel of the 8 or 16-bit RGBA image in the tables, color for R, G and B, alpha for A
+template<typename T>
+static void convertRGBA(std::vector<T>& out, const std::vector<unsigned char>& image, unsigned bitdepth,
+                        const std::vector<T>& color, const std::vector<T>& alpha)
+{
+  size_t n = image.size() / (bitdepth / 8);
+  out.resize(n);
+  if(bitdepth == 8)
+  {
+    for(size_t i = 0; i < n; i += 4)
+    {
+      out[i + 0] = color[image[i + 0]];
+      out[i + 1] = color[image[i + 1]];
+      out[i + 2] = color[image[i + 2]];
+      out[i + 3] = alpha[image[i + 3]];
+    }
+  }
+  else
+  {
+    for(size_t i = 0; i < n; i += 4)
+    {
+      const unsigned char* p = &image[i * 2];
+      out[i + 0] = color[256u * p[0] + p[1]];
+      out[i + 1] = color[256u * p[2] + p[3]];
+      out[i + 2] = color[256u * p[4] + p[5]];
+      out[i + 3] = alpha[256u * p[6] + p[7]];
+    }
+  }
+}
+
+//The values of a channel with the bit depth as floats from 0 to 1, sRGB decoded if srgb is true
+static void makeFloatTable(std::vector<float>& table, unsigned bitdepth, bool srgb)
+{
+  table.resize(1u << bitdepth);
+  double highest = (double)(table.size() - 1);
+  for(size_t i = 0; i < table.size(); i++)
+  {
+    double c = i / highest;
+    if(srgb) c = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+    table[i] = (float)c;
+  }
+}
+
+//Converts to a half float with round to nearest even, including subnormals
+static unsigned short floatToHalf(float f)
+{
+  unsigned bits;
+  memcpy(&bits, &f, sizeof(bits));
+  unsigned sign = (bits >> 16) & 0x8000u;
+  int exponent = (int)((bits >> 23) & 255) - 127 + 15;
+  unsigned mantissa = bits & 0x7fffffu;
+  if(exponent >= 31) return (unsigned short)(sign | 0x7c00u); //too large for a half float: infinity
+  unsigned shift = 13;
+  if(exponent <= 0)
+  {
+    if(exponent < -10) return (unsigned short)sign; //too small even for a subnormal half float
+    mantissa |= 0x800000u;
+    shift = 14 - exponent;
+    exponent = 0;
+  }
+  unsigned half = ((unsigned)exponent << 10) + (mantissa >> shift);
+  unsigned rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+  if(rest > halfway || (rest == halfway && (half & 1))) half++; //a carry into the exponent is still correct
+  return (unsigned short)(sign | half);
+}
+
+unsigned decodeRGBA16(std::vector<unsigned short>& out, unsigned& w, unsigned& h,
+                      const std::vector<unsigned char>& png)
+{
+  std::vector<unsigned char> image;
+  unsigned bitdepth = 8;
+  unsigned error = decodeRGBA(image, bitdepth, w, h, png);
+  if(error) return error;
+  std::vector<unsigned short> table(1u << bitdepth);
+  for(size_t i = 0; i < table.size(); i++) table[i] = (unsigned short)(bitdepth == 8 ? i * 257 : i);
+  convertRGBA(out, image, bitdepth, table, table);
+  return 0;
+}
+
+unsigned decodeRGBA16F(std::vector<unsigned short>& out, unsigned& w, unsigned& h,
+                       const std::vector<unsigned char>& png, bool srgb)
+{
+  std::vector<unsigned char> image;
+  unsigned bitdepth = 8;
+  unsigned error = decodeRGBA(image, bitdepth, w, h, png);
+  if(error) return error;
+  std::vector<float> linear, color;
+  makeFloatTable(linear, bitdepth, false);
+  makeFloatTable(color, bitdepth, srgb);
+  std::vector<unsigned short> halfLinear(linear.size()), halfColor(color.size());
+  for(size_t i = 0; i < linear.size(); i++)
+  {
+    halfLinear[i] = floatToHalf(linear[i]);
+    halfColor[i] = floatToHalf(color[i]);
+  }
+  convertRGBA(out, image, bitdepth, halfColor, halfLinear);
+  return 0;
+}
+
+unsigned decodeRGBA32F(std::vector<float>& out, unsigned& w, unsigned& h,
+                       const std::vector<unsigned char>& png, bool srgb)
+{
+  std::vector<unsigned char> image;
+  unsigned bitdepth = 8;
+  unsigned error = decodeRGBA(image, bitdepth, w, h, png);
+  if(error) return error;
+  std::vector<float> linear, color;
+  makeFloatTable(linear, bitdepth, false);
+  makeFloatTable(color, bitdepth, srgb);
+  convertRGBA(out, image, bitdepth, color, linear);
+  return 0;
+}
+
+static unsigned readUint32(const unsigned char* p)
+{
+  return ((unsigned)p[0] << 24) | ((unsigned)p[1] << 16) | ((unsigned)p[2] << 8) | (unsigned)p[3];
+}
+
+static void writeUint32(unsigned char* p, unsigned value)
+{
+  p[0] = (unsigned char)(value >> 24);
+  p[1] = (unsigned char)(value >> 16);
+  p[2] = (unsigned char)(value >> 8);
+  p[3] = (unsigned char)value;
+}
+
+static void appendUint32(std::vector<unsigned char>& out, unsigned value)
+{
+  out.resize(out.size() + 4);
+  writeUint32(&out[out.size() - 4], value);
+}
+
+static void appendUint16(std::vector<unsigned char>& out, unsigned value)
+{
+  out.push_back((unsigned char)(value >> 8));
+  out.push_back((unsigned char)value);
+}
+
+//Appends the length and type of a chunk. Append the data after it, and then call endChunk to fill in the length and CRC.
+static size_t beginChunk(std::vector<unsigned char>& out, const char* type)
+{
+  size_t start = out.size();
+  appendUint32(out, 0);
+  out.insert(out.end(), type, type + 4);
+  return start;
+}
+
+static void endChunk(std::vector<unsigned char>& out, size_t start)
+{
+  unsigned length = (unsigned)(out.size() - start - 8);
+  writeUint32(&out[start], length);
+  appendUint32(out, lodepng_crc32(&out[start + 4], length + 4));
+}
+
+//Returns the chunk at pos, or 0 with an error if it is broken off at the end of the PNG
+static const unsigned char* getChunk(unsigned& error, const unsigned char* png, size_t pngsize, size_t pos)
+{
+  if(pos + 12 > pngsize) { error = 30; return 0; }
+  if(lodepng_chunk_length(&png[pos]) > pngsize - pos - 12) { error = 30; return 0; }
+  return &png[pos];
+}
+
+APNGFrameControl::APNGFrameControl()
+  : x_offset(0), y_offset(0), width(0), height(0), delay_num(0), delay_den(0),
+    dispose_op(APNG_DISPOSE_NONE), blend_op(APNG_BLEND_SOURCE)
+{
+}
+
+//Reads the fcTL chunk data that follows the sequence number, and checks the frame against the canvas
+static unsigned readFrameControl(APNGFrameControl& control, const unsigned char* data, unsigned length,
+                                 unsigned width, unsigned height)
+{
+  if(length != 22) return 96;
+  control.width = readUint32(data + 0);
+  control.height = readUint32(data + 4);
+  control.x_offset = readUint32(data + 8);
+  control.y_offset = readUint32(data + 12);
+  control.delay_num = 256u * data[16] + data[17];
+  control.delay_den = 256u * data[18] + data[19];
+  control.dispose_op = data[20];
+  control.blend_op = data[21];
+  if(control.width == 0 || control.height == 0) return 97;
+  if(control.x_offset > width || control.width > width - control.x_offset) return 97;
+  if(control.y_offset > height || control.height > height - control.y_offset) return 97;
+  if(control.dispose_op > APNG_DISPOSE_PREVIOUS || control.blend_op > APNG_BLEND_OVER) return 99;
+  return 0;
+}
+
+static void appendFrameControl(std::vector<unsigned char>& out, const APNGFrameControl& control, unsigned sequence)
+{
+  size_t start = beginChunk(out, "fcTL");
+  appendUint32(out, sequence);
+  appendUint32(out, control.width);
+  appendUint32(out, control.height);
+  appendUint32(out, control.x_offset);
+  appendUint32(out, control.y_offset);
+  appendUint16(out, control.delay_num);
+  appendUint16(out, control.delay_den);
+  out.push_back((unsigned char)control.dispose_op);
+  out.push_back((unsigned char)control.blend_op);
+  endChunk(out, start);
+}
+
+//Grows the rectangle x, y, w, h to also contain the frame's rectangle
+static void addRect(unsigned& x, unsigned& y, unsigned& w, unsigned& h, const APNGFrameControl& frame)
+{
+  if(w == 0 || h == 0)
+  {
+    x = frame.x_offset; y = frame.y_offset; w = frame.width; h = frame.height;
+    return;
+  }
+  unsigned right = std::max(x + w, frame.x_offset + frame.width);
+  unsigned bottom = std::max(y + h, frame.y_offset + frame.height);
+  x = std::min(x, frame.x_offset);
+  y = std::min(y, frame.y_offset);
+  w = right - x;
+  h = bottom - y;
+}
+
+//Blends an RGBA8 pixel over another, both with alpha that is not premultiplied
+static void blendOver(unsigned char* dst, const unsigned char* src)
+{
+  unsigned sa = src[3], da = dst[3];
+  if(sa == 255 || da == 0)
+  {
+    memcpy(dst, src, 4);
+    return;
+  }
+  if(sa == 0) return;
+  unsigned u = sa * 255, v = da * (255 - sa), a = u + v; //the alphas scaled by 255
+  for(int c = 0; c < 3; c++) dst[c] = (unsigned char)((src[c] * u + dst[c] * v + a / 2) / a);
+  dst[3] = (unsigned char)((a + 127) / 255);
+}
+
+APNGDecoder::APNGDecoder()
+  : width(0), height(0), num_frames(0), num_plays(0), default_image_hidden(false),
+    dirty_x(0), dirty_y(0), dirty_width(0), dirty_height(0), png_(0), pos_(0), frame_(0), sequence_(0), animated_(false)
+{
+}
+
+unsigned APNGDecoder::open(const std::vector<unsigned char>& png)
+{
+  png_ = &png;
+  num_frames = 0; //done until the header was read successfully
+  num_plays = 0;
+  default_image_hidden = false;
+  dirty_x = dirty_y = dirty_width = dirty_height = 0;
+  frame_ = sequence_ = 0;
+  animated_ = false;
+  shared_.clear();
+  saved_.clear();
+  previous_ = APNGFrameControl();
+  if(png.empty()) return 48; //empty input buffer
+
+  State state;
+  unsigned error = lodepng_inspect(&width, &height, &state, &png[0], png.size());
+  if(error) return error;
+  pos_ = 33; //the signature and the IHDR chunk
+
+  //the chunks before the image data: acTL, whether the default image has an fcTL, PLTE and tRNS
+  bool fcTL = false;
+  for(size_t pos = pos_; ; )
+  {
+    const unsigned char* chunk = getChunk(error, &png[0], png.size(), pos);
+    if(error) return error;
+    if(lodepng_chunk_type_equals(chunk, "IDAT") || lodepng_chunk_type_equals(chunk, "IEND")) break;
+    unsigned length = lodepng_chunk_length(chunk);
+    const unsigned char* data = lodepng_chunk_data_const(chunk);
+    if(lodepng_chunk_type_equals(chunk, "acTL"))
+    {
+      if(length != 8 || readUint32(data) == 0) return 95;
+      num_frames = readUint32(data);
+      num_plays = readUint32(data + 4);
+      animated_ = true;
+    }
+    else if(lodepng_chunk_type_equals(chunk, "fcTL")) fcTL = true;
+    else if(lodepng_chunk_type_equals(chunk, "PLTE") || lodepng_chunk_type_equals(chunk, "tRNS"))
+    {
+      shared_.insert(shared_.end(), chunk, chunk + length + 12);
+    }
+    pos += length + 12;
+  }
+  if(!animated_) num_frames = 1;
+  default_image_hidden = animated_ && !fcTL;
+  canvas.assign((size_t)width * height * 4, 0);
+  return 0;
+}
+
+bool APNGDecoder::done() const
+{
+  return frame_ >= num_frames;
+}
+
+unsigned APNGDecoder::next(APNGFrame& frame)
+{
+  if(done()) return 102;
+  const std::vector<unsigned char>& png = *png_;
+  unsigned error = 0;
+
+  //a PNG without acTL is a single frame covering the canvas
+  bool found = !animated_;
+  if(found)
+  {
+    static_cast<APNGFrameControl&>(frame) = APNGFrameControl();
+    frame.width = width;
+    frame.height = height;
+  }
+
+  //gather the frame's fcTL and image data, up to the next fcTL
+  std::vector<unsigned char> idat;
+  for(;;)
+  {
+    const unsigned char* chunk = getChunk(error, &png[0], png.size(), pos_);
+    if(error) return error;
+    if(lodepng_chunk_type_equals(chunk, "IEND")) break;
+    bool isfcTL = lodepng_chunk_type_equals(chunk, "fcTL") != 0;
+    bool isfdAT = lodepng_chunk_type_equals(chunk, "fdAT") != 0;
+    bool isIDAT = lodepng_chunk_type_equals(chunk, "IDAT") != 0;
+    if(isfcTL && found) break; //the start of the next frame
+    unsigned length = lodepng_chunk_length(chunk);
+    const unsigned char* data = lodepng_chunk_data_const(chunk);
+    if(isfcTL || isfdAT)
+    {
+      if(lodepng_chunk_check_crc(chunk)) return 57;
+      if(length < 4) return isfcTL ? 96 : 100;
+      if(readUint32(data) != sequence_) return 98;
+      sequence_++;
+    }
+    if(isfcTL)
+    {
+      error = readFrameControl(frame, data + 4, length - 4, width, height);
+      if(error) return error;
+      bool idatFrame = frame_ == 0 && !default_image_hidden;
+      if(idatFrame && (frame.x_offset || frame.y_offset || frame.width != width || frame.height != height)) return 97;
+      found = true;
+    }
+    else if(isfdAT)
+    {
+      if(!found) return 100;
+      idat.insert(idat.end(), data + 4, data + length);
+    }
+    else if(isIDAT && found) idat.insert(idat.end(), data, data + length); //skipped if it's the hidden default image
+    pos_ += length + 12;
+  }
+  if(!found) return 102;
+  if(idat.empty()) return 100;
+
+  //decode the frame as a PNG of its own, with the IHDR of the frame's size and the shared chunks
+  std::vector<unsigned char> single(png.begin(), png.begin() + 33);
+  writeUint32(&single[16], frame.width);
+  writeUint32(&single[20], frame.height);
+  lodepng_chunk_generate_crc(&single[8]);
+  single.insert(single.end(), shared_.begin(), shared_.end());
+  size_t start = beginChunk(single, "IDAT");
+  single.insert(single.end(), idat.begin(), idat.end());
+  endChunk(single, start);
+  endChunk(single, beginChunk(single, "IEND"));
+  std::vector<unsigned char>().swap(idat);
+  frame.image.clear();
+  unsigned w, h;
+  error = decode(frame.image, w, h, single);
+  if(error) return error;
+
+  //dispose of the previous frame
+  dirty_x = dirty_y = dirty_width = dirty_height = 0;
+  size_t stride = (size_t)width * 4;
+  if(frame_ > 0 && previous_.dispose_op != APNG_DISPOSE_NONE)
+  {
+    size_t rowsize = (size_t)previous_.width * 4;
+    for(unsigned y = 0; y < previous_.height; y++)
+    {
+      unsigned char* row = &canvas[(previous_.y_offset + y) * stride + previous_.x_offset * 4];
+      if(previous_.dispose_op == APNG_DISPOSE_PREVIOUS) memcpy(row, &saved_[y * rowsize], rowsize);
+      else memset(row, 0, rowsize);
+    }
+    addRect(dirty_x, dirty_y, dirty_width, dirty_height, previous_);
+  }
+
+  //draw the frame, after saving what it covers if it is to be restored
+  size_t rowsize = (size_t)frame.width * 4;
+  if(frame.dispose_op == APNG_DISPOSE_PREVIOUS) saved_.resize(rowsize * frame.height);
+  for(unsigned y = 0; y < frame.height; y++)
+  {
+    unsigned char* row = &canvas[(frame.y_offset + y) * stride + frame.x_offset * 4];
+    const unsigned char* in = &frame.image[y * rowsize];
+    if(frame.dispose_op == APNG_DISPOSE_PREVIOUS) memcpy(&saved_[y * rowsize], row, rowsize);
+    if(frame.blend_op == APNG_BLEND_SOURCE) memcpy(row, in, rowsize);
+    else for(size_t i = 0; i < rowsize; i += 4) blendOver(row + i, in + i);
+  }
+  addRect(dirty_x, dirty_y, dirty_width, dirty_height, frame);
+
+  previous_ = frame;
+  frame_++;
+  return 0;
+}
+
+APNGBuilder::APNGBuilder()
+  : num_frames_(0), sequence_(0)
+{
+}
+
+unsigned APNGBuilder::add(const APNGFrameControl& control, const unsigned char* png, size_t pngsize)
+{
+  State state;
+  unsigned w, h;
+  unsigned error = lodepng_inspect(&w, &h, &state, png, pngsize);
+  if(error) return error;
+  if(w != control.width || h != control.height) return 97;
+  if(control.delay_num > 65535 || control.delay_den > 65535) return 96;
+  if(control.dispose_op > APNG_DISPOSE_PREVIOUS || control.blend_op > APNG_BLEND_OVER) return 99;
+  if(num_frames_ == 0)
+  {
+    if(control.x_offset || control.y_offset) return 97;
+  }
+  else
+  {
+    unsigned width = readUint32(&header_[8]), height = readUint32(&header_[12]);
+    if(control.x_offset > width || control.width > width - control.x_offset) return 97;
+    if(control.y_offset > height || control.height > height - control.y_offset) return 97;
+    if(memcmp(&png[24], &header_[16], 5)) return 101; //bit depth, color type, compression, filter, interlace
+  }
+
+  //the frame's chunks, only kept if the whole PNG is fine
+  std::vector<unsigned char> shared, chunks;
+  unsigned sequence = sequence_;
+  appendFrameControl(chunks, control, sequence++);
+  for(size_t pos = 33; ; )
+  {
+    const unsigned char* chunk = getChunk(error, png, pngsize, pos);
+    if(error) return error;
+    if(lodepng_chunk_type_equals(chunk, "IEND")) break;
+    unsigned length = lodepng_chunk_length(chunk);
+    if(lodepng_chunk_type_equals(chunk, "PLTE") || lodepng_chunk_type_equals(chunk, "tRNS"))
+    {
+      shared.insert(shared.end(), chunk, chunk + length + 12);
+    }
+    else if(lodepng_chunk_type_equals(chunk, "IDAT"))
+    {
+      if(num_frames_ == 0) chunks.insert(chunks.end(), chunk, chunk + length + 12);
+      else
+      {
+        size_t start = beginChunk(chunks, "fdAT");
+        appendUint32(chunks, sequence++);
+        chunks.insert(chunks.end(), lodepng_chunk_data_const(chunk), lodepng_chunk_data_const(chunk) + length);
+        endChunk(chunks, start);
+      }
+    }
+    pos += length + 12;
+  }
+
+  if(num_frames_ == 0)
+  {
+    header_.assign(png + 8, png + 33);
+    shared_ = shared;
+  }
+  else if(shared != shared_) return 101;
+  frames_.insert(frames_.end(), chunks.begin(), chunks.end());
+  sequence_ = sequence;
+  num_frames_++;
+  return 0;
+}
+
+unsigned APNGBuilder::add(const APNGFrameControl& control, const std::vector<unsigned char>& png)
+{
+  if(png.empty()) return 48; //empty input buffer
+  return add(control, &png[0], png.size());
+}
+
+unsigned APNGBuilder::finish(std::vector<unsigned char>& out, unsigned num_plays) const
+{
+  if(num_frames_ == 0) return 102;
+  static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+  out.insert(out.end(), signature, signature + 8);
+  out.insert(out.end(), header_.begin(), header_.end());
+  size_t start = beginChunk(out, "acTL");
+  appendUint32(out, num_frames_);
+  appendUint32(out, num_plays);
+  endChunk(out, start);
+  out.insert(out.end(), shared_.begin(), shared_.end());
+  out.insert(out.end(), frames_.begin(), frames_.end());
+  endChunk(out, beginChunk(out, "IEND"));
+  return 0;
+}
+
+bool getDirtyRect(unsigned& x, unsigned& y, unsigned& w, unsigned& h,
+                  const unsigned char* previous, const unsigned char* current, unsigned width, unsigned height)
+{
+  x = y = w = h = 0;
+  size_t stride = (size_t)width * 4;
+  unsigned top = 0, bottom = height;
+  while(top < height && !memcmp(previous + top * stride, current + top * stride, stride)) top++;
+  if(top == height) return false;
+  while(!memcmp(previous + (bottom - 1) * stride, current + (bottom - 1) * stride, stride)) bottom--;
+
+  //the columns only have to be searched up to the rectangle found so far
+  unsigned left = width, right = 0;
+  for(unsigned row = top; row < bottom; row++)
+  {
+    const unsigned char* p = previous + row * stride;
+    const unsigned char* c = current + row * stride;
+    unsigned i = 0;
+    while(i < left && !memcmp(p + i * 4, c + i * 4, 4)) i++;
+    left = i;
+    unsigned j = width;
+    while(j > right && !memcmp(p + (j - 1) * 4, c + (j - 1) * 4, 4)) j--;
+    right = j;
+  }
+  x = left;
+  y = top;
+  w = right - left;
+  h = bottom - top;
+  return true;
+}
+
+unsigned encodeAPNG(std::vector<unsigned char>& out, const std::vector<std::vector<unsigned char> >& frames,
+                    unsigned width, unsigned height, unsigned delay_num, unsigned delay_den, unsigned num_plays,
+                    State& state)
+{
+  if(frames.empty()) return 102;
+  size_t size = (size_t)width * height * 4;
+  for(size_t i = 0; i < frames.size(); i++) if(frames[i].size() < size) return 84;
+
+  //the rectangles, with equal frames merged into the delay of the one before them
+  std::vector<APNGFrameControl> controls;
+  std::vector<size_t> sources;
+  APNGFrameControl control;
+  control.width = width;
+  control.height = height;
+  control.delay_num = delay_num;
+  control.delay_den = delay_den;
+  controls.push_back(control);
+  sources.push_back(0);
+  for(size_t i = 1; i < frames.size(); i++)
+  {
+    if(!getDirtyRect(control.x_offset, control.y_offset, control.width, control.height,
+                     &frames[i - 1][0], &frames[i][0], width, height))
+    {
+      if(controls.back().delay_num + delay_num <= 65535)
+      {
+        controls.back().delay_num += delay_num;
+        continue;
+      }
+      control.width = control.height = 1; //the delay doesn't fit, show the same image again with a 1 pixel frame
+    }
+    controls.push_back(control);
+    sources.push_back(i);
+  }
+
+  State framestate = state;
+  framestate.info_raw.colortype = LCT_RGBA;
+  framestate.info_raw.bitdepth = 8;
+  framestate.encoder.auto_convert = 0;
+  APNGBuilder builder;
+  std::vector<unsigned char> image, png;
+  for(size_t i = 0; i < controls.size(); i++)
+  {
+    const APNGFrameControl& c = controls[i];
+    const unsigned char* source = &frames[sources[i]][0];
+    image.resize((size_t)c.width * c.height * 4);
+    for(unsigned y = 0; y < c.height; y++)
+    {
+      memcpy(&image[(size_t)y * c.width * 4], source + (c.y_offset + y) * (size_t)width * 4 + c.x_offset * 4, c.width * 4);
+    }
+    png.clear();
+    unsigned error = encode(png, image, c.width, c.height, framestate);
+    if(!error) error = builder.add(c, png);
+    if(error) return error;
+  }
+  return builder.finish(out, num_plays);
+}
+
+unsigned encodeAPNG(std::vector<unsigned char>& out, const std::vector<std::vector<unsigned char> >& frames,
+                    unsigned width, unsigned height, unsigned delay_num, unsigned delay_den, unsigned num_plays)
+{
+  State state;
+  return encodeAPNG(out, frames, width, height, delay_num, delay_den, num_plays, state);
+}
+
+QuantizeSettings::QuantizeSettings()
+  : max_colors(256), iterations(8), dither(false), custom_parallel(0), custom_context(0)
+{
+}
+
+//Colors per task of the histogram, the k-means iterations and the mapping, pixels per task for the histogram
+static const size_t QUANTIZE_CHUNK = 4096;
+
+static void runTasks(const QuantizeSettings& settings, void (*task)(void*, size_t), void* context, size_t count)
+{
+  if(settings.custom_parallel) settings.custom_parallel(task, context, count, &settings);
+  else for(size_t i = 0; i < count; i++) task(context, i);
+}
+
+//The quantizer's color space: Oklab L, a and b premultiplied by alpha, and alpha, all roughly from 0 to 1.
+//linear is the sRGB decoding table of makeFloatTable.
+static void toOklab(float* out, const unsigned char* rgba, const std::vector<float>& linear)
+{
+  double r = linear[rgba[0]], g = linear[rgba[1]], b = linear[rgba[2]], alpha = rgba[3] / 255.0;
+  double l = std::pow(0.4122214708 * r + 0.5363325363 * g + 0.0514459929 * b, 1.0 / 3);
+  double m = std::pow(0.2119034982 * r + 0.6806995451 * g + 0.1073969566 * b, 1.0 / 3);
+  double s = std::pow(0.0883024619 * r + 0.2817188376 * g + 0.6299787005 * b, 1.0 / 3);
+  out[0] = (float)(alpha * (0.2104542553 * l + 0.7936177850 * m - 0.0040720468 * s));
+  out[1] = (float)(alpha * (1.9779984951 * l - 2.4285922050 * m + 0.4505937099 * s));
+  out[2] = (float)(alpha * (0.0259040371 * l + 0.7827717662 * m - 0.8086757660 * s));
+  out[3] = (float)alpha;
+}
+
+static unsigned char linearToSRGB8(double c)
+{
+  c = c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1 / 2.4) - 0.055;
+  return (unsigned char)(c <= 0 ? 0 : (c >= 1 ? 255 : (int)(c * 255 + 0.5)));
+}
+
+//The inverse of toOklab, rounded to RGBA8. Colors that are almost transparent become transparent black.
+static void fromOklab(unsigned char* rgba, const float* in)
+{
+  double alpha = in[3];
+  if(alpha < 0.5 / 255)
+  {
+    rgba[0] = rgba[1] = rgba[2] = rgba[3] = 0;
+    return;
+  }
+  double L = in[0] / alpha, a = in[1] / alpha, b = in[2] / alpha;
+  double l = L + 0.3963377774 * a + 0.2158037573 * b;
+  double m = L - 0.1055613458 * a - 0.0638541728 * b;
+  double s = L - 0.0894841775 * a - 1.2914855480 * b;
+  l = l * l * l;
+  m = m * m * m;
+  s = s * s * s;
+  rgba[0] = linearToSRGB8(4.0767416621 * l - 3.3077115913 * m + 0.2309699292 * s);
+  rgba[1] = linearToSRGB8(-1.2684380046 * l + 2.6097574011 * m - 0.3413193965 * s);
+  rgba[2] = linearToSRGB8(-0.0041960863 * l - 0.7034186147 * m + 1.7076147010 * s);
+  rgba[3] = (unsigned char)(alpha >= 1 ? 255 : (int)(alpha * 255 + 0.5));
+}
+
+//The palette with an array per coordinate, so the distances to all its colors are computed in a loop the compiler
+//can vectorize
+struct QuantizePalette
+{
+  std::vector<float> c[4];
+  void resize(size_t n) { for(int i = 0; i < 4; i++) c[i].resize(n); }
+  size_t size() const { return c[0].size(); }
+};
+
+//Index of the palette color closest to p
+static unsigned nearestColor(const float* p, const QuantizePalette& palette)
+{
+  float distances[256];
+  size_t n = palette.size();
+  const float* c0 = &palette.c[0][0];
+  const float* c1 = &palette.c[1][0];
+  const float* c2 = &palette.c[2][0];
+  const float* c3 = &palette.c[3][0];
+  for(size_t i = 0; i < n; i++)
+  {
+    float d0 = c0[i] - p[0], d1 = c1[i] - p[1], d2 = c2[i] - p[2], d3 = c3[i] - p[3];
+    distances[i] = d0 * d0 + d1 * d1 + d2 * d2 + d3 * d3;
+  }
+  unsigned best = 0;
+  for(size_t i = 1; i < n; i++) if(distances[i] < distances[best]) best = (unsigned)i;
+  return best;
+}
+
+static unsigned rgbaKey(const unsigned char* p)
+{
+  return ((unsigned)p[0] << 24) | ((unsigned)p[1] << 16) | ((unsigned)p[2] << 8) | (unsigned)p[3];
+}
+
+//The work shared by the tasks of the quantizer. Each task only writes its own range of the outputs.
+struct Quantizer
+{
+  const unsigned char* image;
+  size_t numpixels;
+  std::vector<std::vector<std::pair<unsigned, unsigned> > > histograms; //per task: sorted RGBA keys and counts
+  std::vector<unsigned> keys, weights; //the distinct colors of the image, sorted, and their pixel counts
+  std::vector<float> points; //the distinct colors in the quantizer's color space, 4 floats each
+  std::vector<float> linear;
+  QuantizePalette palette;
+  std::vector<unsigned char> assignment; //per distinct color, the palette index
+  std::vector<double> sums; //per task, for every palette color the weighted sum of its colors' points and weights
+  std::vector<size_t> changed; //per task, the number of colors assigned to a different palette color
+  std::vector<unsigned char>* indices;
+};
+
+static void histogramTask(void* context, size_t i)
+{
+  Quantizer& q = *(Quantizer*)context;
+  size_t begin = i * QUANTIZE_CHUNK, end = std::min(begin + QUANTIZE_CHUNK, q.numpixels);
+  std::vector<unsigned> keys(end - begin);
+  for(size_t j = begin; j < end; j++) keys[j - begin] = rgbaKey(&q.image[j * 4]);
+  std::sort(keys.begin(), keys.end());
+  std::vector<std::pair<unsigned, unsigned> >& histogram = q.histograms[i];
+  for(size_t j = 0; j < keys.size(); j++)
+  {
+    if(histogram.empty() || histogram.back().first != keys[j]) histogram.push_back(std::make_pair(keys[j], 0u));
+    histogram.back().second++;
+  }
+}
+
+static void pointsTask(void* context, size_t i)
+{
+  Quantizer& q = *(Quantizer*)context;
+  size_t end = std::min((i + 1) * QUANTIZE_CHUNK, q.keys.size());
+  for(size_t j = i * QUANTIZE_CHUNK; j < end; j++)
+  {
+    unsigned char rgba[4] = { (unsigned char)(q.keys[j] >> 24), (unsigned char)(q.keys[j] >> 16),
+                              (unsigned char)(q.keys[j] >> 8), (unsigned char)q.keys[j] };
+    toOklab(&q.points[j * 4], rgba, q.linear);
+  }
+}
+
+//Assigns colors to their nearest palette color and sums them up per palette color, one k-means step
+static void assignTask(void* context, size_t i)
+{
+  Quantizer& q = *(Quantizer*)context;
+  size_t end = std::min((i + 1) * QUANTIZE_CHUNK, q.keys.size());
+  double* sums = &q.sums[i * q.palette.size() * 5];
+  std::fill(sums, sums + q.palette.size() * 5, 0.0);
+  q.changed[i] = 0;
+  for(size_t j = i * QUANTIZE_CHUNK; j < end; j++)
+  {
+    const float* p = &q.points[j * 4];
+    unsigned index = nearestColor(p, q.palette);
+    if(index != q.assignment[j]) q.changed[i]++;
+    q.assignment[j] = (unsigned char)index;
+    double weight = q.weights[j], *s = &sums[index * 5];
+    s[0] += weight * p[0];
+    s[1] += weight * p[1];
+    s[2] += weight * p[2];
+    s[3] += weight * p[3];
+    s[4] += weight;
+  }
+}
+
+static void nearestTask(void* context, size_t i)
+{
+  Quantizer& q = *(Quantizer*)context;
+  size_t end = std::min((i + 1) * QUANTIZE_CHUNK, q.keys.size());
+  for(size_t j = i * QUANTIZE_CHUNK; j < end; j++)
+  {
+    q.assignment[j] = (unsigned char)nearestColor(&q.points[j * 4], q.palette);
+  }
+}
+
+//Looks up the palette index of every pixel through its distinct color
+static void mapTask(void* context, size_t i)
+{
+  Quantizer& q = *(Quantizer*)context;
+  size_t end = std::min((i + 1) * QUANTIZE_CHUNK, q.numpixels);
+  for(size_t j = i * QUANTIZE_CHUNK; j < end; j++)
+  {
+    size_t color = std::lower_bound(q.keys.begin(), q.keys.end(), rgbaKey(&q.image[j * 4])) - q.keys.begin();
+    (*q.indices)[j] = q.assignment[color];
+  }
+}
+
+//A box of the median cut: a range of the distinct colors, and the axis with the largest weighted squared error
+struct QuantizeBox
+{
+  size_t begin, end;
+  double error;
+  int axis;
+};
+
+struct QuantizeAxisLess
+{
+  const float* points;
+  int axis;
+  bool operator()(unsigned a, unsigned b) const { return points[a * 4 + axis] < points[b * 4 + axis]; }
+};
+
+static QuantizeBox makeBox(const Quantizer& q, const std::vector<unsigned>& order, size_t begin, size_t end,
+                           float* mean)
+{
+  double sum[4] = { 0, 0, 0, 0 }, squares[4] = { 0, 0, 0, 0 }, weight = 0;
+  for(size_t i = begin; i < end; i++)
+  {
+    const float* p = &q.points[order[i] * 4];
+    double w = q.weights[order[i]];
+    for(int c = 0; c < 4; c++)
+    {
+      sum[c] += w * p[c];
+      squares[c] += w * p[c] * p[c];
+    }
+    weight += w;
+  }
+  QuantizeBox box = { begin, end, 0.0, 0 };
+  double largest = -1;
+  for(int c = 0; c < 4; c++)
+  {
+    mean[c] = (float)(sum[c] / weight);
+    double error = squares[c] - sum[c] * sum[c] / weight;
+    box.error += error;
+    if(error > largest)
+    {
+      largest = error;
+      box.axis = c;
+    }
+  }
+  return box;
+}
+
+//Splits the box with the largest error at the weighted median of its axis, until there are max_colors boxes
+static void medianCut(Quantizer& q, unsigned max_colors)
+{
+  std::vector<unsigned> order(q.keys.size());
+  for(size_t i = 0; i < order.size(); i++) order[i] = (unsigned)i;
+  std::vector<QuantizeBox> boxes;
+  std::vector<float> means;
+  means.resize(4);
+  boxes.push_back(makeBox(q, order, 0, order.size(), &means[0]));
+  while(boxes.size() < max_colors)
+  {
+    size_t split = boxes.size();
+    for(size_t i = 0; i < boxes.size(); i++)
+    {
+      if(boxes[i].end - boxes[i].begin < 2 || boxes[i].error <= 0) continue;
+      if(split == boxes.size() || boxes[i].error > boxes[split].error) split = i;
+    }
+    if(split == boxes.size()) break; //every box has a single color
+
+    QuantizeBox box = boxes[split];
+    QuantizeAxisLess less = { &q.points[0], box.axis };
+    std::sort(order.begin() + box.begin, order.begin() + box.end, less);
+    double total = 0, half = 0;
+    for(size_t i = box.begin; i < box.end; i++) total += q.weights[order[i]];
+    size_t middle = box.begin + 1;
+    for(size_t i = box.begin; i + 1 < box.end; i++)
+    {
+      half += q.weights[order[i]];
+      middle = i + 1;
+      if(half * 2 >= total) break;
+    }
+    means.resize(means.size() + 4);
+    boxes[split] = makeBox(q, order, box.begin, middle, &means[split * 4]);
+    boxes.push_back(makeBox(q, order, middle, box.end, &means[boxes.size() * 4]));
+  }
+
+  q.palette.resize(boxes.size());
+  for(size_t i = 0; i < boxes.size(); i++)
+  {
+    for(int c = 0; c < 4; c++) q.palette.c[c][i] = means[i * 4 + c];
+  }
+}
+
+static void kMeans(Quantizer& q, const QuantizeSettings& settings)
+{
+  size_t tasks = (q.keys.size() + QUANTIZE_CHUNK - 1) / QUANTIZE_CHUNK, n = q.palette.size();
+  q.sums.resize(tasks * n * 5);
+  q.changed.resize(tasks);
+  for(unsigned iteration = 0; iteration < settings.iterations; iteration++)
+  {
+    runTasks(settings, assignTask, &q, tasks);
+    size_t changed = 0;
+    for(size_t t = 0; t < tasks; t++) changed += q.changed[t];
+    for(size_t k = 0; k < n; k++)
+    {
+      double s[5] = { 0, 0, 0, 0, 0 };
+      for(size_t t = 0; t < tasks; t++)
+      {
+        for(int c = 0; c < 5; c++) s[c] += q.sums[(t * n + k) * 5 + c];
+      }
+      if(s[4] == 0) continue; //keep a palette color that lost all its colors
+      for(int c = 0; c < 4; c++) q.palette.c[c][k] = (float)(s[c] / s[4]);
+    }
+    if(iteration > 0 && !changed) break;
+  }
+}
+
+//Floyd-Steinberg error diffusion in the quantizer's color space, row by row on the calling thread
+static void dither(Quantizer& q, unsigned w, unsigned h)
+{
+  std::vector<float> rows((w + 2) * 8, 0.0f); //the errors of this row and the next, with a pixel of margin each side
+  float* current = &rows[0];
+  float* next = &rows[(w + 2) * 4];
+  for(unsigned y = 0; y < h; y++)
+  {
+    std::swap(current, next);
+    std::fill(next, next + (w + 2) * 4, 0.0f);
+    for(unsigned x = 0; x < w; x++)
+    {
+      size_t pixel = (size_t)y * w + x;
+      size_t color = std::lower_bound(q.keys.begin(), q.keys.end(), rgbaKey(&q.image[pixel * 4])) - q.keys.begin();
+      float wanted[4];
+      for(int c = 0; c < 4; c++) wanted[c] = q.points[color * 4 + c] + current[(x + 1) * 4 + c];
+      unsigned index = nearestColor(wanted, q.palette);
+      (*q.indices)[pixel] = (unsigned char)index;
+      for(int c = 0; c < 4; c++)
+      {
+        float error = wanted[c] - q.palette.c[c][index];
+        current[(x + 2) * 4 + c] += error * (7.0f / 16);
+        next[x * 4 + c] += error * (3.0f / 16);
+        next[(x + 1) * 4 + c] += error * (5.0f / 16);
+        next[(x + 2) * 4 + c] += error * (1.0f / 16);
+      }
+    }
+  }
+}
+
+unsigned quantize(std::vector<unsigned char>& palette, std::vector<unsigned char>& indices,
+                  const unsigned char* image, unsigned w, unsigned h, const QuantizeSettings& settings)
+{
+  if(!image || !w || !h || settings.max_colors < 1 || settings.max_colors > 256) return 103;
+
+  Quantizer q;
+  q.image = image;
+  q.numpixels = (size_t)w * h;
+  q.indices = &indices;
+  indices.resize(q.numpixels);
+  size_t pixeltasks = (q.numpixels + QUANTIZE_CHUNK - 1) / QUANTIZE_CHUNK;
+
+  //the distinct colors: sorted per task, then merged
+  q.histograms.resize(pixeltasks);
+  runTasks(settings, histogramTask, &q, pixeltasks);
+  std::vector<std::pair<unsigned, unsigned> > merged;
+  for(size_t i = 0; i < pixeltasks; i++)
+  {
+    merged.insert(merged.end(), q.histograms[i].begin(), q.histograms[i].end());
+    std::vector<std::pair<unsigned, unsigned> >().swap(q.histograms[i]);
+  }
+  std::sort(merged.begin(), merged.end());
+  for(size_t i = 0; i < merged.size(); i++)
+  {
+    if(q.keys.empty() || q.keys.back() != merged[i].first)
+    {
+      q.keys.push_back(merged[i].first);
+      q.weights.push_back(0);
+    }
+    q.weights.back() += merged[i].second;
+  }
+  std::vector<std::pair<unsigned, unsigned> >().swap(merged);
+  size_t colortasks = (q.keys.size() + QUANTIZE_CHUNK - 1) / QUANTIZE_CHUNK;
+  q.assignment.resize(q.keys.size());
+
+  if(q.keys.size() <= settings.max_colors)
+  {
+    //few enough colors already: keep them exactly
+    palette.resize(q.keys.size() * 4);
+    for(size_t i = 0; i < q.keys.size(); i++)
+    {
+      for(int c = 0; c < 4; c++) palette[i * 4 + c] = (unsigned char)(q.keys[i] >> (24 - 8 * c));
+      q.assignment[i] = (unsigned char)i;
+    }
+    runTasks(settings, mapTask, &q, pixeltasks);
+    return 0;
+  }
+
+  makeFloatTable(q.linear, 8, true);
+  q.points.resize(q.keys.size() * 4);
+  runTasks(settings, pointsTask, &q, colortasks);
+  medianCut(q, settings.max_colors);
+  kMeans(q, settings);
+
+  //round the palette to RGBA8, and map the pixels to the rounded colors
+  size_t n = q.palette.size();
+  palette.resize(n * 4);
+  for(size_t i = 0; i < n; i++)
+  {
+    float point[4];
+    for(int c = 0; c < 4; c++) point[c] = q.palette.c[c][i];
+    fromOklab(&palette[i * 4], point);
+    toOklab(point, &palette[i * 4], q.linear);
+    for(int c = 0; c < 4; c++) q.palette.c[c][i] = point[c];
+  }
+  if(settings.dither)
+  {
+    dither(q, w, h);
+  }
+  else
+  {
+    runTasks(settings, nearestTask, &q, colortasks);
+    runTasks(settings, mapTask, &q, pixeltasks);
+  }
+  return 0;
+}
+
+unsigned encodeQuantized(std::vector<unsigned char>& out, const unsigned char* image, unsigned w, unsigned h,
+                         const QuantizeSettings& settings, State& state)
+{
+  std::vector<unsigned char> palette, indices;
+  unsigned error = quantize(palette, indices, image, w, h, settings);
+  if(error) return error;
+
+  size_t n = palette.size() / 4;
+  lodepng_palette_clear(&state.info_raw);
+  lodepng_palette_clear(&state.info_png.color);
+  for(size_t i = 0; i < n && !error; i++)
+  {
+    const unsigned char* c = &palette[i * 4];
+    error = lodepng_palette_add(&state.info_raw, c[0], c[1], c[2], c[3]);
+    if(!error) error = lodepng_palette_add(&state.info_png.color, c[0], c[1], c[2], c[3]);
+  }
+  if(error) return error;
+  state.info_raw.colortype = LCT_PALETTE;
+  state.info_raw.bitdepth = 8;
+  state.info_png.color.colortype = LCT_PALETTE;
+  state.info_png.color.bitdepth = n <= 2 ? 1 : (n <= 4 ? 2 : (n <= 16 ? 4 : 8));
+  state.encoder.auto_convert = 0;
+  return encode(out, indices, w, h, state);
+}
+
+unsigned encodeQuantized(std::vector<unsigned char>& out, const unsigned char* image, unsigned w, unsigned h,
+                         const QuantizeSettings& settings)
+{
+  State state;
+  return encodeQuantized(out, image, w, h, settings, state);
+}
+
 //This uses a stripped down version of picoPNG to extract detailed zlib information while decompressing.
 static const unsigned long LENBASE[29] =
     {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
@@ -114,6 +114,187 @@ is the second half of the 3th byte, in big endian (PNG's endian order).
 */
 int getPaletteValue(const unsigned char* data, size_t i, int bits);
 
+/*
+Decode to high precision RGBA for texture upload, e.g. with glTexImage2D, without a conversion by the driver. Every
+pixel has 4 values, in the range 0-65535 for RGBA16 and 0-1 for the float formats:
+decodeRGBA16: 16-bit unsigned integers in the byte order of this machine (unlike the big endian byte order of
+  lodepng's own 16-bit output), for GL_UNSIGNED_SHORT.
+decodeRGBA16F: half floats, the bits of each stored in an unsigned short, for GL_HALF_FLOAT.
+decodeRGBA32F: floats, for GL_FLOAT.
+With srgb, the float formats have the R, G and B channels converted from sRGB to linear; alpha is always linear.
+The values come from a table of the 256 or 65536 values a channel of an 8 or 16-bit PNG can have, so the cost per
+pixel is a lookup per channel.
+Returns 0 if ok, or a lodepng error code.
+*/
+unsigned decodeRGBA16(std::vector<unsigned short>& out, unsigned& w, unsigned& h,
+                      const std::vector<unsigned char>& png);
+unsigned decodeRGBA16F(std::vector<unsigned short>& out, unsigned& w, unsigned& h,
+                       const std::vector<unsigned char>& png, bool srgb = false);
+unsigned decodeRGBA32F(std::vector<float>& out, unsigned& w, unsigned& h,
+                       const std::vector<unsigned char>& png, bool srgb = false);
+
+/*
+Animated PNG (APNG). The acTL chunk gives the number of frames and plays, every frame has an fcTL chunk with the
+placement and timing below, and its pixels are in the IDAT chunks (the first frame, if the default image is part of
+the animation) or in fdAT chunks. A frame only covers a sub-rectangle of the canvas, so after decoding a frame only
+that rectangle, and the one the previous frame disposed of, has to be updated, e.g. with glTexSubImage2D.
+*/
+enum APNGDisposeOp
+{
+  APNG_DISPOSE_NONE = 0, //leave the canvas as it is
+  APNG_DISPOSE_BACKGROUND = 1, //clear the frame's rectangle to transparent black
+  APNG_DISPOSE_PREVIOUS = 2 //restore the frame's rectangle to what it was before the frame
+};
+
+enum APNGBlendOp
+{
+  APNG_BLEND_SOURCE = 0, //the frame's pixels replace the canvas, including alpha
+  APNG_BLEND_OVER = 1 //the frame's pixels are alpha blended over the canvas
+};
+
+//The contents of an fcTL chunk, without the sequence number.
+struct APNGFrameControl
+{
+  APNGFrameControl();
+  unsigned x_offset, y_offset, width, height; //the frame's rectangle of the canvas
+  unsigned delay_num, delay_den; //shown for delay_num / delay_den seconds, a delay_den of 0 means 100
+  unsigned dispose_op; //APNGDisposeOp, applied after the frame was shown and before the next frame is drawn
+  unsigned blend_op; //APNGBlendOp
+};
+
+//A decoded frame: the frame control and the frame's own RGBA8 pixels, width * height * 4 bytes.
+struct APNGFrame : public APNGFrameControl
+{
+  std::vector<unsigned char> image;
+};
+
+/*
+Decodes the frames of an APNG one at a time, and composes them on an RGBA8 canvas. A PNG without acTL chunk
+decodes as an animation of 1 frame. The png given to open must stay alive and unchanged while frames are decoded.
+Example:
+  lodepng::APNGDecoder decoder;
+  lodepng::APNGFrame frame;
+  unsigned error = decoder.open(png);
+  while(!error && !decoder.done())
+  {
+    error = decoder.next(frame);
+    //upload decoder.dirty_width * decoder.dirty_height pixels of the canvas at decoder.dirty_x, decoder.dirty_y,
+    //with a row length of decoder.width pixels, and show them for frame.delay_num / frame.delay_den seconds
+  }
+*/
+class APNGDecoder
+{
+  public:
+    APNGDecoder();
+    //Reads the header and acTL chunk, and starts at the first frame. Returns 0 if ok, or a lodepng error code.
+    unsigned open(const std::vector<unsigned char>& png);
+    //Decodes the next frame into frame, and draws it on the canvas after the previous frame's dispose op.
+    unsigned next(APNGFrame& frame);
+    //Whether every frame has been decoded. Calling open again restarts the animation.
+    bool done() const;
+
+    unsigned width, height; //the canvas size
+    unsigned num_frames, num_plays; //num_plays 0 means forever
+    bool default_image_hidden; //the IDAT image is not part of the animation, only shown by non-APNG decoders
+    std::vector<unsigned char> canvas; //RGBA8, width * height * 4 bytes, as it is after the last decoded frame
+    unsigned dirty_x, dirty_y, dirty_width, dirty_height; //the rectangle of the canvas changed by the last next()
+
+  private:
+    const std::vector<unsigned char>* png_;
+    size_t pos_; //the next chunk to read
+    unsigned frame_, sequence_;
+    bool animated_; //whether there is an acTL chunk
+    std::vector<unsigned char> shared_; //the PLTE and tRNS chunks, which every frame needs to decode
+    APNGFrameControl previous_;
+    std::vector<unsigned char> saved_; //the previous frame's rectangle before it was drawn, for APNG_DISPOSE_PREVIOUS
+};
+
+/*
+Builds an APNG from separately encoded PNGs of its frames, so that the frames can be compressed in parallel, with any
+encoder settings, and put together in order afterwards. Every frame PNG must have the size of its frame control and
+the same color type, bit depth, interlace method and palette as the first; the first frame must cover the whole
+canvas and becomes the default image.
+*/
+class APNGBuilder
+{
+  public:
+    APNGBuilder();
+    //Appends a frame. Returns 0 if ok, or a lodepng error code.
+    unsigned add(const APNGFrameControl& control, const unsigned char* png, size_t pngsize);
+    unsigned add(const APNGFrameControl& control, const std::vector<unsigned char>& png);
+    //Writes the APNG of all added frames to out. num_plays 0 means forever.
+    unsigned finish(std::vector<unsigned char>& out, unsigned num_plays = 0) const;
+
+  private:
+    std::vector<unsigned char> header_; //the first frame's IHDR
+    std::vector<unsigned char> shared_; //the first frame's PLTE and tRNS chunks
+    std::vector<unsigned char> frames_; //the fcTL, IDAT and fdAT chunks
+    unsigned num_frames_, sequence_;
+};
+
+/*
+Finds the smallest rectangle that contains every pixel that differs between two width * height images of RGBA8
+pixels. Returns false, with an empty rectangle, if the images are equal.
+*/
+bool getDirtyRect(unsigned& x, unsigned& y, unsigned& w, unsigned& h,
+                  const unsigned char* previous, const unsigned char* current, unsigned width, unsigned height);
+
+/*
+Encodes frames of width * height RGBA8 pixels as an APNG that shows each for delay_num / delay_den seconds. Every
+frame after the first only stores its dirty rectangle, with APNG_DISPOSE_NONE and APNG_BLEND_SOURCE, and a frame
+equal to the previous one extends the previous frame's delay. The frames are encoded with the color type of
+state.info_png.color; auto_convert is not used, since every frame needs the same color type.
+Returns 0 if ok, or a lodepng error code.
+*/
+unsigned encodeAPNG(std::vector<unsigned char>& out, const std::vector<std::vector<unsigned char> >& frames,
+                    unsigned width, unsigned height, unsigned delay_num, unsigned delay_den, unsigned num_plays,
+                    State& state);
+unsigned encodeAPNG(std::vector<unsigned char>& out, const std::vector<std::vector<unsigned char> >& frames,
+                    unsigned width, unsigned height, unsigned delay_num, unsigned delay_den, unsigned num_plays = 0);
+
+/*
+Lossy palette quantization, for encoding RGBA8 images with more than 256 colors as palette PNGs, e.g. UI art, which
+then take a quarter of the size in memory and usually much less on disk.
+A median cut of the image's colors gives the initial palette, and k-means iterations refine it. Both measure colors
+in the Oklab perceptual color space with the coordinates premultiplied by alpha, plus alpha itself, so that colors
+differing in hue count as far apart as the eye sees them, and all fully transparent pixels are the same color.
+*/
+struct QuantizeSettings
+{
+  QuantizeSettings();
+  unsigned max_colors; //size of the palette, 1-256. Default: 256
+  unsigned iterations; //most k-means iterations after the median cut, 0 keeps the median cut. Default: 8
+  bool dither; //Floyd-Steinberg dithering: smoother gradients, but compresses less. Default: false
+  /*
+  Optional, to run the work in parallel: must call task(task_context, i) for every i from 0 to count - 1, in any
+  order and from any threads, and return when all calls have returned. The histogram, the k-means iterations and the
+  mapping of the pixels without dithering use it; dithering goes pixel by pixel on the calling thread.
+  Default: null, which runs the tasks one after the other.
+  */
+  void (*custom_parallel)(void (*task)(void* task_context, size_t i), void* task_context, size_t count,
+                          const QuantizeSettings* settings);
+  const void* custom_context; //optional data for custom_parallel
+};
+
+/*
+Quantizes w * h RGBA8 pixels to a palette of at most settings.max_colors RGBA8 colors, 4 bytes each in palette, and
+the palette index of every pixel in indices. An image that has no more colors than that keeps its exact colors.
+Returns 0 if ok, or a lodepng error code.
+*/
+unsigned quantize(std::vector<unsigned char>& palette, std::vector<unsigned char>& indices,
+                  const unsigned char* image, unsigned w, unsigned h,
+                  const QuantizeSettings& settings = QuantizeSettings());
+
+/*
+Quantizes w * h RGBA8 pixels and encodes them as a palette PNG, with the smallest bit depth that fits the palette.
+The state's other encoder settings are used, its color modes and auto_convert are set by this function.
+Returns 0 if ok, or a lodepng error code.
+*/
+unsigned encodeQuantized(std::vector<unsigned char>& out, const unsigned char* image, unsigned w, unsigned h,
+                         const QuantizeSettings& settings, State& state);
+unsigned encodeQuantized(std::vector<unsigned char>& out, const unsigned char* image, unsigned w, unsigned h,
+                         const QuantizeSettings& settings = QuantizeSettings());
+
 /*
 The information for extractZlibInfo.
 */
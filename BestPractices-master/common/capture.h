@@ -0,0 +1,250 @@
+//"Copyright 2016 Intel Corporation.
+//
+//The source code, information and material("Material") contained herein is owned by Intel Corporation or its suppliers or licensors, and title to such Material 
+//remains with Intel Corporation or its suppliers or licensors.The Material contains proprietary information of Intel or its suppliers and licensors.
+//The Material is protected by worldwide copyright laws and treaty provisions.
+//No part of the Material may be used, copied, reproduced, modified, published, uploaded, posted, transmitted,distributed or disclosed in any way without Intel's prior express written permission. 
+//No license under any patent, copyright or other intellectual property rights in the Material is granted to or conferred upon you, either expressly, by implication, inducement, estoppel or otherwise. Any license under such intellectual property rights must be express and approved by Intel in writing.
+//Unless otherwise agreed by Intel in writing, you may not remove or alter this notice or any other notice embedded in 
+//Materials by Intel or Intel's suppliers or licensors in any way."
+
+
+
+
+
+
+
+#pragma once
+
+// Frame capture for the lessons.
+//
+// Call frame() once per frame, after drawing and before glutSwapBuffers().   While recording, the back buffer is read
+// into a ring of pixel pack buffers with glReadPixels and fenced; a frame is mapped only when its slot comes around
+// again, so the render loop never waits for the GPU.   The pixels are then handed to a thread pool that encodes them
+// with LodePNG's real-time mode into a numbered sequence of PNG files, or into a single animated PNG that only stores the
+// rectangle of each frame that changed.   When the encoders fall behind, frames are either dropped or the render loop
+// blocks until an encoder is free, depending on the back-pressure mode.
+// Include after GL/glew.h and GL/glut.h.
+
+#include <lodepng.h>
+#include <lodepng_util.h>
+#include <threadpool.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace capture
+{
+
+// What to do with a frame when every encoder is busy and the queue is full
+enum Backpressure {
+    DROP,
+    BLOCK,
+};
+
+// Where the frames go
+enum Output {
+    PNG_FILES,
+    APNG_FILE,
+};
+
+// Encodes the rw x rh rectangle at x, y (counted from the top) of a bottom-up RGBA frame as an RGB PNG with LodePNG's
+// real-time mode, trading compression ratio for speed.   png adopts LodePNG's output buffer rather than getting a copy of it.
+inline unsigned encodePNG(lodepng::Buffer& png, const std::vector<unsigned char>& rgba, unsigned w, unsigned h,
+                          unsigned x, unsigned y, unsigned rw, unsigned rh)
+{
+    // flip to top-down
+    std::vector<unsigned char> image(rw * rh * 4);
+    for (unsigned row = 0; row < rh; ++row) memcpy(&image[row * rw * 4], &rgba[((h - 1 - y - row) * w + x) * 4], rw * 4);
+
+    lodepng::State state;
+    state.info_raw.colortype = LCT_RGBA;
+    state.info_png.color.colortype = LCT_RGB;
+    state.encoder.auto_convert = 0;
+    state.encoder.filter_strategy = LFS_UP;
+    state.encoder.zlibsettings.fast = 1;
+    return lodepng::encode(png, &image[0], rw, rh, state);
+}
+
+inline unsigned encodePNG(lodepng::Buffer& png, const std::vector<unsigned char>& rgba, unsigned w, unsigned h)
+{
+    return encodePNG(png, rgba, w, h, 0, 0, w, h);
+}
+
+class Recorder
+{
+public:
+    Recorder(const std::string& prefix = "capture", unsigned threads = 0)
+        : prefix(prefix), threads(threads), mode(DROP), output(PNG_FILES), recording(false), next(0), issued(0), dropped(0), written(0), frameBytes(0), queued(0), turn(0)
+    {
+        for (int i = 0; i < nSlots; ++i) { pbo[i] = 0; fence[i] = 0; }
+    }
+
+    // Starts recording with the given back-pressure and output, or stops and waits for the encoders
+    void toggle(Backpressure backpressure = DROP, Output out = PNG_FILES)
+    {
+        if (!recording) {
+            if (!pool.get()) {
+                // a short queue, so a frame waits for at most about two encode times before it is dropped
+                unsigned n = threads ? threads : std::thread::hardware_concurrency();
+                if (!n) n = 1;
+                pool.reset(new ThreadPool(n, 2 * n));
+                glGenBuffers(nSlots, pbo);
+            }
+            mode = backpressure; output = out; recording = true; issued = dropped = 0; written = 0;
+            last.reset(); animation.clear(); frameBytes = 0; queued = turn = 0;
+            printf("capture started, %s frames when the %u encoders fall behind\n", DROP == mode ? "dropping" : "blocking on", (unsigned)pool->threads());
+        } else {
+            recording = false;
+            for (int i = 0; i < nSlots; ++i) collect((next + i) % nSlots);
+            pool->wait();
+            if (APNG_FILE == output) {
+                unsigned frames = writeAnimation();
+                printf("capture stopped, %u frames written to %s.png, %u dropped\n", frames, prefix.c_str(), dropped);
+            } else {
+                printf("capture stopped, %u frames written to %s_#####.png, %u dropped (gaps in the numbering)\n", written.load(), prefix.c_str(), dropped);
+            }
+        }
+    }
+
+    bool active() const { return recording; }
+
+    // Collects the frame read nSlots frames ago and starts reading this one
+    void frame()
+    {
+        if (!recording) return;
+        GLint readFbo, packBuffer, readBuffer;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFbo);
+        glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glGetIntegerv(GL_READ_BUFFER, &readBuffer);
+        glReadBuffer(GL_BACK);
+
+        int slot = next; next = (next + 1) % nSlots;
+        collect(slot);
+        Slot& s = slots[slot];
+        s.w = glutGet(GLUT_WINDOW_WIDTH); s.h = glutGet(GLUT_WINDOW_HEIGHT); s.number = issued++;
+        s.time = std::chrono::steady_clock::now();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, s.w * s.h * 4, NULL, GL_STREAM_READ);
+        glReadPixels(0, 0, s.w, s.h, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        glReadBuffer(readBuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+    }
+
+private:
+    enum { nSlots = 3 };
+    struct Slot { unsigned w, h, number; std::chrono::steady_clock::time_point time; };
+
+    // An encoded frame of the animated PNG
+    struct AnimationFrame {
+        unsigned number;
+        std::chrono::steady_clock::time_point time;
+        lodepng::APNGFrameControl control;
+        std::shared_ptr<lodepng::Buffer> png;
+    };
+
+    // Waits for a slot's readback, copies the pixels out and queues them for encoding
+    void collect(int slot)
+    {
+        if (!fence[slot]) return;
+        glClientWaitSync(fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence[slot]); fence[slot] = 0;
+        if (DROP == mode && pool->full()) { ++dropped; return; }
+
+        const Slot s = slots[slot];
+        // an animation keeps the size of its first frame
+        if (APNG_FILE == output && frameBytes && frameBytes != s.w * s.h * 4) { ++dropped; return; }
+        std::shared_ptr<std::vector<unsigned char> > rgba(new std::vector<unsigned char>(s.w * s.h * 4));
+        GLint packBuffer; glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+        glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, rgba->size(), &(*rgba)[0]);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffer);
+
+        if (APNG_FILE == output) {
+            // the frame only stores what changed since the last stored frame, and isn't stored at all if nothing did.
+            // That makes each frame depend on whether the one before it made it into the animation, so the jobs take
+            // turns in capture order and encode one at a time; the pool still keeps the encoding off the render loop.
+            frameBytes = rgba->size();
+            unsigned sequence = queued++;
+            pool->submit([this, rgba, s, sequence]() {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (turn != sequence) turned.wait(lock);
+                AnimationFrame frame; frame.number = s.number; frame.time = s.time;
+                lodepng::APNGFrameControl& c = frame.control; c.width = s.w; c.height = s.h;
+                bool changed = !last || lodepng::getDirtyRect(c.x_offset, c.y_offset, c.width, c.height, &(*last)[0], &(*rgba)[0], s.w, s.h);
+                c.y_offset = s.h - c.y_offset - c.height; // bottom-up to top-down
+                if (changed) frame.png.reset(new lodepng::Buffer);
+                if (changed && !encodePNG(*frame.png, *rgba, s.w, s.h, c.x_offset, c.y_offset, c.width, c.height)) {
+                    animation.push_back(frame);
+                    last = rgba;
+                    ++written;
+                }
+                ++turn;
+                turned.notify_all();
+            });
+            return;
+        }
+
+        char name[64]; sprintf_s(name, "_%05u.png", s.number);
+        std::string filename = prefix + name;
+        pool->submit([this, rgba, s, filename]() {
+            lodepng::Buffer png;
+            if (!encodePNG(png, *rgba, s.w, s.h) && !lodepng_save_file(png.data(), png.size(), filename.c_str())) ++written;
+        });
+    }
+
+    // Writes the encoded frames as an animated PNG, each shown until the next one was rendered.
+    // Returns the number of frames written.
+    unsigned writeAnimation()
+    {
+        lodepng::APNGBuilder builder;
+        unsigned added = 0;
+        for (size_t i = 0; i < animation.size(); ++i) {
+            lodepng::APNGFrameControl c = animation[i].control;
+            size_t n = i + 1 < animation.size() ? i + 1 : i, p = n ? n - 1 : 0;
+            long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(animation[n].time - animation[p].time).count();
+            c.delay_num = (unsigned)std::min(std::max(ms, 1ll), 65535ll); c.delay_den = 1000;
+            if (builder.add(c, animation[i].png->data(), animation[i].png->size())) break;
+            ++added;
+        }
+        std::vector<unsigned char> png;
+        std::string filename = prefix + ".png";
+        if (!added || builder.finish(png) || lodepng::save_file(png, filename)) added = 0;
+        animation.clear(); last.reset();
+        return added;
+    }
+
+    std::string prefix;
+    unsigned threads;
+    std::unique_ptr<ThreadPool> pool;
+    GLuint pbo[nSlots];
+    GLsync fence[nSlots];
+    Slot slots[nSlots];
+    Backpressure mode;
+    Output output;
+    std::shared_ptr<std::vector<unsigned char> > last;    // the last frame stored in the animation, to find what changed
+    std::mutex mutex;                                      // guards animation, last and turn while encoding an animation
+    std::condition_variable turned;                        // signals that an animation frame has been handled
+    std::vector<AnimationFrame> animation;                 // the stored frames, in capture order
+    bool recording;
+    int next;
+    unsigned issued, dropped;
+    std::atomic<unsigned> written;                         // frames encoded and saved, counted by the encode jobs
+    size_t frameBytes;                                     // the size of the animation's first frame
+    unsigned queued, turn;                                 // animation frames handed to the pool, and the one whose turn it is
+};
+
+} // namespace capture
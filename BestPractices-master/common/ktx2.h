@@ -0,0 +1,336 @@
+//"Copyright 2016 Intel Corporation.
+//
+//The source code, information and material("Material") contained herein is owned by Intel Corporation or its suppliers or licensors, and title to such Material 
+//remains with Intel Corporation or its suppliers or licensors.The Material contains proprietary information of Intel or its suppliers and licensors.
+//The Material is protected by worldwide copyright laws and treaty provisions.
+//No part of the Material may be used, copied, reproduced, modified, published, uploaded, posted, transmitted,distributed or disclosed in any way without Intel's prior express written permission. 
+//No license under any patent, copyright or other intellectual property rights in the Material is granted to or conferred upon you, either expressly, by implication, inducement, estoppel or otherwise. Any license under such intellectual property rights must be express and approved by Intel in writing.
+//Unless otherwise agreed by Intel in writing, you may not remove or alter this notice or any other notice embedded in 
+//Materials by Intel or Intel's suppliers or licensors in any way."
+
+
+
+
+#pragma once
+
+// Minimal KTX 2.0 container support for the lessons and tools.
+//
+// Handles single 2D images (one layer, one face) with any number of mip levels in the uncompressed RGBA formats listed
+// below, optional zlib supercompression (scheme 3, using LodePNG's zlib) and a key/value table.   Files are read through
+// a memory mapping, so a level that is not supercompressed can be handed to glTexImage2D without any copy.
+// All multi-byte fields are little-endian, which is what every platform the lessons run on uses natively.
+
+#include <lodepng.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ktx2
+{
+
+// Vulkan format numbers of the texel formats we read and write
+enum Format {
+    R8G8B8A8_UNORM      = 37,
+    R8G8B8A8_SRGB       = 43,
+    R16G16B16A16_UNORM  = 91,
+    R16G16B16A16_SFLOAT = 97,
+    R32G32B32A32_SFLOAT = 109,
+};
+
+// Supercompression schemes
+enum Scheme {
+    NONE = 0,
+    ZLIB = 3,
+};
+
+// Error codes, 0 means success
+enum Error {
+    OK = 0,
+    CANNOT_OPEN,
+    BAD_IDENTIFIER,
+    BAD_HEADER,
+    UNSUPPORTED,
+    TRUNCATED,
+    ZLIB_ERROR,
+};
+
+// File header, followed by one LevelIndex per mip level
+struct Header {
+    unsigned char identifier[12];
+    uint32_t vkFormat, typeSize, pixelWidth, pixelHeight, pixelDepth;
+    uint32_t layerCount, faceCount, levelCount, supercompressionScheme;
+    uint32_t dfdByteOffset, dfdByteLength, kvdByteOffset, kvdByteLength;
+    uint64_t sgdByteOffset, sgdByteLength;
+};
+struct LevelIndex {
+    uint64_t byteOffset, byteLength, uncompressedByteLength;
+};
+static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// Bytes per texel of a supported format, 0 for anything else
+inline uint32_t texelSize(uint32_t vkFormat)
+{
+    switch (vkFormat) {
+    case R8G8B8A8_UNORM:      return 4;
+    case R8G8B8A8_SRGB:       return 4;
+    case R16G16B16A16_UNORM:  return 8;
+    case R16G16B16A16_SFLOAT: return 8;
+    case R32G32B32A32_SFLOAT: return 16;
+    }
+    return 0;
+}
+
+#ifdef GL_RGBA8
+// OpenGL internal format, format and type that upload a supported format without any conversion
+inline bool glFormat(uint32_t vkFormat, GLint& internalFormat, GLenum& format, GLenum& type)
+{
+    format = GL_RGBA;
+    switch (vkFormat) {
+    case R8G8B8A8_UNORM:      internalFormat = GL_RGBA8;        type = GL_UNSIGNED_BYTE;  return true;
+    case R8G8B8A8_SRGB:       internalFormat = GL_SRGB8_ALPHA8; type = GL_UNSIGNED_BYTE;  return true;
+    case R16G16B16A16_UNORM:  internalFormat = GL_RGBA16;       type = GL_UNSIGNED_SHORT; return true;
+    case R16G16B16A16_SFLOAT: internalFormat = GL_RGBA16F;      type = GL_HALF_FLOAT;     return true;
+    case R32G32B32A32_SFLOAT: internalFormat = GL_RGBA32F;      type = GL_FLOAT;          return true;
+    }
+    return false;
+}
+#endif
+
+// Helpers for the writer
+inline void append32(std::vector<unsigned char>& out, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) out.push_back((unsigned char)(v >> (8 * i)));
+}
+inline void alignTo(std::vector<unsigned char>& out, size_t alignment)
+{
+    while (out.size() % alignment) out.push_back(0);
+}
+
+// Appends a Khronos Basic Data Format Descriptor for one of the supported RGBA formats
+inline void appendDfd(std::vector<unsigned char>& out, uint32_t vkFormat, bool supercompressed)
+{
+    const uint32_t bytes = texelSize(vkFormat), bits = bytes * 2;
+    const bool isFloat = vkFormat == R16G16B16A16_SFLOAT || vkFormat == R32G32B32A32_SFLOAT;
+    const bool isSrgb = vkFormat == R8G8B8A8_SRGB;
+    append32(out, 4 + 24 + 4 * 16);                                     // dfdTotalSize
+    append32(out, 0);                                                   // vendorId = Khronos, descriptorType = basic
+    append32(out, 2 | ((24 + 4 * 16) << 16));                           // versionNumber, descriptorBlockSize
+    append32(out, 1 | (1 << 8) | ((isSrgb ? 2 : 1) << 16));             // RGBSDA color model, BT.709 primaries, transfer function
+    append32(out, 0);                                                   // 1x1x1x1 texel block
+    append32(out, supercompressed ? 0 : bytes);                         // bytesPlane0, unsized when supercompressed
+    append32(out, 0);                                                   // bytesPlane4..7
+    for (uint32_t c = 0; c < 4; ++c) {
+        uint32_t channel = c < 3 ? c : 15;                              // R, G, B, A
+        if (isFloat) channel |= 0x80 | 0x40;                            // signed float
+        if (isSrgb && c == 3) channel |= 0x10;                          // alpha is linear
+        append32(out, (c * bits) | ((bits - 1) << 16) | (channel << 24));
+        append32(out, 0);                                               // sample position
+        append32(out, isFloat ? 0xBF800000 : 0);                        // lower, -1.0f for floats
+        append32(out, isFloat ? 0x3F800000 : (bits == 32 ? 0xFFFFFFFF : (1u << bits) - 1)); // upper, 1.0f for floats
+    }
+}
+
+// An image to be written.   Level 0 comes first and every level is tightly packed.
+struct Texture {
+    uint32_t vkFormat, width, height;
+    std::vector<std::vector<unsigned char> > levels;
+    std::vector<std::pair<std::string, std::string> > keyValues;
+};
+
+// Encodes a texture into a KTX 2.0 file in memory
+inline unsigned encode(std::vector<unsigned char>& out, const Texture& tex, uint32_t scheme = NONE,
+                       const LodePNGCompressSettings& settings = lodepng_default_compress_settings)
+{
+    const uint32_t bytes = texelSize(tex.vkFormat), levels = (uint32_t)tex.levels.size();
+    if (!bytes || (scheme != NONE && scheme != ZLIB))                   return UNSUPPORTED;
+    if (!tex.width || !tex.height || !levels)                           return BAD_HEADER;
+    for (uint32_t i = 0; i < levels; ++i) {
+        uint32_t w = tex.width >> i, h = tex.height >> i;
+        if (tex.levels[i].size() != (size_t)(w ? w : 1) * (h ? h : 1) * bytes) return BAD_HEADER;
+    }
+
+    // header, level index, data format descriptor and key/value data, in file order
+    Header hdr = {};
+    memcpy(hdr.identifier, identifier, sizeof(identifier));
+    hdr.vkFormat = tex.vkFormat; hdr.typeSize = bytes / 4;
+    hdr.pixelWidth = tex.width; hdr.pixelHeight = tex.height;
+    hdr.faceCount = 1; hdr.levelCount = levels; hdr.supercompressionScheme = scheme;
+    out.assign(sizeof(Header) + levels * sizeof(LevelIndex), 0);
+    hdr.dfdByteOffset = (uint32_t)out.size();
+    appendDfd(out, tex.vkFormat, scheme != NONE);
+    hdr.dfdByteLength = (uint32_t)out.size() - hdr.dfdByteOffset;
+    std::vector<std::pair<std::string, std::string> > kv(tex.keyValues);
+    std::sort(kv.begin(), kv.end());
+    hdr.kvdByteOffset = kv.empty() ? 0 : (uint32_t)out.size();
+    for (size_t i = 0; i < kv.size(); ++i) {
+        append32(out, (uint32_t)(kv[i].first.size() + kv[i].second.size() + 2));
+        out.insert(out.end(), kv[i].first.begin(), kv[i].first.end());   out.push_back(0);
+        out.insert(out.end(), kv[i].second.begin(), kv[i].second.end()); out.push_back(0);
+        alignTo(out, 4);
+    }
+    hdr.kvdByteLength = kv.empty() ? 0 : (uint32_t)out.size() - hdr.kvdByteOffset;
+
+    // mip levels are stored smallest first, aligned to the texel size unless they are supercompressed
+    std::vector<LevelIndex> index(levels);
+    for (uint32_t i = levels; i-- > 0;) {
+        const std::vector<unsigned char>& texels = tex.levels[i];
+        if (scheme == NONE) alignTo(out, bytes);
+        index[i].byteOffset = out.size();
+        index[i].uncompressedByteLength = texels.size();
+        if (scheme == ZLIB) {
+            std::vector<unsigned char> packed;
+            if (lodepng::compress(packed, &texels[0], texels.size(), settings)) return ZLIB_ERROR;
+            out.insert(out.end(), packed.begin(), packed.end());
+        } else {
+            out.insert(out.end(), texels.begin(), texels.end());
+        }
+        index[i].byteLength = out.size() - index[i].byteOffset;
+    }
+    memcpy(&out[0], &hdr, sizeof(hdr));
+    memcpy(&out[sizeof(hdr)], &index[0], levels * sizeof(LevelIndex));
+    return OK;
+}
+
+// Encodes a texture and writes it to disk
+inline unsigned save(const std::string& filename, const Texture& tex, uint32_t scheme = NONE)
+{
+    std::vector<unsigned char> file;
+    if (unsigned error = encode(file, tex, scheme)) return error;
+    return lodepng::save_file(file, filename) ? CANNOT_OPEN : OK;
+}
+
+// A KTX 2.0 file opened for reading.   Either memory maps a file from disk or wraps a buffer owned by the caller.
+class File
+{
+public:
+    File() : data(0), size(0), mapped(false) {}
+    ~File() { close(); }
+
+    // Memory maps a file and validates its header
+    unsigned open(const std::string& filename)
+    {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (INVALID_HANDLE_VALUE == file) return CANNOT_OPEN;
+        LARGE_INTEGER sz; HANDLE mapping = NULL;
+        if (GetFileSizeEx(file, &sz) && sz.QuadPart)
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            size = (size_t)sz.QuadPart;
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return CANNOT_OPEN;
+        struct stat st;
+        if (!fstat(fd, &st) && st.st_size) {
+            void* p = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) { data = (const unsigned char*)p; size = (size_t)st.st_size; }
+        }
+        ::close(fd);
+#endif
+        if (!data) { size = 0; return CANNOT_OPEN; }
+        mapped = true;
+        return validate();
+    }
+
+    // Wraps a file already in memory.   The buffer must outlive this object.
+    unsigned parse(const unsigned char* buffer, size_t bufferSize)
+    {
+        close();
+        data = buffer; size = bufferSize;
+        return validate();
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (mapped) UnmapViewOfFile(data);
+#else
+        if (mapped) munmap((void*)data, size);
+#endif
+        data = 0; size = 0; mapped = false;
+    }
+
+    const Header& header() const { return *(const Header*)data; }
+    const LevelIndex& levelIndex(uint32_t i) const { return ((const LevelIndex*)(data + sizeof(Header)))[i]; }
+    uint32_t width(uint32_t i) const  { uint32_t w = header().pixelWidth >> i;  return w ? w : 1; }
+    uint32_t height(uint32_t i) const { uint32_t h = header().pixelHeight >> i; return h ? h : 1; }
+
+    // Texels of mip level i.   Points straight into the file unless the level is supercompressed, in which case the
+    // level is inflated into scratch and texels points there.
+    unsigned level(uint32_t i, const unsigned char*& texels, size_t& texelsSize, std::vector<unsigned char>& scratch) const
+    {
+        const LevelIndex& li = levelIndex(i);
+        if (header().supercompressionScheme == NONE) {
+            texels = data + li.byteOffset; texelsSize = (size_t)li.byteLength;
+            return OK;
+        }
+        if (lodepng::decompress(scratch, data + li.byteOffset, (size_t)li.byteLength)) return ZLIB_ERROR;
+        if (scratch.size() != li.uncompressedByteLength)                                 return ZLIB_ERROR;
+        texels = &scratch[0]; texelsSize = scratch.size();
+        return OK;
+    }
+
+    // Value stored for a key in the key/value data, NULL if there is no such key
+    const char* value(const char* key) const
+    {
+        const Header& hdr = header();
+        for (size_t pos = hdr.kvdByteOffset, end = pos + hdr.kvdByteLength; pos + 4 <= end;) {
+            uint32_t len; memcpy(&len, data + pos, 4);
+            const char* entry = (const char*)data + pos + 4;
+            if (len > end - pos - 4) break;
+            if (!strncmp(entry, key, len) && strlen(key) < len) return entry + strlen(key) + 1;
+            pos += (4 + len + 3) & ~3u;
+        }
+        return 0;
+    }
+
+private:
+    File(const File&);
+    File& operator=(const File&);
+
+    // Checks that the header describes something we support and that every table and level lies inside the file
+    unsigned validate() const
+    {
+        if (size < sizeof(Header))                                                          return TRUNCATED;
+        const Header& hdr = header();
+        if (memcmp(hdr.identifier, identifier, sizeof(identifier)))                        return BAD_IDENTIFIER;
+        if (!texelSize(hdr.vkFormat) || hdr.pixelDepth || hdr.layerCount || hdr.faceCount != 1) return UNSUPPORTED;
+        if (hdr.supercompressionScheme != NONE && hdr.supercompressionScheme != ZLIB)       return UNSUPPORTED;
+        if (!hdr.pixelWidth || !hdr.pixelHeight || !hdr.levelCount || hdr.levelCount > 32)   return BAD_HEADER;
+        if (sizeof(Header) + hdr.levelCount * sizeof(LevelIndex) > size)                    return TRUNCATED;
+        if ((uint64_t)hdr.kvdByteOffset + hdr.kvdByteLength > size)                         return TRUNCATED;
+        for (uint32_t i = 0; i < hdr.levelCount; ++i) {
+            const LevelIndex& li = levelIndex(i);
+            if (li.byteOffset > size || li.byteLength > size - li.byteOffset)               return TRUNCATED;
+            uint64_t expected = (uint64_t)width(i) * height(i) * texelSize(hdr.vkFormat);
+            if (li.uncompressedByteLength != expected)                                      return BAD_HEADER;
+            if (hdr.supercompressionScheme == NONE && li.byteLength != expected)            return BAD_HEADER;
+        }
+        return OK;
+    }
+
+    const unsigned char* data;
+    size_t size;
+    bool mapped;
+};
+
+} // namespace ktx2
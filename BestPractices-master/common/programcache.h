@@ -0,0 +1,111 @@
+//"Copyright 2016 Intel Corporation.
+//
+//The source code, information and material("Material") contained herein is owned by Intel Corporation or its suppliers or licensors, and title to such Material 
+//remains with Intel Corporation or its suppliers or licensors.The Material contains proprietary information of Intel or its suppliers and licensors.
+//The Material is protected by worldwide copyright laws and treaty provisions.
+//No part of the Material may be used, copied, reproduced, modified, published, uploaded, posted, transmitted,distributed or disclosed in any way without Intel's prior express written permission. 
+//No license under any patent, copyright or other intellectual property rights in the Material is granted to or conferred upon you, either expressly, by implication, inducement, estoppel or otherwise. Any license under such intellectual property rights must be express and approved by Intel in writing.
+//Unless otherwise agreed by Intel in writing, you may not remove or alter this notice or any other notice embedded in 
+//Materials by Intel or Intel's suppliers or licensors in any way."
+
+
+
+
+
+
+
+#pragma once
+
+// Program binary cache.
+//
+// Linking a program from GLSL source is the slowest part of starting a lesson.   The first time a program is built its
+// binary is read back with glGetProgramBinary and saved to a file named after a hash of the shader sources and of the
+// driver's vendor, renderer and version strings, so a driver update or another GPU never picks up a stale binary.
+// Later runs load the file with glProgramBinary; when there is no file or the driver rejects the binary the program is
+// built from source again and the file replaced.   Programs that are built must be linked with
+// GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.   Include after GL/glew.h.
+
+#include <lodepng.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+class ProgramCache
+{
+public:
+    ProgramCache(const std::string& prefix = "program") : prefix(prefix), loaded(0), built(0) {}
+
+    // Returns the program linked from the given shader sources, loaded from the cache or, on a miss, made by build()
+    // and stored.   The sources only identify the program, build() still compiles them itself.
+    GLuint get(std::initializer_list<const std::string*> sources, const std::function<GLuint()>& build)
+    {
+        std::string file = filename(sources);
+        GLuint program = load(file);
+        if (program) { ++loaded; return program; }
+        program = build(); ++built;
+        if (program) store(file, program);
+        return program;
+    }
+
+    // Number of programs loaded from the cache and built from source so far
+    unsigned hits() const { return loaded; }
+    unsigned misses() const { return built; }
+
+private:
+    // 64-bit FNV-1a
+    static unsigned long long hash(unsigned long long h, const char* s, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i) h = (h ^ (unsigned char)s[i]) * 1099511628211ull;
+        return h;
+    }
+
+    std::string filename(std::initializer_list<const std::string*> sources) const
+    {
+        unsigned long long h = 14695981039346656037ull;
+        const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (int i = 0; i < 3; ++i) {
+            const char* s = (const char*)glGetString(strings[i]);
+            if (s) h = hash(h, s, strlen(s) + 1);
+        }
+        for (auto src : sources) h = hash(h, src->c_str(), src->size() + 1);
+        char name[32]; sprintf_s(name, "_%016llx.bin", h);
+        return prefix + name;
+    }
+
+    // A cache file is the binary format followed by the binary
+    GLuint load(const std::string& file)
+    {
+        GLint formats = 0; glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        std::vector<unsigned char> data;
+        if (!formats || lodepng::load_file(data, file) || data.size() <= sizeof(GLenum)) return 0;
+        GLenum format; memcpy(&format, &data[0], sizeof(format));
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, format, &data[sizeof(format)], (GLsizei)(data.size() - sizeof(format)));
+        // an unknown format raises GL_INVALID_ENUM, which is a miss too and mustn't be left for the next GLCHK
+        bool failed = false;
+        while (GL_NO_ERROR != glGetError()) failed = true;
+        GLint status = GL_FALSE; if (!failed) glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (GL_FALSE == status) { glDeleteProgram(program); return 0; }
+        return program;
+    }
+
+    void store(const std::string& file, GLuint program)
+    {
+        GLint size = 0; glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+        if (size <= 0) return;
+        std::vector<unsigned char> data(sizeof(GLenum) + size);
+        GLenum format;
+        glGetProgramBinary(program, size, &size, &format, &data[sizeof(format)]);
+        memcpy(&data[0], &format, sizeof(format));
+        data.resize(sizeof(format) + size);
+        lodepng::save_file(data, file);
+    }
+
+    std::string prefix;
+    unsigned loaded, built;
+};
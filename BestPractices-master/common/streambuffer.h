@@ -0,0 +1,108 @@
+//"Copyright 2016 Intel Corporation.
+//
+//The source code, information and material("Material") contained herein is owned by Intel Corporation or its suppliers or licensors, and title to such Material 
+//remains with Intel Corporation or its suppliers or licensors.The Material contains proprietary information of Intel or its suppliers and licensors.
+//The Material is protected by worldwide copyright laws and treaty provisions.
+//No part of the Material may be used, copied, reproduced, modified, published, uploaded, posted, transmitted,distributed or disclosed in any way without Intel's prior express written permission. 
+//No license under any patent, copyright or other intellectual property rights in the Material is granted to or conferred upon you, either expressly, by implication, inducement, estoppel or otherwise. Any license under such intellectual property rights must be express and approved by Intel in writing.
+//Unless otherwise agreed by Intel in writing, you may not remove or alter this notice or any other notice embedded in 
+//Materials by Intel or Intel's suppliers or licensors in any way."
+
+
+
+
+
+
+
+#pragma once
+
+// Streaming ring buffer for per-draw data.
+//
+// One buffer object is created with glBufferStorage and stays persistently and coherently mapped for writing.   It is
+// split into regions, one per frame in flight.   Every frame writes into its own region; begin() waits on the fence
+// that end() placed after the last frame that used the region, so the CPU never overwrites data the GPU may still read
+// and the driver never has to copy or rename the buffer.   Needs GL_ARB_buffer_storage (core in OpenGL 4.4).
+// Include after GL/glew.h.
+
+class StreamBuffer
+{
+public:
+    enum { maxRegions = 4 };
+
+    StreamBuffer() : buffer(0), ptr(0), regionSize(0), regions(0), region(0), head(0), alignment(1)
+    {
+        for (int i = 0; i < maxRegions; ++i) fence[i] = 0;
+    }
+
+    // Creates and maps the buffer.   alignment is the offset alignment of the binding point the data is used through,
+    // e.g. GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.   Returns false if persistent mapping isn't supported.
+    bool create(GLsizeiptr regionBytes, GLint offsetAlignment, unsigned regionCount = 3)
+    {
+        if (!GLEW_ARB_buffer_storage || regionCount > maxRegions) return false;
+        destroy();
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        alignment = offsetAlignment > 0 ? offsetAlignment : 1;
+        regionSize = (regionBytes + alignment - 1) / alignment * alignment;
+        regions = regionCount; region = head = 0;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize * regions, NULL, flags);
+        ptr = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * regions, flags);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return ptr != 0;
+    }
+
+    // Unmaps and deletes the buffer and its fences
+    void destroy()
+    {
+        for (int i = 0; i < maxRegions; ++i) if (fence[i]) { glDeleteSync(fence[i]); fence[i] = 0; }
+        if (buffer) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            glDeleteBuffers(1, &buffer);
+        }
+        buffer = 0; ptr = 0;
+    }
+
+    // Starts a frame: waits until the GPU is done with the region this frame writes to
+    void begin()
+    {
+        if (fence[region]) {
+            glClientWaitSync(fence[region], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fence[region]); fence[region] = 0;
+        }
+        head = 0;
+    }
+
+    // Reserves bytes in this frame's region.   Returns where to write them and sets the buffer offset to bind or source
+    // them from, or returns NULL when the region is full.
+    void* alloc(GLsizeiptr bytes, GLintptr& offset)
+    {
+        GLsizeiptr start = (head + alignment - 1) / alignment * alignment;
+        if (start + bytes > regionSize) return 0;
+        head = start + bytes;
+        offset = region * regionSize + start;
+        return ptr + offset;
+    }
+
+    // Ends a frame: fences the region after the last command that reads it and moves on to the next region
+    void end()
+    {
+        fence[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region = (region + 1) % regions;
+    }
+
+    GLuint name() const { return buffer; }
+
+private:
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer& operator=(const StreamBuffer&);
+
+    GLuint buffer;
+    unsigned char* ptr;
+    GLsizeiptr regionSize;
+    unsigned regions, region;
+    GLsizeiptr head, alignment;
+    GLsync fence[maxRegions];
+};
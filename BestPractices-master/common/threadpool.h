@@ -0,0 +1,119 @@
+//"Copyright 2016 Intel Corporation.
+//
+//The source code, information and material("Material") contained herein is owned by Intel Corporation or its suppliers or licensors, and title to such Material 
+//remains with Intel Corporation or its suppliers or licensors.The Material contains proprietary information of Intel or its suppliers and licensors.
+//The Material is protected by worldwide copyright laws and treaty provisions.
+//No part of the Material may be used, copied, reproduced, modified, published, uploaded, posted, transmitted,distributed or disclosed in any way without Intel's prior express written permission. 
+//No license under any patent, copyright or other intellectual property rights in the Material is granted to or conferred upon you, either expressly, by implication, inducement, estoppel or otherwise. Any license under such intellectual property rights must be express and approved by Intel in writing.
+//Unless otherwise agreed by Intel in writing, you may not remove or alter this notice or any other notice embedded in 
+//Materials by Intel or Intel's suppliers or licensors in any way."
+
+
+
+
+#pragma once
+
+// Small fixed-size thread pool for the lessons and tools.
+//
+// Jobs run in submission order on a set of worker threads.   The queue can be bounded, in which case trySubmit() refuses
+// work while it is full and submit() blocks until a worker frees a place, so the caller chooses between dropping work
+// and applying back-pressure.
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    // threads = 0 uses one thread per hardware thread, capacity = 0 leaves the queue unbounded
+    explicit ThreadPool(unsigned threads = 0, size_t capacity = 0) : capacity(capacity), running(0), stopping(false)
+    {
+        if (!threads) threads = std::thread::hardware_concurrency();
+        if (!threads) threads = 1;
+        for (unsigned i = 0; i < threads; ++i) workers.push_back(std::thread(&ThreadPool::work, this));
+    }
+
+    // Finishes the queued jobs, then joins the workers
+    ~ThreadPool()
+    {
+        wait();
+        { std::lock_guard<std::mutex> lock(mutex); stopping = true; }
+        queued.notify_all();
+        for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+    }
+
+    // Queues a job unless the queue is full.   Returns false if the job was refused.
+    bool trySubmit(const std::function<void()>& job)
+    {
+        { std::lock_guard<std::mutex> lock(mutex);
+          if (capacity && jobs.size() >= capacity) return false;
+          jobs.push_back(job); }
+        queued.notify_one();
+        return true;
+    }
+
+    // Queues a job, blocking while the queue is full
+    void submit(const std::function<void()>& job)
+    {
+        { std::unique_lock<std::mutex> lock(mutex);
+          while (capacity && jobs.size() >= capacity) changed.wait(lock);
+          jobs.push_back(job); }
+        queued.notify_one();
+    }
+
+    // Blocks until every queued job has finished
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!jobs.empty() || running) changed.wait(lock);
+    }
+
+    // Drops the jobs that haven't started yet
+    void cancel()
+    {
+        { std::lock_guard<std::mutex> lock(mutex); jobs.clear(); }
+        changed.notify_all();
+    }
+
+    // True if the queue is bounded and full
+    bool full()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return capacity && jobs.size() >= capacity;
+    }
+
+    size_t threads() const { return workers.size(); }
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            while (jobs.empty() && !stopping) queued.wait(lock);
+            if (jobs.empty()) return;
+            std::function<void()> job = jobs.front(); jobs.pop_front();
+            ++running;
+            lock.unlock();
+            changed.notify_all();
+            job();
+            lock.lock();
+            --running;
+            changed.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > jobs;
+    std::mutex mutex;
+    std::condition_variable queued, changed;
+    size_t capacity;
+    unsigned running;
+    bool stopping;
+};
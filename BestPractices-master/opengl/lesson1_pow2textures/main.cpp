@@ -14,6 +14,7 @@
 #include <GL/wglew.h>
 #include <GL/glut.h>
 #include <lodepng.h>
+#include <capture.h>
 
 #include <vector>
 
@@ -74,6 +75,7 @@ static GLint offset, texUnit;
 static GLfloat animation;
 static unsigned selector, w, h, w2, h2;
 static bool swap, animating;
+static capture::Recorder recorder("lesson1");
 
 // Debug build performs OpenGL error checking, Release does not
 #ifdef _DEBUG
@@ -192,6 +194,7 @@ void display()
     }
     glBindTexture(GL_TEXTURE_2D, texture[selector]);                                            GLCHK;
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                                      GLCHK;
+    recorder.frame();
     glutSwapBuffers();
 }
 
@@ -208,6 +211,10 @@ void keyboard(unsigned char key, int, int)
     // end on <esc> keypress
     if (key == 27) exit(0);
     if (key == ' ') swap = true;
+    if (key == 'c') recorder.toggle(capture::DROP);
+    if (key == 'C') recorder.toggle(capture::BLOCK);
+    if (key == 'a') recorder.toggle(capture::DROP, capture::APNG_FILE);
+    if (key == 'A') recorder.toggle(capture::BLOCK, capture::APNG_FILE);
 }
 
 // Static function to print currently selected test item's state.  Called every time the user presses <space>.
@@ -292,6 +299,8 @@ int main(int argc, char** argv)
         printf("OpenGL renderer string: %s\n", glGetString(GL_RENDERER));
         printf("OpenGL version string: %s\n\n", glGetString(GL_VERSION));
         puts("This lesson compares the read performance between using Power-of-Two textures and Non-Power-of-Two textures.");
+        puts("Press <c> to start or stop capturing frames to PNG files, <C> to capture without dropping frames.");
+        puts("Press <a> to start or stop capturing an animated PNG of the frames, <A> to capture it without dropping frames.");
         puts("Press <esc> to exit; <space bar> to switch between texture sizes ...\n");
         print();
         glutMainLoop();
@@ -14,6 +14,9 @@
 #include <GL/wglew.h>
 #include <GL/glut.h>
 #include <lodepng.h>
+#include <lodepng_util.h>
+#include <capture.h>
+#include <programcache.h>
 
 #include <vector>
 
@@ -105,43 +108,46 @@ static GLint offset, texUnit;
 static GLfloat animation;
 static unsigned selector;
 static bool advance, animating;
+static capture::Recorder recorder("lesson2");
+static ProgramCache programCache("lesson2");
 
 // Array of structures, one item for each option we're testing
-#define F(x,y,z) x, y, #x, 0, z
+// The upload type matches the precision of the format, so the driver doesn't convert the pixels on upload
+#define F(x,y,d,z) x, y, d, #x, #d, 0, z
 static struct {
-    GLint fmt, type;
-    const char* str;
+    GLint fmt, type, data;
+    const char* str, *dataStr;
     GLuint obj, &pgm;
 } textures[] = {
-    F(GL_RGBA8,          GL_RGBA,         program), 
-    F(GL_RGBA16,         GL_RGBA,         program),
-    F(GL_RGBA8_SNORM,    GL_RGBA,         program),
-    F(GL_RGBA16_SNORM,   GL_RGBA,         program),
-    F(GL_RGBA16F,        GL_RGBA,         program),
-    F(GL_RGBA32F,        GL_RGBA,         program),
-    F(GL_RGBA8I,         GL_RGBA_INTEGER, iprogram),
-    F(GL_RGBA16I,        GL_RGBA_INTEGER, iprogram),
-    F(GL_RGBA32I,        GL_RGBA_INTEGER, iprogram),
-    F(GL_RGBA8UI,        GL_RGBA_INTEGER, uprogram),
-    F(GL_RGBA16UI,       GL_RGBA_INTEGER, uprogram),
-    F(GL_RGBA32UI,       GL_RGBA_INTEGER, uprogram),
-    F(GL_RGB10_A2,       GL_RGBA,         program),
-    F(GL_RGB10_A2UI,     GL_RGBA_INTEGER, uprogram),
-    F(GL_R11F_G11F_B10F, GL_RGBA,         program),
-    F(GL_SRGB8_ALPHA8,   GL_RGBA,         program),
-    F(GL_RGB8,           GL_RGBA,         program),
-    F(GL_RGB16,          GL_RGBA,         program),
-    F(GL_RGB8_SNORM,     GL_RGBA,         program),
-    F(GL_RGB16_SNORM,    GL_RGBA,         program),
-    F(GL_RGB16F,         GL_RGBA,         program),
-    F(GL_RGB32F,         GL_RGBA,         program),
-    F(GL_RGB8I,          GL_RGBA_INTEGER, iprogram),
-    F(GL_RGB16I,         GL_RGBA_INTEGER, iprogram),
-    F(GL_RGB32I,         GL_RGBA_INTEGER, iprogram),
-    F(GL_RGB8UI,         GL_RGBA_INTEGER, uprogram),
-    F(GL_RGB16UI,        GL_RGBA_INTEGER, uprogram),
-    F(GL_RGB32UI,        GL_RGBA_INTEGER, uprogram),
-    F(GL_SRGB8,          GL_RGBA,         program),
+    F(GL_RGBA8,          GL_RGBA,         GL_UNSIGNED_BYTE,  program), 
+    F(GL_RGBA16,         GL_RGBA,         GL_UNSIGNED_SHORT, program),
+    F(GL_RGBA8_SNORM,    GL_RGBA,         GL_UNSIGNED_BYTE,  program),
+    F(GL_RGBA16_SNORM,   GL_RGBA,         GL_UNSIGNED_BYTE,  program),
+    F(GL_RGBA16F,        GL_RGBA,         GL_HALF_FLOAT,     program),
+    F(GL_RGBA32F,        GL_RGBA,         GL_FLOAT,          program),
+    F(GL_RGBA8I,         GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  iprogram),
+    F(GL_RGBA16I,        GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  iprogram),
+    F(GL_RGBA32I,        GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  iprogram),
+    F(GL_RGBA8UI,        GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  uprogram),
+    F(GL_RGBA16UI,       GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  uprogram),
+    F(GL_RGBA32UI,       GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  uprogram),
+    F(GL_RGB10_A2,       GL_RGBA,         GL_UNSIGNED_BYTE,  program),
+    F(GL_RGB10_A2UI,     GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  uprogram),
+    F(GL_R11F_G11F_B10F, GL_RGBA,         GL_UNSIGNED_BYTE,  program),
+    F(GL_SRGB8_ALPHA8,   GL_RGBA,         GL_UNSIGNED_BYTE,  program),
+    F(GL_RGB8,           GL_RGBA,         GL_UNSIGNED_BYTE,  program),
+    F(GL_RGB16,          GL_RGBA,         GL_UNSIGNED_SHORT, program),
+    F(GL_RGB8_SNORM,     GL_RGBA,         GL_UNSIGNED_BYTE,  program),
+    F(GL_RGB16_SNORM,    GL_RGBA,         GL_UNSIGNED_BYTE,  program),
+    F(GL_RGB16F,         GL_RGBA,         GL_HALF_FLOAT,     program),
+    F(GL_RGB32F,         GL_RGBA,         GL_FLOAT,          program),
+    F(GL_RGB8I,          GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  iprogram),
+    F(GL_RGB16I,         GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  iprogram),
+    F(GL_RGB32I,         GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  iprogram),
+    F(GL_RGB8UI,         GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  uprogram),
+    F(GL_RGB16UI,        GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  uprogram),
+    F(GL_RGB32UI,        GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,  uprogram),
+    F(GL_SRGB8,          GL_RGBA,         GL_UNSIGNED_BYTE,  program),
 };
 
 // Debug build performs OpenGL error checking, Release does not
@@ -173,6 +179,7 @@ static GLuint createProgram(std::initializer_list<GLuint> shaders)
 {
     GLuint program = glCreateProgram();                                                                 GLCHK;
     for (auto shader : shaders) glAttachShader(program, shader);                                        GLCHK;
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);                          GLCHK;
     glLinkProgram(program);                                                                             GLCHK;
     GLint status; glGetProgramiv(program, GL_LINK_STATUS, &status); if (GL_FALSE == status) {           GLCHK;
         GLint sz; glGetProgramiv(program, GL_INFO_LOG_LENGTH, &sz);                                     GLCHK;
@@ -186,6 +193,13 @@ static GLuint createProgram(std::initializer_list<GLuint> shaders)
     return program;
 }
 
+// Static function to compile the vertex shader the programs share, the first time a program is built from source
+static GLuint sharedVertexShader()
+{
+    if (!vShader) vShader = compileShader(vertexShader, GL_VERTEX_SHADER);
+    return vShader;
+}
+
 // Static function to check for minimum OpenGL version (which is 4.3 for now0
 static void versionCheck()
 {
@@ -202,6 +216,9 @@ static void versionCheck()
     }
 }
 
+// Static function.  Calculates elapsed time in microseconds.
+static unsigned __int64 elapsedUS(unsigned __int64 now, unsigned __int64 start);
+
 // GLUT initialization function.   Initialize program state as defined in static variables.
 void init()
 {
@@ -210,14 +227,17 @@ void init()
     // turn off vsync
     if (!wglSwapIntervalEXT(0))                                                                         __debugbreak();
 
-    // compile and link the shaders into a program, make it active
-    vShader  = compileShader(vertexShader, GL_VERTEX_SHADER);
-    fShader  = compileShader(fragmentShader, GL_FRAGMENT_SHADER);
-    ifShader = compileShader(ifragmentShader, GL_FRAGMENT_SHADER);
-    ufShader = compileShader(ufragmentShader, GL_FRAGMENT_SHADER);
-    program  = createProgram({ vShader, fShader });
-    iprogram = createProgram({ vShader, ifShader });
-    uprogram = createProgram({ vShader, ufShader });
+    // compile and link the shaders into programs or load them from the program binary cache, make one active
+    unsigned __int64 start, now; if (!QueryPerformanceCounter((PLARGE_INTEGER)&start))                  __debugbreak();
+    program  = programCache.get({ &vertexShader, &fragmentShader }, [] {
+        fShader = compileShader(fragmentShader, GL_FRAGMENT_SHADER); return createProgram({ sharedVertexShader(), fShader }); });
+    iprogram = programCache.get({ &vertexShader, &ifragmentShader }, [] {
+        ifShader = compileShader(ifragmentShader, GL_FRAGMENT_SHADER); return createProgram({ sharedVertexShader(), ifShader }); });
+    uprogram = programCache.get({ &vertexShader, &ufragmentShader }, [] {
+        ufShader = compileShader(ufragmentShader, GL_FRAGMENT_SHADER); return createProgram({ sharedVertexShader(), ufShader }); });
+    if (!QueryPerformanceCounter((PLARGE_INTEGER)&now))                                                 __debugbreak();
+    printf("shader programs: %u loaded from cache, %u compiled, in %f milliseconds\n\n",
+        programCache.hits(), programCache.misses(), elapsedUS(now, start) / 1000.);
     offset = glGetUniformLocation(program, "offset");                                                   GLCHK;
     texUnit = glGetUniformLocation(program, "texUnit");                                                 GLCHK;
     glUseProgram(program);                                                                              GLCHK;
@@ -226,9 +246,13 @@ void init()
     glActiveTexture(GL_TEXTURE0);                                                                       GLCHK;
     glUniform1i(texUnit, 0);                                                                            GLCHK;
 
-    // load an RGBA8 image
-    std::vector<GLubyte> img; GLuint w, h;
-    if (lodepng::decode(img, w, h, "sample.png"))                                                         __debugbreak();
+    // load the image as RGBA8, RGBA16, half float and float, each the way the textures using it expect the data
+    std::vector<GLubyte> png, img; std::vector<GLushort> img16, img16f; std::vector<GLfloat> img32f; GLuint w, h;
+    if (lodepng::load_file(png, "sample.png"))                                                          __debugbreak();
+    if (lodepng::decode(img, w, h, png))                                                                __debugbreak();
+    if (lodepng::decodeRGBA16(img16, w, h, png))                                                        __debugbreak();
+    if (lodepng::decodeRGBA16F(img16f, w, h, png))                                                      __debugbreak();
+    if (lodepng::decodeRGBA32F(img32f, w, h, png))                                                      __debugbreak();
 
     // create and configure the textures
     for (int i = 0; i < _countof(textures); ++i) {
@@ -239,7 +263,10 @@ void init()
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);                              GLCHK;
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);                              GLCHK;
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);                                                          GLCHK;
-        glTexImage2D(GL_TEXTURE_2D, 0, textures[i].fmt, w, h, 0, textures[i].type, GL_UNSIGNED_BYTE, &img[0]);   GLCHK;
+        const GLvoid* data = textures[i].data == GL_UNSIGNED_SHORT ? (const GLvoid*)&img16[0] :
+                             textures[i].data == GL_HALF_FLOAT ? (const GLvoid*)&img16f[0] :
+                             textures[i].data == GL_FLOAT ? (const GLvoid*)&img32f[0] : (const GLvoid*)&img[0];
+        glTexImage2D(GL_TEXTURE_2D, 0, textures[i].fmt, w, h, 0, textures[i].type, textures[i].data, data); GLCHK;
     }
 }
 
@@ -257,6 +284,7 @@ void display()
         glUniform1f(offset, 0.f);                                                                       GLCHK;
     }
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                                              GLCHK;
+    recorder.frame();
     glutSwapBuffers();
 }
 
@@ -273,12 +301,16 @@ void keyboard(unsigned char key, int, int)
     // end on <esc> keypress
     if (key == 27) exit(0);
     if (key == ' ') advance = true;
+    if (key == 'c') recorder.toggle(capture::DROP);
+    if (key == 'C') recorder.toggle(capture::BLOCK);
+    if (key == 'a') recorder.toggle(capture::DROP, capture::APNG_FILE);
+    if (key == 'A') recorder.toggle(capture::BLOCK, capture::APNG_FILE);
 }
 
 // Static function to print currently selected test item's state.  Called every time the user presses <space>.
 void print()
 {
-    printf("\n*** measuring texture format %s\n", textures[selector].str);
+    printf("\n*** measuring texture format %s, uploaded as %s\n", textures[selector].str, textures[selector].dataStr);
 }
 
 // Static function.  Calculates elapsed time in microseconds.
@@ -356,6 +388,8 @@ int main(int argc, char** argv)
         printf("OpenGL renderer string: %s\n", glGetString(GL_RENDERER));
         printf("OpenGL version string: %s\n\n", glGetString(GL_VERSION));
         puts("This lesson compares the read performance of several different texture formats.");
+        puts("Press <c> to start or stop capturing frames to PNG files, <C> to capture without dropping frames.");
+        puts("Press <a> to start or stop capturing an animated PNG of the frames, <A> to capture it without dropping frames.");
         puts("Press <esc> to exit; <space bar> to switch between texture formats ...");
         print();
         glutMainLoop();
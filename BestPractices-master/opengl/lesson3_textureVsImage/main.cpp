@@ -14,6 +14,9 @@
 #include <GL/wglew.h>
 #include <GL/glut.h>
 #include <lodepng.h>
+#include <ktx2.h>
+#include <capture.h>
+#include <programcache.h>
 
 #include <vector>
 
@@ -92,6 +95,8 @@ static GLint  texTexUnit, imgTexUnit;
 static GLfloat animation;
 static unsigned selector;
 static bool advance, animating, mode;
+static capture::Recorder recorder("lesson3");
+static ProgramCache programCache("lesson3");
 
 // Array of structures, one item for each option we're testing
 #define I(texture, magFilter, minFilter, maxLevel, baseLevel) texture, #texture, magFilter, #magFilter, minFilter, #minFilter, maxLevel, baseLevel
@@ -141,6 +146,7 @@ static GLuint createProgram(std::initializer_list<GLuint> shaders)
 {
     GLuint program = glCreateProgram();                                                                         GLCHK;
     for (auto shader : shaders) glAttachShader(program, shader);                                                GLCHK;
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);                                  GLCHK;
     glLinkProgram(program);                                                                                     GLCHK;
     GLint status; glGetProgramiv(program, GL_LINK_STATUS, &status); if (GL_FALSE == status) {                   GLCHK;
         GLint sz; glGetProgramiv(program, GL_INFO_LOG_LENGTH, &sz);                                             GLCHK;
@@ -154,6 +160,63 @@ static GLuint createProgram(std::initializer_list<GLuint> shaders)
     return program;
 }
 
+// Static function to compile the vertex shader the programs share, the first time a program is built from source
+static GLuint sharedVertexShader()
+{
+    if (!vShader) vShader = compileShader(vertexShader, GL_VERTEX_SHADER);
+    return vShader;
+}
+
+// Static function.  Calculates elapsed time in microseconds.
+static unsigned __int64 elapsedUS(unsigned __int64 now, unsigned __int64 start);
+
+// Static function.  64-bit FNV-1a hash, used to key the texture cache on the source image and its processing parameters.
+static unsigned __int64 fnv1a(const void* data, size_t size, unsigned __int64 h = 14695981039346656037ui64)
+{
+    for (size_t i = 0; i < size; ++i) h = (h ^ ((const unsigned char*)data)[i]) * 1099511628211ui64;
+    return h;
+}
+
+// Static function to upload all mip levels of the currently bound texture straight from a memory mapped KTX2 cache file.
+// Returns false if the file is missing, damaged or was written for a different key.
+static bool loadTextureCache(const char* path, unsigned __int64 key)
+{
+    ktx2::File file; if (file.open(path)) return false;
+    char hex[17]; sprintf_s(hex, "%016I64x", key);
+    const char* stored = file.value("BPcacheKey");
+    GLint internalFormat; GLenum format, type;
+    if (!stored || strcmp(stored, hex) || !ktx2::glFormat(file.header().vkFormat, internalFormat, format, type)) return false;
+
+    // upload every level directly from the mapped file, only supercompressed levels go through the scratch buffer
+    std::vector<GLubyte> scratch;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);                                                                      GLCHK;
+    for (GLuint i = 0; i < file.header().levelCount; ++i) {
+        const GLubyte* texels; size_t size; if (file.level(i, texels, size, scratch)) return false;
+        glTexImage2D(GL_TEXTURE_2D, i, internalFormat, file.width(i), file.height(i), 0, format, type, texels); GLCHK;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);                                                                      GLCHK;
+    return true;
+}
+
+// Static function to read back all mip levels of the currently bound RGBA8 texture and write them to a KTX2 cache file
+static void storeTextureCache(const char* path, unsigned __int64 key, GLuint levels)
+{
+    ktx2::Texture tex; tex.vkFormat = ktx2::R8G8B8A8_UNORM; tex.levels.resize(levels);
+    char hex[17]; sprintf_s(hex, "%016I64x", key);
+    tex.keyValues.push_back(std::make_pair(std::string("BPcacheKey"), std::string(hex)));
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);                                                                        GLCHK;
+    for (GLuint i = 0; i < levels; ++i) {
+        GLint w, h;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_WIDTH, &w);                                       GLCHK;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_HEIGHT, &h);                                      GLCHK;
+        if (!i) { tex.width = w; tex.height = h; }
+        tex.levels[i].resize(w * h * 4);
+        glGetTexImage(GL_TEXTURE_2D, i, GL_RGBA, GL_UNSIGNED_BYTE, &tex.levels[i][0]);                          GLCHK;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);                                                                        GLCHK;
+    ktx2::save(path, tex);
+}
+
 // Static function to check for minimum OpenGL version (which is 4.3 for now0
 static void versionCheck()
 {
@@ -178,12 +241,15 @@ void init()
     // turn off vsync
     if (!wglSwapIntervalEXT(0))                                                                                 __debugbreak();
 
-    // compile and link the shaders into a program, get it's uniform locations, make it active
-    vShader  = compileShader(vertexShader, GL_VERTEX_SHADER);
-    texfShader = compileShader(texFragmentShader, GL_FRAGMENT_SHADER);
-    imgfShader = compileShader(imgFragmentShader, GL_FRAGMENT_SHADER);
-    texProgram = createProgram({ vShader, texfShader });
-    imgProgram = createProgram({ vShader, imgfShader });
+    // compile and link the shaders into programs or load them from the program binary cache, get their uniform locations
+    unsigned __int64 start, now; if (!QueryPerformanceCounter((PLARGE_INTEGER)&start))                          __debugbreak();
+    texProgram = programCache.get({ &vertexShader, &texFragmentShader }, [] {
+        texfShader = compileShader(texFragmentShader, GL_FRAGMENT_SHADER); return createProgram({ sharedVertexShader(), texfShader }); });
+    imgProgram = programCache.get({ &vertexShader, &imgFragmentShader }, [] {
+        imgfShader = compileShader(imgFragmentShader, GL_FRAGMENT_SHADER); return createProgram({ sharedVertexShader(), imgfShader }); });
+    if (!QueryPerformanceCounter((PLARGE_INTEGER)&now))                                                         __debugbreak();
+    printf("shader programs: %u loaded from cache, %u compiled, in %f milliseconds\n\n",
+        programCache.hits(), programCache.misses(), elapsedUS(now, start) / 1000.);
     texOffset = glGetUniformLocation(texProgram, "offset");                                                     GLCHK;
     texTexUnit = glGetUniformLocation(texProgram, "texUnit");                                                   GLCHK;
     imgOffset = glGetUniformLocation(imgProgram, "offset");                                                     GLCHK;
@@ -196,14 +262,12 @@ void init()
     glUseProgram(imgProgram);                                                                                   GLCHK;
     glUniform1i(imgTexUnit, 0);                                                                                 GLCHK;
 
-    // load an RGBA8 image
-    std::vector<GLubyte> img1; GLuint w1, h1;
-    if (lodepng::decode(img1, w1, h1, "sample.png"))                                                             __debugbreak();
-
-    // scale it to a size larger than the screen
-    GLuint w2, h2 = w2 = GLuint(pow(2,mipLevel));
-    std::vector<GLubyte> img2(w2 * h2 * 4);
-    if (gluScaleImage(GL_RGBA, w1, h1, GL_UNSIGNED_BYTE, &img1[0], w2, h2, GL_UNSIGNED_BYTE, &img2[0]))         __debugbreak();
+    // key the texture cache on the source image contents and everything we do to it
+    if (!QueryPerformanceCounter((PLARGE_INTEGER)&start))                                                       __debugbreak();
+    std::vector<GLubyte> png; lodepng::load_file(png, "sample.png"); if (png.empty())                           __debugbreak();
+    const GLuint params[] = { mipLevel, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE };
+    unsigned __int64 key = fnv1a(params, sizeof(params), fnv1a(&png[0], png.size()));
+    char cacheFile[64]; sprintf_s(cacheFile, "sample.%016I64x.ktx2", key);
 
     // create and configure the mip-map minification texture
     glGenTextures(1, &minTexture);                                                                              GLCHK;
@@ -212,10 +276,29 @@ void init()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);                                               GLCHK;
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);                                          GLCHK;
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);                                          GLCHK;
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w2, h2, 0, GL_RGBA, GL_UNSIGNED_BYTE, &img2[0]);                   GLCHK;
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipLevel);                                             GLCHK;
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);                                                   GLCHK;
-    glGenerateMipmap(GL_TEXTURE_2D);                                                                            GLCHK;
+
+    // warm start uploads every level straight from the cache, cold start decodes, scales and mip-maps then fills the cache
+    bool cached = loadTextureCache(cacheFile, key);
+    if (!cached) {
+        // load an RGBA8 image
+        std::vector<GLubyte> img1; GLuint w1, h1;
+        if (lodepng::decode(img1, w1, h1, png))                                                                 __debugbreak();
+
+        // scale it to a size larger than the screen
+        GLuint w2, h2 = w2 = GLuint(pow(2,mipLevel));
+        std::vector<GLubyte> img2(w2 * h2 * 4);
+        if (gluScaleImage(GL_RGBA, w1, h1, GL_UNSIGNED_BYTE, &img1[0], w2, h2, GL_UNSIGNED_BYTE, &img2[0]))     __debugbreak();
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w2, h2, 0, GL_RGBA, GL_UNSIGNED_BYTE, &img2[0]);               GLCHK;
+        glGenerateMipmap(GL_TEXTURE_2D);                                                                        GLCHK;
+        storeTextureCache(cacheFile, key, mipLevel + 1);
+    }
+    glFinish();                                                                                                 GLCHK;
+    if (!QueryPerformanceCounter((PLARGE_INTEGER)&now))                                                         __debugbreak();
+    printf("texture %s in %f milliseconds (%s)\n\n", cached ? "loaded from cache" : "decoded and processed",
+        elapsedUS(now, start) / 1000., cacheFile);
 
     // create a small texture to test magnification
     glGenTextures(1, &magTexture);                                                                              GLCHK;
@@ -253,6 +336,7 @@ void display()
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);                       GLCHK;
     }
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                                                      GLCHK;
+    recorder.frame();
     glutSwapBuffers();
 }
 
@@ -271,6 +355,10 @@ void keyboard(unsigned char key, int, int)
     // end on <esc> keypress
     if (key == 27) exit(0);
     if (key == ' ') advance = true;
+    if (key == 'c') recorder.toggle(capture::DROP);
+    if (key == 'C') recorder.toggle(capture::BLOCK);
+    if (key == 'a') recorder.toggle(capture::DROP, capture::APNG_FILE);
+    if (key == 'A') recorder.toggle(capture::BLOCK, capture::APNG_FILE);
 }
 
 // Static function to print currently selected test item's state.  Called every time the user presses <space>.
@@ -373,6 +461,8 @@ int main(int argc, char** argv)
         printf("OpenGL renderer string: %s\n", glGetString(GL_RENDERER));
         printf("OpenGL version string: %s\n\n", glGetString(GL_VERSION));
         puts("This lesson compares the read performance between using GLSL sampler2D/texture and image2D/imageLoad.");
+        puts("Press <c> to start or stop capturing frames to PNG files, <C> to capture without dropping frames.");
+        puts("Press <a> to start or stop capturing an animated PNG of the frames, <A> to capture it without dropping frames.");
         puts("Press <esc> to exit; <space bar> to switch between texture and image ...\n");
         printf("%s: ", (mode ? "image  " : "texture")); fflush(stdout);
         glutMainLoop();
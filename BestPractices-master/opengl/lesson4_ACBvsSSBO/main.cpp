@@ -14,6 +14,8 @@
 #include <GL/wglew.h>
 #include <GL/glut.h>
 #include <lodepng.h>
+#include <capture.h>
+#include <programcache.h>
 
 #include <vector>
 
@@ -23,12 +25,21 @@
 
 // This example uses attribute-less rendering
 
-// Classic "Stringification" macro
-#define _s(x) #x
-#define s(x) _s(x)
+// Counter sweep.   Every combination of counter count, counter stride and fraction of fragments that touch the counters
+// is measured for every variant.   A stride of 16 counters puts each counter in its own 64 byte cache line.
+static const GLuint sweepCounters[] = { 1, 16, 128 };
+static const GLuint sweepStride[]   = { 1, 16 };
+static const GLuint sweepPercent[]  = { 100, 25 };
 
-// Number of counters-per-pixel to test for performance
-#define nCounters 128
+// Workgroup sizes swept by the compute shader variants
+static const struct { GLuint x, y; } sweepWorkgroup[] = { { 8, 8 }, { 16, 16 } };
+
+// Number of screen tiles the per-tile variant spreads its counters over
+#define nTiles 64
+
+// Number of staging buffers in the readback ring, and how many frames apart the counters are read back
+#define nStaging 3
+#define readbackInterval 64
 
 // Vertex shader specifies vertex position in clip space
 static std::string vertexShader =
@@ -71,58 +82,213 @@ static std::string aniFragmentShader =
     "}\n"
 ;
 
-// Fragment shader gets output color from a texture
-static std::string acbFragmentShader = 
-    "#version 430 core\n"
-    "\n"
+// Common part of the counter fragment shaders.   N_COUNTERS, STRIDE, PERCENT and N_TILES are #defined per test at init
+// time.   touch() picks a fixed, evenly spread PERCENT of the pixels.
+static std::string counterCommon =
     "uniform sampler2D texUnit;\n"
     "\n"
-    "layout(binding = 0) uniform atomic_uint acb[" s(nCounters) "];\n"
-    "\n"
     "smooth in vec2 texcoord;\n"
     "\n"
     "layout(location = 0) out vec4 fragColor;\n"
     "\n"
+    "bool touch()\n"
+    "{\n"
+    "    uvec2 p = uvec2(gl_FragCoord.xy);\n"
+    "    return (p.x * 7u + p.y * 13u) % 100u < PERCENT;\n"
+    "}\n"
+    "\n"
+;
+
+// Fragment shader increments every counter of an atomic counter buffer
+static std::string acbFragmentShader =
+    "layout(binding = 0) uniform atomic_uint acb[N_COUNTERS * STRIDE];\n"
+    "\n"
     "void main()\n"
     "{\n"
-    "    for (int i=0; i<"  s(nCounters) "; ++i) atomicCounterIncrement(acb[i]);\n"
+    "    if (touch()) for (int i=0; i<N_COUNTERS; ++i) atomicCounterIncrement(acb[i * STRIDE]);\n"
     "    fragColor = texture(texUnit, texcoord);\n"
     "}\n"
 ;
 
-// Fragment shader gets output color from a texture
+// Fragment shader increments every counter of a shader storage buffer
 static std::string ssboFragmentShader =
-    "#version 430 core\n"
+    "layout(std430, binding = 0) buffer ssbo_data\n"
+    "{\n"
+    "    uint v[N_COUNTERS * STRIDE];\n"
+    "};\n"
     "\n"
-    "uniform sampler2D texUnit;\n"
+    "void main()\n"
+    "{\n"
+    "    if (touch()) for (int i=0; i<N_COUNTERS; ++i) atomicAdd(v[i * STRIDE], 1);\n"
+    "    fragColor = texture(texUnit, texcoord);\n"
+    "}\n"
+;
+
+// Subgroup reduction with GL_KHR_shader_subgroup: count the touching invocations, one of them adds the total
+static std::string khrSubgroupCount =
+    "#extension GL_KHR_shader_subgroup_ballot : require\n"
     "\n"
-    "smooth in vec2 texcoord;\n"
+    "uint subgroupCount(bool touch, out bool leader)\n"
+    "{\n"
+    "    uvec4 b = subgroupBallot(touch);\n"
+    "    leader = touch && subgroupBallotFindLSB(b) == gl_SubgroupInvocationID;\n"
+    "    return subgroupBallotBitCount(b);\n"
+    "}\n"
     "\n"
-    "layout(location = 0) out vec4 fragColor;\n"
+;
+
+// Subgroup reduction with GL_ARB_shader_ballot: count the touching invocations, one of them adds the total
+static std::string arbSubgroupCount =
+    "#extension GL_ARB_shader_ballot : require\n"
+    "#extension GL_ARB_gpu_shader_int64 : require\n"
     "\n"
+    "uint subgroupCount(bool touch, out bool leader)\n"
+    "{\n"
+    "    uvec2 b = unpackUint2x32(ballotARB(touch));\n"
+    "    uint lsb = b.x != 0u ? uint(findLSB(b.x)) : 32u + uint(findLSB(b.y));\n"
+    "    leader = touch && lsb == gl_SubGroupInvocationARB;\n"
+    "    return uint(bitCount(b.x) + bitCount(b.y));\n"
+    "}\n"
+    "\n"
+;
+
+// Fragment shader reduces within the subgroup, then issues one atomic per counter per subgroup.
+// Helper invocations are left out of the count since their stores are discarded.
+static std::string subgroupFragmentShader =
     "layout(std430, binding = 0) buffer ssbo_data\n"
     "{\n"
-    "    uint v[" s(nCounters) "];\n"
+    "    uint v[N_COUNTERS * STRIDE];\n"
     "};\n"
     "\n"
     "void main()\n"
     "{\n"
-    "    for (int i=0; i<" s(nCounters) "; ++i) atomicAdd(v[i], 1);\n"
+    "    bool leader; uint n = subgroupCount(touch() && !gl_HelperInvocation, leader);\n"
+    "    if (leader) for (int i=0; i<N_COUNTERS; ++i) atomicAdd(v[i * STRIDE], n);\n"
     "    fragColor = texture(texUnit, texcoord);\n"
     "}\n"
 ;
 
+// Fragment shader accumulates into a private copy of the counters for each 8x8 pixel screen tile
+static std::string tiledFragmentShader =
+    "layout(std430, binding = 0) buffer ssbo_data\n"
+    "{\n"
+    "    uint v[N_TILES * N_COUNTERS * STRIDE];\n"
+    "};\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uvec2 t = uvec2(gl_FragCoord.xy) / 8u;\n"
+    "    uint tile = (t.x + t.y * 8u) % N_TILES;\n"
+    "    if (touch()) for (int i=0; i<N_COUNTERS; ++i) atomicAdd(v[(tile * N_COUNTERS + i) * STRIDE], 1);\n"
+    "    fragColor = texture(texUnit, texcoord);\n"
+    "}\n"
+;
+
+// Common part of the compute shaders.   They do the work of the fragment shaders without the rasterizer: one invocation per
+// pixel of the quad, so the counter traffic and the resulting counts are the same.   WG_X and WG_Y are #defined per test at init time.
+static std::string computeCommon =
+    "layout(local_size_x = WG_X, local_size_y = WG_Y) in;\n"
+    "\n"
+    "uniform uvec2 origin, size;\n"
+    "\n"
+    "bool touch()\n"
+    "{\n"
+    "    uvec2 p = gl_GlobalInvocationID.xy + origin;\n"
+    "    return all(lessThan(gl_GlobalInvocationID.xy, size)) && (p.x * 7u + p.y * 13u) % 100u < PERCENT;\n"
+    "}\n"
+    "\n"
+;
+
+// Compute shader increments every counter of an atomic counter buffer
+static std::string acbComputeShader =
+    "layout(binding = 0) uniform atomic_uint acb[N_COUNTERS * STRIDE];\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    if (touch()) for (int i=0; i<N_COUNTERS; ++i) atomicCounterIncrement(acb[i * STRIDE]);\n"
+    "}\n"
+;
+
+// Compute shader increments every counter of a shader storage buffer
+static std::string ssboComputeShader =
+    "layout(std430, binding = 0) buffer ssbo_data\n"
+    "{\n"
+    "    uint v[N_COUNTERS * STRIDE];\n"
+    "};\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    if (touch()) for (int i=0; i<N_COUNTERS; ++i) atomicAdd(v[i * STRIDE], 1);\n"
+    "}\n"
+;
+
+// Compute shader pre-aggregates the counters in shared memory, then issues one atomic per counter per workgroup
+static std::string sharedComputeShader =
+    "layout(std430, binding = 0) buffer ssbo_data\n"
+    "{\n"
+    "    uint v[N_COUNTERS * STRIDE];\n"
+    "};\n"
+    "\n"
+    "shared uint partial[N_COUNTERS];\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    for (uint i=gl_LocalInvocationIndex; i<uint(N_COUNTERS); i+=uint(WG_X * WG_Y)) partial[i] = 0u;\n"
+    "    memoryBarrierShared(); barrier();\n"
+    "    if (touch()) for (int i=0; i<N_COUNTERS; ++i) atomicAdd(partial[i], 1u);\n"
+    "    memoryBarrierShared(); barrier();\n"
+    "    for (uint i=gl_LocalInvocationIndex; i<uint(N_COUNTERS); i+=uint(WG_X * WG_Y))\n"
+    "        if (partial[i] != 0u) atomicAdd(v[i * STRIDE], partial[i]);\n"
+    "}\n"
+;
+
+// One measured configuration: a variant plus its sweep parameters, and the program built for it
+struct Test {
+    enum Variant { ACB, SSBO, SUBGROUP, TILED, CS_ACB, CS_SSBO, CS_SHARED, nVARIANTS } variant;
+    GLuint counters, stride, percent;
+    GLuint wgX, wgY;
+    GLuint bytes;
+    GLuint program;
+    GLint  offset, texUnit, origin, size;
+
+    bool compute() const { return variant >= CS_ACB; }
+    bool atomicCounters() const { return variant == ACB || variant == CS_ACB; }
+};
+static const char* variantStr[] = {
+    "Atomic Counter Buffer",
+    "Shader Storage Buffer Object",
+    "Shader Storage Buffer Object, subgroup reduction",
+    "Shader Storage Buffer Object, per-tile accumulation",
+    "Compute, Atomic Counter Buffer",
+    "Compute, Shader Storage Buffer Object",
+    "Compute, Shader Storage Buffer Object, shared memory pre-aggregation",
+};
+
 // Static variables, program state
 static GLenum err;
 static GLuint vShader;
-static GLuint anifShader, acbfShader, ssbofShader;
-static GLuint aniProgram, acbProgram, ssboProgram;
-static GLint  aniOffset,  acbOffset,  ssboOffset;
-static GLint  aniTexUnit, acbTexUnit, ssboTexUnit;
+static GLuint anifShader;
+static GLuint aniProgram;
+static GLint  aniOffset;
+static GLint  aniTexUnit;
+static std::vector<Test> tests;
 static GLuint texture, acb, ssbo;
 static GLfloat animation;
 static unsigned selector;
 static bool swap, animating;
+static capture::Recorder recorder("lesson4");
+static ProgramCache programCache("lesson4");
+
+// Pixels covered by the quad, pixels whose counters get touched each frame
+static GLuint quadX, quadY, quadW, quadH, touches;
+
+// Readback state: staging ring, frames drawn since the counters were zeroed, validation results
+static GLuint staging[nStaging];
+static GLsync stagingFence[nStaging];
+static GLuint stagingFrames[nStaging];
+static unsigned stagingHead;
+static GLuint counterFrames, verified, mismatched;
+static bool resetCounters = true, minimalBarrier;
 
 // Debug build performs OpenGL error checking, Release does not
 #ifdef _DEBUG
@@ -153,6 +319,7 @@ static GLuint createProgram(std::initializer_list<GLuint> shaders)
 {
     GLuint program = glCreateProgram();                                                         GLCHK;
     for (auto shader : shaders) glAttachShader(program, shader);                                GLCHK;
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);                  GLCHK;
     glLinkProgram(program);                                                                     GLCHK;
     GLint status; glGetProgramiv(program, GL_LINK_STATUS, &status); if (GL_FALSE == status) {   GLCHK;
         GLint sz; glGetProgramiv(program, GL_INFO_LOG_LENGTH, &sz);                             GLCHK;
@@ -166,6 +333,56 @@ static GLuint createProgram(std::initializer_list<GLuint> shaders)
     return program;
 }
 
+// Static function to compile the vertex shader the programs share, the first time a program is built from source
+static GLuint sharedVertexShader()
+{
+    if (!vShader) vShader = compileShader(vertexShader, GL_VERTEX_SHADER);
+    return vShader;
+}
+
+// Static function to check whether the OpenGL implementation exposes an extension
+static bool hasExtension(const char* name)
+{
+    GLint n; glGetIntegerv(GL_NUM_EXTENSIONS, &n);                                              GLCHK;
+    for (GLint i = 0; i < n; ++i)
+        if (!strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name)) return true;
+    return false;
+}
+
+// Static function to build and link the program for one test, with the sweep parameters #defined in the shader source
+static void buildTest(Test& t, const std::string& subgroupCount)
+{
+    static const std::string* bodies[] = {
+        &acbFragmentShader, &ssboFragmentShader, &subgroupFragmentShader, &tiledFragmentShader,
+        &acbComputeShader,  &ssboComputeShader,  &sharedComputeShader
+    };
+    char defines[256]; sprintf_s(defines,
+        "#version %s core\n"
+        "#define N_COUNTERS %u\n"
+        "#define STRIDE %uu\n"
+        "#define PERCENT %uu\n"
+        "#define N_TILES %uu\n"
+        "#define WG_X %u\n"
+        "#define WG_Y %u\n",
+        t.variant == Test::SUBGROUP ? "450" : "430", t.counters, t.stride, t.percent, nTiles, t.wgX, t.wgY);
+    std::string src = defines;
+    if (t.variant == Test::SUBGROUP) src += subgroupCount;
+    src += (t.compute() ? computeCommon : counterCommon) + *bodies[t.variant];
+    GLuint shader = 0;
+    auto build = [&]() -> GLuint {
+        shader = compileShader(src, t.compute() ? GL_COMPUTE_SHADER : GL_FRAGMENT_SHADER);
+        return t.compute() ? createProgram({ shader }) : createProgram({ sharedVertexShader(), shader });
+    };
+    t.program = t.compute() ? programCache.get({ &src }, build) : programCache.get({ &vertexShader, &src }, build);
+    t.offset  = glGetUniformLocation(t.program, "offset");                                      GLCHK;
+    t.texUnit = glGetUniformLocation(t.program, "texUnit");                                     GLCHK;
+    t.origin  = glGetUniformLocation(t.program, "origin");                                      GLCHK;
+    t.size    = glGetUniformLocation(t.program, "size");                                        GLCHK;
+    glUseProgram(t.program);                                                                    GLCHK;
+    if (!t.compute()) glUniform1i(t.texUnit, 0);                                                GLCHK;
+    if (shader) glDeleteShader(shader);                                                         GLCHK;
+}
+
 // Static function to check for minimum OpenGL version (which is 4.3 for now0
 static void versionCheck()
 {
@@ -182,6 +399,9 @@ static void versionCheck()
     }
 }
 
+// Static function.  Calculates elapsed time in microseconds.
+static unsigned __int64 elapsedUS(unsigned __int64 now, unsigned __int64 start);
+
 // GLUT initialization function.   Initialize program state as defined in static variables.
 void init()
 {
@@ -190,43 +410,67 @@ void init()
     // turn off vsync
     if (!wglSwapIntervalEXT(0))                                                                 __debugbreak();
 
-    // compile and link the shaders into a program, make it active
-    vShader     = compileShader(vertexShader,   GL_VERTEX_SHADER);
-    anifShader  = compileShader(aniFragmentShader, GL_FRAGMENT_SHADER);
-    acbfShader  = compileShader(acbFragmentShader, GL_FRAGMENT_SHADER);
-    ssbofShader = compileShader(ssboFragmentShader, GL_FRAGMENT_SHADER);
-    aniProgram  = createProgram({ vShader, anifShader });
-    acbProgram  = createProgram({ vShader, acbfShader });
-    ssboProgram = createProgram({ vShader, ssbofShader });
+    // compile and link the shaders into a program or load it from the program binary cache, make it active
+    unsigned __int64 start, now; if (!QueryPerformanceCounter((PLARGE_INTEGER)&start))          __debugbreak();
+    aniProgram  = programCache.get({ &vertexShader, &aniFragmentShader }, [] {
+        anifShader = compileShader(aniFragmentShader, GL_FRAGMENT_SHADER); return createProgram({ sharedVertexShader(), anifShader }); });
     aniOffset   = glGetUniformLocation(aniProgram, "offset");                                   GLCHK;
     aniTexUnit  = glGetUniformLocation(aniProgram, "texUnit");                                  GLCHK;
-    acbOffset   = glGetUniformLocation(acbProgram, "offset");                                   GLCHK;
-    acbTexUnit  = glGetUniformLocation(acbProgram, "texUnit");                                  GLCHK;
-    ssboOffset  = glGetUniformLocation(ssboProgram, "offset");                                  GLCHK;
-    ssboTexUnit = glGetUniformLocation(ssboProgram, "texUnit");                                 GLCHK;
+
+    // the subgroup variant needs OpenGL 4.5 for gl_HelperInvocation and either subgroup extension,
+    // the ACB variants must fit the per-stage atomic counter limit
+    GLint major, minor; glGetIntegerv(GL_MAJOR_VERSION, &major); glGetIntegerv(GL_MINOR_VERSION, &minor);   GLCHK;
+    const std::string* subgroupCount = major < 4 || (major == 4 && minor < 5) ? NULL
+        : hasExtension("GL_KHR_shader_subgroup") ? &khrSubgroupCount
+        : (GLEW_ARB_shader_ballot && GLEW_ARB_gpu_shader_int64) ? &arbSubgroupCount : NULL;
+    if (!subgroupCount) puts("OpenGL 4.5 with GL_KHR_shader_subgroup or GL_ARB_shader_ballot is not supported, skipping the subgroup reduction tests.");
+    GLint maxFragmentCounters; glGetIntegerv(GL_MAX_FRAGMENT_ATOMIC_COUNTERS, &maxFragmentCounters);  GLCHK;
+    GLint maxComputeCounters; glGetIntegerv(GL_MAX_COMPUTE_ATOMIC_COUNTERS, &maxComputeCounters);     GLCHK;
+
+    // build the sweep, sizing the buffers for the largest test that uses them
+    GLuint acbSize = 4, ssboSize = 4;
+    for (int v = 0; v < Test::nVARIANTS; ++v)
+    for (int c = 0; c < _countof(sweepCounters); ++c)
+    for (int s = 0; s < _countof(sweepStride); ++s)
+    for (int p = 0; p < _countof(sweepPercent); ++p)
+    for (int g = 0; g < _countof(sweepWorkgroup); ++g) {
+        Test t = { Test::Variant(v), sweepCounters[c], sweepStride[s], sweepPercent[p], sweepWorkgroup[g].x, sweepWorkgroup[g].y };
+        GLuint size = t.bytes = t.counters * t.stride * (t.variant == Test::TILED ? nTiles : 1) * 4;
+        GLint maxCounters = t.compute() ? maxComputeCounters : maxFragmentCounters;
+        if (!t.compute() && g) continue;
+        if (t.atomicCounters() && GLint(t.counters * t.stride) > maxCounters) continue;
+        if (t.variant == Test::SUBGROUP && !subgroupCount) continue;
+        buildTest(t, subgroupCount ? *subgroupCount : std::string());
+        tests.push_back(t);
+        if (t.atomicCounters()) acbSize = max(acbSize, size); else ssboSize = max(ssboSize, size);
+    }
+    if (!QueryPerformanceCounter((PLARGE_INTEGER)&now))                                         __debugbreak();
+    printf("shader programs: %u loaded from cache, %u compiled, in %f milliseconds\n\n",
+        programCache.hits(), programCache.misses(), elapsedUS(now, start) / 1000.);
 
     // create and configure the Atomic Counter Buffer
     glGenBuffers(1, &acb);                                                                      GLCHK;
     glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, acb);                                         GLCHK;
-    glBufferData(GL_ATOMIC_COUNTER_BUFFER, nCounters * 4, NULL, GL_STATIC_COPY);                GLCHK;
+    glBufferData(GL_ATOMIC_COUNTER_BUFFER, acbSize, NULL, GL_DYNAMIC_COPY);                     GLCHK;
     glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, acb);                                         GLCHK;
 
     // create and configure the Shader Storage Buffer Object
     glGenBuffers(1, &ssbo);                                                                     GLCHK;
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo);                                        GLCHK;
-    glBufferData(GL_SHADER_STORAGE_BUFFER, nCounters * 4, NULL, GL_STATIC_COPY);                GLCHK;
+    glBufferData(GL_SHADER_STORAGE_BUFFER, ssboSize, NULL, GL_DYNAMIC_COPY);                    GLCHK;
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo);                                        GLCHK;
-    GLuint idx = glGetProgramResourceIndex(ssboProgram, GL_SHADER_STORAGE_BLOCK, "ssbo_data");  GLCHK;
-    glShaderStorageBlockBinding(ssboProgram, idx, 0);                                           GLCHK;
+
+    // create the staging buffers the counters are copied into for readback
+    glGenBuffers(nStaging, staging);                                                            GLCHK;
+    for (int i = 0; i < nStaging; ++i) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, staging[i]);                                         GLCHK;
+        glBufferData(GL_COPY_WRITE_BUFFER, max(acbSize, ssboSize), NULL, GL_STREAM_READ);       GLCHK;
+    }
 
     // configure texture unit
     glActiveTexture(GL_TEXTURE0);                                                               GLCHK;
     glUseProgram(aniProgram);                                                                   GLCHK;
     glUniform1i(aniTexUnit, 0);                                                                 GLCHK;
-    glUseProgram(acbProgram);                                                                   GLCHK;
-    glUniform1i(acbTexUnit, 0);                                                                 GLCHK;
-    glUseProgram(ssboProgram);                                                                  GLCHK;
-    glUniform1i(ssboTexUnit, 0);                                                                GLCHK;
 
     // create and configure the textures
     glGenTextures(1, &texture);                                                                 GLCHK;
@@ -244,26 +488,83 @@ void init()
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, &img[0]);      GLCHK;
 }
 
+// Static function to zero the current test's counters, drop pending readbacks and count the pixels that touch the counters
+static void reset(const Test& t)
+{
+    GLenum target = t.atomicCounters() ? GL_ATOMIC_COUNTER_BUFFER : GL_SHADER_STORAGE_BUFFER;
+    glClearBufferSubData(target, GL_R32UI, 0, t.bytes, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);  GLCHK;
+    for (int i = 0; i < nStaging; ++i) if (stagingFence[i]) {
+        glDeleteSync(stagingFence[i]);                                                          GLCHK;
+        stagingFence[i] = 0;
+    }
+    touches = counterFrames = 0;
+    for (GLuint y = quadY; y < quadY + quadH; ++y)
+        for (GLuint x = quadX; x < quadX + quadW; ++x)
+            touches += (x * 7 + y * 13) % 100 < t.percent;
+}
+
+// Static function to validate the readbacks that have landed and start a new one every readbackInterval frames.
+// Every counter, summed over the tiles for the per-tile variant, must equal the touching pixels times the frames drawn.
+static void readback(const Test& t)
+{
+    for (int i = 0; i < nStaging; ++i) if (stagingFence[i]) {
+        if (GL_TIMEOUT_EXPIRED == glClientWaitSync(stagingFence[i], 0, 0)) continue;
+        glDeleteSync(stagingFence[i]);                                                          GLCHK;
+        stagingFence[i] = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, staging[i]);                                          GLCHK;
+        const GLuint* v = (const GLuint*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, t.bytes, GL_MAP_READ_BIT);   GLCHK;
+        GLuint tiles = t.variant == Test::TILED ? nTiles : 1, expected = stagingFrames[i] * touches;
+        bool ok = true;
+        for (GLuint c = 0; c < t.counters; ++c) {
+            GLuint sum = 0;
+            for (GLuint tile = 0; tile < tiles; ++tile) sum += v[(tile * t.counters + c) * t.stride];
+            ok &= sum == expected;
+        }
+        glUnmapBuffer(GL_COPY_READ_BUFFER);                                                     GLCHK;
+        ok ? ++verified : ++mismatched;
+    }
+    if (counterFrames % readbackInterval || stagingFence[stagingHead]) return;
+    glBindBuffer(GL_COPY_READ_BUFFER, t.atomicCounters() ? acb : ssbo);                         GLCHK;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, staging[stagingHead]);                                   GLCHK;
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, t.bytes);              GLCHK;
+    stagingFence[stagingHead] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);                  GLCHK;
+    stagingFrames[stagingHead] = counterFrames;
+    stagingHead = (stagingHead + 1) % nStaging;
+}
+
 // GLUT display function.   Draw one frame's worth of imagery.
 void display()
 {
     // attributeless rendering
     glClear(GL_COLOR_BUFFER_BIT);                                                               GLCHK;
     glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
-    if (animating) {
+    const Test& t = tests[selector];
+    if (!animating && resetCounters) {
+        reset(t); resetCounters = false;
+    }
+    if (animating || t.compute()) {
         glUseProgram(aniProgram);                                                               GLCHK;
-        glUniform1f(aniOffset, animation);                                                      GLCHK;
-    } else if (!selector) {
-        glUseProgram(acbProgram);                                                               GLCHK;
-        glUniform1f(acbOffset, 0.f);                                                            GLCHK;
+        glUniform1f(aniOffset, animating ? animation : 0.f);                                    GLCHK;
     } else {
-        glUseProgram(ssboProgram);                                                              GLCHK;
-        glUniform1f(ssboOffset, 0.f);                                                           GLCHK;
+        glUseProgram(t.program);                                                                GLCHK;
+        glUniform1f(t.offset, 0.f);                                                             GLCHK;
     }
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                                      GLCHK;
-    if (!animating && selector) {
-        glMemoryBarrier(GL_ALL_BARRIER_BITS);                                                   GLCHK;
+    if (!animating && t.compute()) {
+        // one invocation per pixel of the quad
+        glUseProgram(t.program);                                                                GLCHK;
+        glUniform2ui(t.origin, quadX, quadY);                                                   GLCHK;
+        glUniform2ui(t.size, quadW, quadH);                                                     GLCHK;
+        glDispatchCompute((quadW + t.wgX - 1) / t.wgX, (quadH + t.wgY - 1) / t.wgY, 1);         GLCHK;
     }
+    if (!animating) {
+        // the minimal barrier only covers the counters and the readback copy
+        GLbitfield counterBit = t.atomicCounters() ? GL_ATOMIC_COUNTER_BARRIER_BIT : GL_SHADER_STORAGE_BARRIER_BIT;
+        glMemoryBarrier(minimalBarrier ? counterBit | GL_BUFFER_UPDATE_BARRIER_BIT : GL_ALL_BARRIER_BITS); GLCHK;
+        ++counterFrames;
+        readback(t);
+    }
+    recorder.frame();
     glutSwapBuffers();
 }
 
@@ -272,6 +573,11 @@ void reshape(int w, int h)
 {
     // viewport follows window size
     glViewport(0, 0, (GLsizei)w, (GLsizei)h);
+
+    // the quad spans the middle half of the window, count the pixels whose centers it covers
+    quadX = (w + 1) / 4; quadW = (3 * w + 1) / 4 - quadX;
+    quadY = (h + 1) / 4; quadH = (3 * h + 1) / 4 - quadY;
+    resetCounters = true;
 }
 
 // GLUT keyboard function.  Exit on <esc>, advance to next test item on <space>
@@ -280,12 +586,20 @@ void keyboard(unsigned char key, int, int)
     // end on <esc> keypress
     if (key == 27) exit(0);
     if (key == ' ') swap = true;
+    if (key == 'c') recorder.toggle(capture::DROP);
+    if (key == 'C') recorder.toggle(capture::BLOCK);
+    if (key == 'a') recorder.toggle(capture::DROP, capture::APNG_FILE);
+    if (key == 'A') recorder.toggle(capture::BLOCK, capture::APNG_FILE);
 }
 
 // Static function to print currently selected test item's state.  Called every time the user presses <space>.
 void print()
 {
-    printf("\n*** %s\n", (selector ? "Shader Storage Buffer Object" : "Atomic Counter Buffer"));
+    const Test& t = tests[selector];
+    printf("\n*** %s, %u counters, counter stride %u bytes, %u%% of fragments touch the counters",
+        variantStr[t.variant], t.counters, t.stride * 4, t.percent);
+    if (t.compute()) printf(", workgroup %ux%u", t.wgX, t.wgY);
+    puts("");
 }
 
 // Static function.  Calculates elapsed time in microseconds.
@@ -315,7 +629,8 @@ void idle()
             animation = (sec < 0.5f ? sec : 1.f - sec) / 0.5f;
         } else {
             animating = false;
-            selector ^= 1; skip = 0;
+            selector = (selector + 1) % tests.size(); skip = 0;
+            resetCounters = true;
             cnt = start = 0;
             print();
         }
@@ -325,6 +640,13 @@ void idle()
     else if (sec >= 2)
     {
         printf("frames rendered = %I64u, uS = %I64u, fps = %f,  milliseconds-per-frame = %f\n", cnt, us, cnt * 1000000. / us, us / (cnt * 1000.));
+
+        // each touching fragment adds one to every counter
+        const Test& t = tests[selector];
+        printf("counter increments per second = %f million, barrier = %s\n", double(touches) * t.counters * cnt / us,
+            minimalBarrier ? (t.atomicCounters() ? "GL_ATOMIC_COUNTER_BARRIER_BIT" : "GL_SHADER_STORAGE_BARRIER_BIT") : "GL_ALL_BARRIER_BITS");
+        printf("readbacks verified = %u, mismatched = %u\n", verified, mismatched);
+        verified = mismatched = 0; minimalBarrier = !minimalBarrier;
         if (swap) {
             animating = true; animationStart = now; swap = false;
         } else {
@@ -364,7 +686,9 @@ int main(int argc, char** argv)
         printf("OpenGL renderer string: %s\n", glGetString(GL_RENDERER));
         printf("OpenGL version string: %s\n\n", glGetString(GL_VERSION));
         puts("This lesson compares the performance between using Atomic Counter Buffers vs Shader Storage Buffer Objects.");
-        puts("Press <esc> to exit; <space bar> to switch between texture sizes ...\n");
+        puts("Press <c> to start or stop capturing frames to PNG files, <C> to capture without dropping frames.");
+        puts("Press <a> to start or stop capturing an animated PNG of the frames, <A> to capture it without dropping frames.");
+        puts("Press <esc> to exit; <space bar> to advance to the next counter configuration ...\n");
         print();
         glutMainLoop();
     }
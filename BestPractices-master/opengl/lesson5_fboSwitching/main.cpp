@@ -13,6 +13,7 @@
 #include <GL/wglew.h>
 #include <GL/glut.h>
 #include <lodepng.h>
+#include <capture.h>
 
 #include <vector>
 
@@ -47,7 +48,7 @@ static std::string vertexShader =
     "}\n"
 ;
 
-// Fragment shader gets output color from a texture
+// Fragment shader gets output color from a texture and writes it to every color attachment
 static std::string fragmentShader =
     "#version 430 core\n"
     "\n"
@@ -55,11 +56,65 @@ static std::string fragmentShader =
     "\n"
     "smooth in vec2 texcoord;\n"
     "\n"
+    "layout(location = 0) out vec4 fragColor[8];\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 c = texture(texUnit, texcoord);\n"
+    "    for (int i=0; i<8; ++i) fragColor[i] = c;\n"
+    "}\n"
+;
+
+// Vertex shader for the render graph passes, covers the whole target
+static std::string passVertexShader =
+    "#version 430 core\n"
+    "\n"
+    "const vec2 Position[4] = vec2[]\n"
+    "(\n"
+    "    vec2(-1,  1),\n"
+    "    vec2(-1, -1),\n"
+    "    vec2( 1,  1),\n"
+    "    vec2( 1, -1) \n"
+    ");"
+    "\n"
+    "uniform bool flip;\n"
+    "\n"
+    "smooth out vec2 texcoord;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 pos = Position[ gl_VertexID ];\n"
+    "    gl_Position = vec4(pos, 0.0, 1.0);\n"
+    "    texcoord = pos * vec2(0.5, flip ? -0.5 : 0.5) + 0.5;\n"
+    "}\n"
+;
+
+// Fragment shader for the render graph passes blends its two inputs
+static std::string passFragmentShader =
+    "#version 430 core\n"
+    "\n"
+    "layout(binding = 0) uniform sampler2D src0;\n"
+    "layout(binding = 1) uniform sampler2D src1;\n"
+    "\n"
+    "smooth in vec2 texcoord;\n"
+    "\n"
     "layout(location = 0) out vec4 fragColor;\n"
     "\n"
     "void main()\n"
     "{\n"
-    "    fragColor = texture(texUnit, texcoord);\n"
+    "    fragColor = mix(texture(src0, texcoord), texture(src1, texcoord), 0.5);\n"
+    "}\n"
+;
+
+// Fragment shader that stands in for glClear with a full-screen draw
+static std::string clearFragmentShader =
+    "#version 430 core\n"
+    "\n"
+    "layout(location = 0) out vec4 fragColor[8];\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    for (int i=0; i<8; ++i) fragColor[i] = vec4(0.0);\n"
     "}\n"
 ;
 
@@ -70,23 +125,138 @@ static GLuint fShader;
 static GLuint program;
 static GLuint texture;
 static GLuint fbo[3];
-static GLuint rb[2];
 static GLint offset, texUnit;
+static GLuint passProgram, clearProgram;
+static GLint passFlip;
 static GLfloat animation;
 static unsigned selector, w, h;
 static bool swap, animating;
-
-// Array of structures, one item for each option we're testing
-#define I(x) { options:: ## x, #x }
+static capture::Recorder recorder("lesson5");
+
+// Render target pool: two sets of surfaces the test switches between, each with up to 8 color attachments and a
+// depth/stencil surface in the last slot
+#define nSets 2
+#define maxColors 8
+static GLuint surface[nSets][maxColors + 1];
+static GLenum surfaceTarget;     // GL_RENDERBUFFER or GL_TEXTURE_2D, what the surfaces were created as
+static bool cleared[nSets];
+
+// Array of structures, one item for each option we're testing.   Each item swaps either entire FBOs or the surfaces of a
+// single FBO, for a pool of renderbuffers or textures with the given attachment count, formats and resolution.
+// Starting from a baseline of one RGBA8 renderbuffer at 640x480 switched once per frame, each group varies one parameter.
+// The DEDICATED and ALIASED items run the render graph below at the given resolution instead.
+// The last field says how targets are cleared and their dead contents discarded:
+//   CLEAR       glClear before every draw, nothing is invalidated
+//   INVALIDATE  as CLEAR, and glInvalidateFramebuffer as soon as attachment contents are dead, e.g. after the blit
+//   ELIDE       targets are cleared once, later frames skip the redundant clear and glInvalidateSubFramebuffer the
+//               region the draw overwrites.   Render graph passes overwrite their whole target and are never cleared
+//   DRAW        a full-screen draw instead of glClear
+#define I(x) options:: ## x, #x
+#define RB GL_RENDERBUFFER
+#define TX GL_TEXTURE_2D
+#define DS GL_DEPTH24_STENCIL8
 static struct options {
-    enum  { FBO, SURFACE, nOPTS } option;
+    enum  { FBO, SURFACE, DEDICATED, ALIASED, nOPTS } option;
     const char* optionStr;
+    GLenum target;
+    GLuint colors;
+    GLenum format, depthStencil;
+    GLsizei width, height;
+    GLuint switches;
+    enum  { CLEAR, INVALIDATE, ELIDE, DRAW } clear;
 } options[]
 {
-    I(FBO),
-    I(SURFACE),
+    { I(FBO),     RB, 1, GL_RGBA8,          GL_NONE,  640,  480,  1 },
+    { I(SURFACE), RB, 1, GL_RGBA8,          GL_NONE,  640,  480,  1 },
+
+    { I(FBO),     RB, 2, GL_RGBA8,          GL_NONE,  640,  480,  1 },
+    { I(SURFACE), RB, 2, GL_RGBA8,          GL_NONE,  640,  480,  1 },
+    { I(FBO),     RB, 4, GL_RGBA8,          GL_NONE,  640,  480,  1 },
+    { I(SURFACE), RB, 4, GL_RGBA8,          GL_NONE,  640,  480,  1 },
+    { I(FBO),     RB, 8, GL_RGBA8,          GL_NONE,  640,  480,  1 },
+    { I(SURFACE), RB, 8, GL_RGBA8,          GL_NONE,  640,  480,  1 },
+
+    { I(FBO),     RB, 1, GL_RGBA8,          DS,       640,  480,  1 },
+    { I(SURFACE), RB, 1, GL_RGBA8,          DS,       640,  480,  1 },
+    { I(FBO),     RB, 4, GL_RGBA8,          DS,       640,  480,  1 },
+    { I(SURFACE), RB, 4, GL_RGBA8,          DS,       640,  480,  1 },
+
+    { I(FBO),     RB, 1, GL_RGB10_A2,       GL_NONE,  640,  480,  1 },
+    { I(SURFACE), RB, 1, GL_RGB10_A2,       GL_NONE,  640,  480,  1 },
+    { I(FBO),     RB, 1, GL_R11F_G11F_B10F, GL_NONE,  640,  480,  1 },
+    { I(SURFACE), RB, 1, GL_R11F_G11F_B10F, GL_NONE,  640,  480,  1 },
+    { I(FBO),     RB, 1, GL_RGBA16F,        GL_NONE,  640,  480,  1 },
+    { I(SURFACE), RB, 1, GL_RGBA16F,        GL_NONE,  640,  480,  1 },
+    { I(FBO),     RB, 1, GL_RGBA32F,        GL_NONE,  640,  480,  1 },
+    { I(SURFACE), RB, 1, GL_RGBA32F,        GL_NONE,  640,  480,  1 },
+
+    { I(FBO),     RB, 1, GL_RGBA8,          GL_NONE, 1280,  720,  1 },
+    { I(SURFACE), RB, 1, GL_RGBA8,          GL_NONE, 1280,  720,  1 },
+    { I(FBO),     RB, 1, GL_RGBA8,          GL_NONE, 1920, 1080,  1 },
+    { I(SURFACE), RB, 1, GL_RGBA8,          GL_NONE, 1920, 1080,  1 },
+    { I(FBO),     RB, 1, GL_RGBA8,          GL_NONE, 3840, 2160,  1 },
+    { I(SURFACE), RB, 1, GL_RGBA8,          GL_NONE, 3840, 2160,  1 },
+
+    { I(FBO),     RB, 1, GL_RGBA8,          GL_NONE,  640,  480,  4 },
+    { I(SURFACE), RB, 1, GL_RGBA8,          GL_NONE,  640,  480,  4 },
+    { I(FBO),     RB, 1, GL_RGBA8,          GL_NONE,  640,  480, 16 },
+    { I(SURFACE), RB, 1, GL_RGBA8,          GL_NONE,  640,  480, 16 },
+    { I(FBO),     RB, 4, GL_RGBA8,          DS,       640,  480, 16 },
+    { I(SURFACE), RB, 4, GL_RGBA8,          DS,       640,  480, 16 },
+
+    { I(FBO),     TX, 1, GL_RGBA8,          GL_NONE,  640,  480,  1 },
+    { I(SURFACE), TX, 1, GL_RGBA8,          GL_NONE,  640,  480,  1 },
+    { I(FBO),     TX, 4, GL_RGBA8,          DS,       640,  480,  1 },
+    { I(SURFACE), TX, 4, GL_RGBA8,          DS,       640,  480,  1 },
+    { I(FBO),     TX, 4, GL_RGBA8,          DS,       640,  480, 16 },
+    { I(SURFACE), TX, 4, GL_RGBA8,          DS,       640,  480, 16 },
+
+    { I(FBO),     RB, 4, GL_RGBA8,          DS,      1920, 1080,  4, options::CLEAR },
+    { I(FBO),     RB, 4, GL_RGBA8,          DS,      1920, 1080,  4, options::INVALIDATE },
+    { I(FBO),     RB, 4, GL_RGBA8,          DS,      1920, 1080,  4, options::ELIDE },
+    { I(FBO),     RB, 4, GL_RGBA8,          DS,      1920, 1080,  4, options::DRAW },
+
+    { I(DEDICATED), TX, 1, GL_NONE,         GL_NONE, 1920, 1080,  1, options::ELIDE },
+    { I(ALIASED),   TX, 1, GL_NONE,         GL_NONE, 1920, 1080,  1, options::ELIDE },
+    { I(DEDICATED), TX, 1, GL_NONE,         GL_NONE, 3840, 2160,  1, options::ELIDE },
+    { I(ALIASED),   TX, 1, GL_NONE,         GL_NONE, 3840, 2160,  1, options::ELIDE },
+
+    { I(DEDICATED), TX, 1, GL_NONE,         GL_NONE, 1920, 1080,  1, options::CLEAR },
+    { I(DEDICATED), TX, 1, GL_NONE,         GL_NONE, 1920, 1080,  1, options::INVALIDATE },
+    { I(ALIASED),   TX, 1, GL_NONE,         GL_NONE, 1920, 1080,  1, options::CLEAR },
+    { I(ALIASED),   TX, 1, GL_NONE,         GL_NONE, 1920, 1080,  1, options::INVALIDATE },
+};
+#undef RB
+#undef TX
+#undef DS
+static const char* clearStr[] = { "CLEAR", "INVALIDATE", "ELIDE", "DRAW" };
+
+// Synthetic post-processing render graph.   Each pass renders one target at a fraction of the resolution from up to two
+// inputs, an input of -1 is the sample image.   A target lives from the pass that writes it to the last pass that reads it.
+#define nPasses 8
+static const struct pass {
+    const char* name;
+    GLenum format;
+    GLuint scale;
+    int input[2];
+} passes[nPasses]
+{
+    { "scene",    GL_RGBA16F,  1, { -1, -1 } },
+    { "bright",   GL_RGBA16F,  2, {  0,  0 } },
+    { "blur h",   GL_RGBA16F,  2, {  1,  1 } },
+    { "blur v",   GL_RGBA16F,  2, {  2,  2 } },
+    { "tonemap",  GL_RGBA8,    1, {  0,  3 } },
+    { "fxaa",     GL_RGBA8,    1, {  4,  4 } },
+    { "sharpen",  GL_RGB10_A2, 1, {  5,  5 } },
+    { "final",    GL_RGBA8,    1, {  6,  6 } },
 };
 
+// Render graph state: the texture (or texture view) and fbo each pass renders to, the physical textures backing them
+static GLuint passTarget[nPasses], passFbo[nPasses];
+static int passLastUse[nPasses];
+static std::vector<GLuint> physical;
+static GLuint graphBytes;
+
 // Debug build performs OpenGL error checking, Release does not
 #ifdef _DEBUG
 #define GLCHK { if (GL_NO_ERROR != (err=glGetError())) __debugbreak(); }
@@ -145,6 +315,212 @@ static void versionCheck()
     }
 }
 
+// Static function to name the formats used by the options
+static const char* formatStr(GLenum format)
+{
+    switch (format) {
+    case GL_RGBA8:            return "GL_RGBA8";
+    case GL_RGB10_A2:         return "GL_RGB10_A2";
+    case GL_R11F_G11F_B10F:   return "GL_R11F_G11F_B10F";
+    case GL_RGBA16F:          return "GL_RGBA16F";
+    case GL_RGBA32F:          return "GL_RGBA32F";
+    case GL_DEPTH24_STENCIL8: return "GL_DEPTH24_STENCIL8";
+    default:                  return "unknown";
+    }
+}
+
+// Static function to return the bytes per pixel of the formats used by the options
+static GLuint formatSize(GLenum format)
+{
+    switch (format) {
+    case GL_RGBA16F: return 8;
+    case GL_RGBA32F: return 16;
+    default:         return 4;
+    }
+}
+
+// Static function to list the attachment points of the selected option, color attachments followed by depth/stencil
+static GLsizei attachments(const struct options& o, GLenum* attachment)
+{
+    GLsizei n = 0;
+    for (GLuint i = 0; i < o.colors; ++i) attachment[n++] = GL_COLOR_ATTACHMENT0 + i;
+    if (o.depthStencil) attachment[n++] = GL_DEPTH_STENCIL_ATTACHMENT;
+    return n;
+}
+
+// Static function to attach one set of surfaces from the pool to the bound framebuffer
+static void attach(const struct options& o, GLuint set)
+{
+    for (GLuint i = 0; i <= maxColors; ++i) {
+        if ((i < maxColors && i >= o.colors) || (i == maxColors && !o.depthStencil)) continue;
+        GLenum attachment = i < maxColors ? GL_COLOR_ATTACHMENT0 + i : GL_DEPTH_STENCIL_ATTACHMENT;
+        if (GL_RENDERBUFFER == o.target) {
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, surface[set][i]); GLCHK;
+        } else {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, surface[set][i], 0); GLCHK;
+        }
+    }
+}
+
+// Static function to create the render graph targets.   DEDICATED gives every pass its own texture.   ALIASED is a
+// transient allocator: passes whose targets have the same size and texel size and whose lifetimes don't overlap share a
+// physical texture, each pass renders to a texture view of it with its own format.
+static void createGraph(const struct options& o)
+{
+    for (int i = 0; i < nPasses; ++i) {
+        passLastUse[i] = i == nPasses - 1 ? nPasses : i;
+        for (int j = i + 1; j < nPasses; ++j)
+            if (passes[j].input[0] == i || passes[j].input[1] == i) passLastUse[i] = j;
+    }
+    struct slot { GLsizei width, height; GLuint size; int freeAfter; };
+    std::vector<slot> slots;
+    graphBytes = 0;
+    for (int i = 0; i < nPasses; ++i) {
+        const pass& p = passes[i];
+        GLsizei width = o.width / p.scale, height = o.height / p.scale;
+        GLuint size = formatSize(p.format);
+        glGenTextures(1, &passTarget[i]);                                                       GLCHK;
+        if (options::ALIASED == o.option) {
+            // first fit among the physical textures whose current occupant is dead by now
+            size_t k = 0;
+            while (k < slots.size() && !(slots[k].width == width && slots[k].height == height && slots[k].size == size && slots[k].freeAfter < i)) ++k;
+            if (k == slots.size()) {
+                slot sl = { width, height, size, -1 }; slots.push_back(sl);
+                GLuint tex; glGenTextures(1, &tex);                                             GLCHK;
+                glBindTexture(GL_TEXTURE_2D, tex);                                              GLCHK;
+                glTexStorage2D(GL_TEXTURE_2D, 1, p.format, width, height);                      GLCHK;
+                physical.push_back(tex);
+                graphBytes += width * height * size;
+            }
+            slots[k].freeAfter = passLastUse[i];
+            glTextureView(passTarget[i], GL_TEXTURE_2D, physical[k], p.format, 0, 1, 0, 1);     GLCHK;
+            glBindTexture(GL_TEXTURE_2D, passTarget[i]);                                        GLCHK;
+        } else {
+            glBindTexture(GL_TEXTURE_2D, passTarget[i]);                                        GLCHK;
+            glTexStorage2D(GL_TEXTURE_2D, 1, p.format, width, height);                          GLCHK;
+            graphBytes += width * height * size;
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);                       GLCHK;
+        glGenFramebuffers(1, &passFbo[i]);                                                      GLCHK;
+        glBindFramebuffer(GL_FRAMEBUFFER, passFbo[i]);                                          GLCHK;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, passTarget[i], 0); GLCHK;
+        if (GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER))                __debugbreak();
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);                                                       GLCHK;
+}
+
+// Static function to render one frame of the render graph and blit the final pass to the backbuffer
+static void renderGraph(const struct options& o)
+{
+    glUseProgram(passProgram);                                                                  GLCHK;
+    for (int i = 0; i < nPasses; ++i) {
+        const pass& p = passes[i];
+        glBindFramebuffer(GL_FRAMEBUFFER, passFbo[i]);                                          GLCHK;
+        glViewport(0, 0, o.width / p.scale, o.height / p.scale);                                GLCHK;
+        glUniform1i(passFlip, p.input[0] < 0);                                                  GLCHK;
+        if (options::CLEAR == o.clear || options::INVALIDATE == o.clear) {
+            glClear(GL_COLOR_BUFFER_BIT);                                                       GLCHK;
+        }
+        for (int j = 0; j < 2; ++j) {
+            glActiveTexture(GL_TEXTURE0 + j);                                                   GLCHK;
+            glBindTexture(GL_TEXTURE_2D, p.input[j] < 0 ? texture : passTarget[p.input[j]]);    GLCHK;
+        }
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                                  GLCHK;
+
+        // the inputs read for the last time are dead now
+        for (int j = 0; options::INVALIDATE == o.clear && j < i; ++j) if (passLastUse[j] == i) {
+            static const GLenum attachment = GL_COLOR_ATTACHMENT0;
+            glBindFramebuffer(GL_FRAMEBUFFER, passFbo[j]);                                      GLCHK;
+            glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &attachment);                            GLCHK;
+        }
+    }
+    glActiveTexture(GL_TEXTURE0);                                                               GLCHK;
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+    glUseProgram(program);                                                                      GLCHK;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, passFbo[nPasses - 1]);                               GLCHK;
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);                                                  GLCHK;
+    glBlitFramebuffer(0, 0, o.width, o.height, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_LINEAR);     GLCHK;
+    if (options::INVALIDATE == o.clear) {
+        static const GLenum attachment = GL_COLOR_ATTACHMENT0;
+        glInvalidateFramebuffer(GL_READ_FRAMEBUFFER, 1, &attachment);                           GLCHK;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);                                                       GLCHK;
+}
+
+// Static function to create the render target pool and the FBOs for the selected option.   Returns false if the
+// implementation doesn't support that many color attachments.
+static bool createPool(const struct options& o)
+{
+    GLint maxAttachments, maxDrawBuffers;
+    glGetIntegerv(GL_MAX_COLOR_ATTACHMENTS, &maxAttachments);                                   GLCHK;
+    glGetIntegerv(GL_MAX_DRAW_BUFFERS, &maxDrawBuffers);                                        GLCHK;
+    if (GLint(o.colors) > maxAttachments || GLint(o.colors) > maxDrawBuffers) return false;
+    if (o.option >= options::DEDICATED) {
+        createGraph(o);
+        return true;
+    }
+
+    // create the surfaces, renderbuffers or single level textures
+    surfaceTarget = o.target;
+    for (GLuint set = 0; set < nSets; ++set) {
+        for (GLuint i = 0; i <= maxColors; ++i) {
+            if ((i < maxColors && i >= o.colors) || (i == maxColors && !o.depthStencil)) continue;
+            GLenum format = i < maxColors ? o.format : o.depthStencil;
+            if (GL_RENDERBUFFER == o.target) {
+                glGenRenderbuffers(1, &surface[set][i]);                                        GLCHK;
+                glBindRenderbuffer(GL_RENDERBUFFER, surface[set][i]);                           GLCHK;
+                glRenderbufferStorage(GL_RENDERBUFFER, format, o.width, o.height);              GLCHK;
+            } else {
+                glGenTextures(1, &surface[set][i]);                                             GLCHK;
+                glBindTexture(GL_TEXTURE_2D, surface[set][i]);                                  GLCHK;
+                glTexStorage2D(GL_TEXTURE_2D, 1, format, o.width, o.height);                    GLCHK;
+            }
+        }
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);                                                     GLCHK;
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+
+    // one fbo per set, plus one that gets its surfaces swapped
+    for (GLuint set = 0; set < nSets; ++set) cleared[set] = false;
+    static const GLenum drawBuffers[maxColors] = {
+        GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3,
+        GL_COLOR_ATTACHMENT4, GL_COLOR_ATTACHMENT5, GL_COLOR_ATTACHMENT6, GL_COLOR_ATTACHMENT7,
+    };
+    glGenFramebuffers(3, fbo);                                                                  GLCHK;
+    for (int i = 0; i < 3; ++i) {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[i]);                                              GLCHK;
+        attach(o, i % nSets);
+        glDrawBuffers(o.colors, drawBuffers);                                                   GLCHK;
+        if (GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER))                __debugbreak();
+    }
+
+    // restore default framebuffer a.k.a backbuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);                                                       GLCHK;
+    return true;
+}
+
+// Static function to delete the render target pool, the render graph and the FBOs
+static void destroyPool()
+{
+    glDeleteFramebuffers(3, fbo);                                                               GLCHK;
+    for (GLuint set = 0; set < nSets; ++set) {
+        for (GLuint i = 0; i <= maxColors; ++i) {
+            // renderbuffer and texture names are numbered separately, so a name alone doesn't say which it is
+            if (GL_RENDERBUFFER == surfaceTarget) glDeleteRenderbuffers(1, &surface[set][i]);   GLCHK;
+            if (GL_TEXTURE_2D == surfaceTarget) glDeleteTextures(1, &surface[set][i]);          GLCHK;
+            surface[set][i] = 0;
+        }
+    }
+    for (int i = 0; i < nPasses; ++i) {
+        glDeleteFramebuffers(1, &passFbo[i]);                                                   GLCHK;
+        glDeleteTextures(1, &passTarget[i]);                                                    GLCHK;
+        passFbo[i] = passTarget[i] = 0;
+    }
+    if (!physical.empty()) glDeleteTextures((GLsizei)physical.size(), &physical[0]);            GLCHK;
+    physical.clear();
+}
+
 // GLUT initialization function.   Initialize program state as defined in static variables.
 void init()
 {
@@ -159,6 +535,9 @@ void init()
     program = createProgram({ vShader, fShader });
     offset = glGetUniformLocation(program, "offset");                                           GLCHK;
     texUnit = glGetUniformLocation(program, "texUnit");                                         GLCHK;
+    passProgram = createProgram({ compileShader(passVertexShader, GL_VERTEX_SHADER), compileShader(passFragmentShader, GL_FRAGMENT_SHADER) });
+    clearProgram = createProgram({ compileShader(passVertexShader, GL_VERTEX_SHADER), compileShader(clearFragmentShader, GL_FRAGMENT_SHADER) });
+    passFlip = glGetUniformLocation(passProgram, "flip");                                       GLCHK;
     glUseProgram(program);                                                                      GLCHK;
 
     // configure texture unit
@@ -180,23 +559,11 @@ void init()
     glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, &img[0]);      GLCHK;
 
-    // create the fbos
-    glGenFramebuffers(3, fbo);                                                                  GLCHK;
-    glGenRenderbuffers(2, rb);                                                                  GLCHK;
-    for (int i = 0; i < 2; ++i) {
-        glBindRenderbuffer(GL_RENDERBUFFER, rb[i]);                                             GLCHK;
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 640, 480);                             GLCHK;
-    }
-    glViewport(0, 0, 640, 480);                                                                 GLCHK;
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);                                                     GLCHK;
-    for (int i = 0; i < 3; ++i) {
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo[i]);                                              GLCHK;
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rb[i % 2]); GLCHK;
-        if (GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus(GL_FRAMEBUFFER))                __debugbreak();
-    }
+    // depth testing always passes, so the depth/stencil surfaces get written when present
+    glDepthFunc(GL_ALWAYS);                                                                     GLCHK;
 
-    // restore default framebuffer a.k.a backbuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);                                                       GLCHK;
+    // create the render target pool
+    if (!createPool(options[selector]))                                                         __debugbreak();
 }
 
 // GLUT display function.   Draw one frame's worth of imagery.
@@ -207,26 +574,56 @@ void display()
     // attributeless rendering
     glClear(GL_COLOR_BUFFER_BIT);                                                               GLCHK;
     glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
-    if (!animating) {
-        glViewport(0, 0, 640, 480);                                                             GLCHK;
+    if (!animating && options[selector].option >= options::DEDICATED) {
+        renderGraph(options[selector]);
+    } else if (!animating) {
+        const struct options& o = options[selector];
+        glViewport(0, 0, o.width, o.height);                                                    GLCHK;
         glUniform1f(offset, 0.f);                                                               GLCHK;
-        if (options::FBO == options[selector].option) {
-            glBindFramebuffer(GL_FRAMEBUFFER, fbo[cnt % 2]);                                    GLCHK;
-        } else if (options::SURFACE == options[selector].option) {
-            glBindFramebuffer(GL_FRAMEBUFFER, fbo[2]);                                          GLCHK;
-            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rb[cnt % 2]); GLCHK;
+        if (o.depthStencil) glEnable(GL_DEPTH_TEST);                                            GLCHK;
+        GLbitfield mask = GL_COLOR_BUFFER_BIT | (o.depthStencil ? GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT : 0);
+        GLenum attachment[maxColors + 1]; GLsizei n = attachments(o, attachment);
+        for (GLuint i = 0; i < o.switches; ++i) {
+            GLuint set = (cnt * o.switches + i) % nSets;
+            bool last = i == o.switches - 1;
+            if (options::FBO == o.option) {
+                glBindFramebuffer(GL_FRAMEBUFFER, fbo[set]);                                    GLCHK;
+            } else if (options::SURFACE == o.option) {
+                glBindFramebuffer(GL_FRAMEBUFFER, fbo[2]);                                      GLCHK;
+                attach(o, set);
+            }
+            if (options::DRAW == o.clear) {
+                glUseProgram(clearProgram);                                                     GLCHK;
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                          GLCHK;
+                glUseProgram(program);                                                          GLCHK;
+            } else if (options::ELIDE == o.clear && cleared[set]) {
+                // outside the quad the target still holds the clear color, inside it is about to be overwritten
+                glInvalidateSubFramebuffer(GL_FRAMEBUFFER, n, attachment, o.width / 4, o.height / 4, o.width / 2, o.height / 2); GLCHK;
+            } else {
+                glClear(mask);                                                                  GLCHK;
+                cleared[set] = true;
+            }
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                              GLCHK;
+
+            // only color attachment 0 of the last switch gets read, by the blit
+            if (options::INVALIDATE == o.clear) {
+                glInvalidateFramebuffer(GL_FRAMEBUFFER, last ? n - 1 : n, last ? attachment + 1 : attachment);   GLCHK;
+            }
         }
-    } else {
-        glViewport(0, 0, w, h);                                                                 GLCHK;
-        glUniform1f(offset, animation);                                                         GLCHK;
-    }
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                                      GLCHK;
-    if (!animating) {
+        glDisable(GL_DEPTH_TEST);                                                               GLCHK;
         glReadBuffer(GL_COLOR_ATTACHMENT0);                                                     GLCHK;
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);                                              GLCHK;
-        glBlitFramebuffer(0, 0, 640, 480, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_LINEAR);          GLCHK;
+        glBlitFramebuffer(0, 0, o.width, o.height, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_LINEAR); GLCHK;
+        if (options::INVALIDATE == o.clear) {
+            glInvalidateFramebuffer(GL_READ_FRAMEBUFFER, 1, attachment);                        GLCHK;
+        }
         glBindFramebuffer(GL_FRAMEBUFFER, 0);                                                   GLCHK;
+    } else {
+        glViewport(0, 0, w, h);                                                                 GLCHK;
+        glUniform1f(offset, animation);                                                         GLCHK;
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                                  GLCHK;
     }
+    recorder.frame();
     glutSwapBuffers();
 }
 
@@ -242,12 +639,26 @@ void keyboard(unsigned char key, int, int)
     // end on <esc> keypress
     if (key == 27) exit(0);
     if (key == ' ') swap = true;
+    if (key == 'c') recorder.toggle(capture::DROP);
+    if (key == 'C') recorder.toggle(capture::BLOCK);
+    if (key == 'a') recorder.toggle(capture::DROP, capture::APNG_FILE);
+    if (key == 'A') recorder.toggle(capture::BLOCK, capture::APNG_FILE);
 }
 
 // Static function to print currently selected test item's state.  Called every time the user presses <space>.
 void print()
 {
-    printf("\nmeasuring the swapping of %s ...\n", options[selector].optionStr);
+    const struct options& o = options[selector];
+    if (o.option >= options::DEDICATED) {
+        printf("\nmeasuring a %d pass render graph with %s targets, %dx%d, %s, memory = %.1f MB in %u textures ...\n",
+            nPasses, o.optionStr, o.width, o.height, clearStr[o.clear], graphBytes / (1024. * 1024.), physical.empty() ? nPasses : (unsigned)physical.size());
+        return;
+    }
+    GLuint pool = nSets * (o.colors * formatSize(o.format) + (o.depthStencil ? 4 : 0)) * o.width * o.height;
+    printf("\nmeasuring the swapping of %s, %u x %s %s%s%s, %dx%d, %u switches per frame, %s, pool = %.1f MB ...\n",
+        o.optionStr, o.colors, formatStr(o.format), GL_RENDERBUFFER == o.target ? "renderbuffers" : "textures",
+        o.depthStencil ? " + " : "", o.depthStencil ? formatStr(o.depthStencil) : "",
+        o.width, o.height, o.switches, clearStr[o.clear], pool / (1024. * 1024.));
 }
 
 // Static function.  Calculates elapsed time in microseconds.
@@ -277,7 +688,12 @@ void idle()
             animation = (sec < 0.5f ? sec : 1.f - sec) / 0.5f;
         } else {
             animating = false;
-            selector = (selector + 1) % options::nOPTS; skip = 0;
+            // replace the pool, skipping options the implementation doesn't support
+            destroyPool();
+            do {
+                selector = (selector + 1) % _countof(options);
+            } while (!createPool(options[selector]));
+            skip = 0;
             cnt = start = 0;
             print();
         }
@@ -326,7 +742,9 @@ int main(int argc, char** argv)
         printf("OpenGL renderer string: %s\n", glGetString(GL_RENDERER));
         printf("OpenGL version string: %s\n\n", glGetString(GL_VERSION));
         puts("This lesson compares the rendering performance between swapping entire FBOs or swapping the surface in a single FBO.");
-        puts("Press <esc> to exit; <space bar> to switch between swapping states ...\n");
+        puts("Press <c> to start or stop capturing frames to PNG files, <C> to capture without dropping frames.");
+        puts("Press <a> to start or stop capturing an animated PNG of the frames, <A> to capture it without dropping frames.");
+        puts("Press <esc> to exit; <space bar> to advance to the next render target configuration ...\n");
         print();
         glutMainLoop();
     }
@@ -13,6 +13,7 @@
 #include <GL/wglew.h>
 #include <GL/glut.h>
 #include <lodepng.h>
+#include <capture.h>
 
 #include <vector>
 
@@ -74,11 +75,36 @@ static GLint offset, texUnit;
 static GLfloat animation;
 static unsigned selector;
 static bool swap, animating;
+static capture::Recorder recorder("lesson6");
+
+// Asynchronous readback ring: each frame is read into the next pixel pack buffer and fenced, then mapped nReadback frames
+// later when the GPU is long done with it.   The latency from glReadPixels to the pixels being in buffer is accumulated.
+#define nReadback 3
+static GLuint pbo[nReadback];
+static GLsync readbackFence[nReadback];
+static void* readbackPtr[nReadback];
+static unsigned __int64 readbackIssued[nReadback];
+static unsigned readbackFrame, readbackCount;
+static unsigned __int64 readbackLatency;
+
+// Frames-in-flight limiter: a fence after every frame, the CPU waits for the fence of frame N-k before starting frame N
+#define maxInFlight 3
+static GLsync frameFence[maxInFlight];
+static unsigned fenceFrame;
+
+// Latency measurement: GL time when a frame starts, i.e. when the application would sample input, against a timestamp
+// query after the frame's last command.   A ring of queries is polled so measuring never stalls.
+#define nLatency 16
+static GLuint latencyQuery[nLatency];
+static GLint64 latencyStart[nLatency];
+static bool latencyPending[nLatency];
+static unsigned latencyFrame, latencyCount;
+static GLuint64 latencySum;
 
 // Array of structures, one item for each option we're testing
 #define I(x) { options:: ## x, #x }
 struct options {
-    enum  { NONE, READPIXELS, FLUSH, FINISH, nOPTS } option;
+    enum  { NONE, READPIXELS, FLUSH, FINISH, PBO, PERSISTENT, GETBUFFERSUBDATA, INFLIGHT_1, INFLIGHT_2, INFLIGHT_3, nOPTS } option;
     const char* optionStr;
 } options[]
 {
@@ -86,6 +112,12 @@ struct options {
         I(READPIXELS),
         I(FLUSH),
         I(FINISH),
+        I(PBO),
+        I(PERSISTENT),
+        I(GETBUFFERSUBDATA),
+        I(INFLIGHT_1),
+        I(INFLIGHT_2),
+        I(INFLIGHT_3),
 };
 
 // Debug build performs OpenGL error checking, Release does not
@@ -146,6 +178,108 @@ static void versionCheck()
     }
 }
 
+// Static function to check whether the implementation supports an option, persistent mapping needs ARB_buffer_storage
+static bool supported(const struct options& o)
+{
+    return o.option != options::PERSISTENT || GLEW_ARB_buffer_storage;
+}
+
+// Static function to (re)create the readback ring for the selected option and the current window size
+static void createReadback()
+{
+    for (int i = 0; i < nReadback; ++i) {
+        if (readbackFence[i]) glDeleteSync(readbackFence[i]);                                   GLCHK;
+        readbackFence[i] = 0; readbackPtr[i] = NULL;
+    }
+    glDeleteBuffers(nReadback, pbo);                                                            GLCHK;
+    glGenBuffers(nReadback, pbo);                                                               GLCHK;
+    for (int i = 0; i < nReadback; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i]);                                             GLCHK;
+        if (options::PERSISTENT == options[selector].option) {
+            GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_PACK_BUFFER, w * h * 4, NULL, flags | GL_CLIENT_STORAGE_BIT); GLCHK;
+            readbackPtr[i] = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, w * h * 4, flags);       GLCHK;
+        } else {
+            glBufferData(GL_PIXEL_PACK_BUFFER, w * h * 4, NULL, GL_STREAM_READ);                GLCHK;
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);                                                      GLCHK;
+    readbackFrame = readbackCount = 0; readbackLatency = 0;
+}
+
+// Static function.  Calculates elapsed time in microseconds.
+static unsigned __int64 elapsedUS(unsigned __int64 now, unsigned __int64 start);
+
+// Static function to run one frame of the readback ring: collect the frame read nReadback frames ago, then start reading
+// this one.   The fence wait normally returns at once, it only blocks if the GPU is more than nReadback frames behind.
+static void readback()
+{
+    unsigned slot = readbackFrame++ % nReadback;
+    unsigned __int64 now; GLsizeiptr size = w * h * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);                                              GLCHK;
+    if (readbackFence[slot]) {
+        glClientWaitSync(readbackFence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);  GLCHK;
+        glDeleteSync(readbackFence[slot]);                                                      GLCHK;
+        switch (options[selector].option) {
+        case options::PBO:
+            memcpy(&buffer[0], glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT), size); GLCHK;
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);                                                GLCHK;
+            break;
+        case options::PERSISTENT:
+            memcpy(&buffer[0], readbackPtr[slot], size);
+            break;
+        case options::GETBUFFERSUBDATA:
+            glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, size, &buffer[0]);                      GLCHK;
+            break;
+        }
+        if (!QueryPerformanceCounter((PLARGE_INTEGER)&now))                                     __debugbreak();
+        readbackLatency += elapsedUS(now, readbackIssued[slot]); ++readbackCount;
+    }
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, 0);                                     GLCHK;
+    readbackFence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);                        GLCHK;
+    if (!QueryPerformanceCounter((PLARGE_INTEGER)&readbackIssued[slot]))                        __debugbreak();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);                                                      GLCHK;
+}
+
+// Static function to return the frames-in-flight limit of the selected option, 0 means unlimited
+static unsigned inFlight()
+{
+    switch (options[selector].option) {
+    case options::INFLIGHT_1: return 1;
+    case options::INFLIGHT_2: return 2;
+    case options::INFLIGHT_3: return 3;
+    default:                  return 0;
+    }
+}
+
+// Static function to drop the frame fences, called when the limit changes
+static void resetInFlight()
+{
+    for (int i = 0; i < maxInFlight; ++i) {
+        if (frameFence[i]) glDeleteSync(frameFence[i]);                                         GLCHK;
+        frameFence[i] = 0;
+    }
+    fenceFrame = 0;
+}
+
+// Static function to collect the latency of finished frames and, if its query is free, note the start of this frame.
+// Returns the query slot to end the frame with, or -1.
+static int beginLatency()
+{
+    for (int i = 0; i < nLatency; ++i) if (latencyPending[i]) {
+        GLuint available; glGetQueryObjectuiv(latencyQuery[i], GL_QUERY_RESULT_AVAILABLE, &available);  GLCHK;
+        if (!available) continue;
+        GLuint64 end; glGetQueryObjectui64v(latencyQuery[i], GL_QUERY_RESULT, &end);            GLCHK;
+        latencySum += end - latencyStart[i]; ++latencyCount;
+        latencyPending[i] = false;
+    }
+    int slot = latencyFrame % nLatency;
+    if (latencyPending[slot]) return -1;
+    glGetInteger64v(GL_TIMESTAMP, &latencyStart[slot]);                                         GLCHK;
+    ++latencyFrame;
+    return slot;
+}
+
 // GLUT initialization function.   Initialize program state as defined in static variables.
 void init()
 {
@@ -180,11 +314,22 @@ void init()
     // upload the image to vram
     glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, &img[0]);      GLCHK;
+
+    // create the latency queries
+    glGenQueries(nLatency, latencyQuery);                                                       GLCHK;
 }
 
 // GLUT display function.   Draw one frame's worth of imagery.
 void display()
 {
+    // wait until no more than the limit of frames are in flight
+    unsigned limit = animating ? 0 : inFlight();
+    if (limit && frameFence[fenceFrame % limit]) {
+        glClientWaitSync(frameFence[fenceFrame % limit], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED); GLCHK;
+        glDeleteSync(frameFence[fenceFrame % limit]);                                           GLCHK;
+    }
+    int latencySlot = animating ? -1 : beginLatency();
+
     // attributeless rendering
     glClear(GL_COLOR_BUFFER_BIT);                                                               GLCHK;
     glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
@@ -200,8 +345,20 @@ void display()
     case options::READPIXELS: glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, &buffer[0]);  GLCHK;  break;
     case options::FLUSH:      glFlush();                                                        GLCHK;  break;
     case options::FINISH:     glFinish();                                                       GLCHK;  break;
+    case options::PBO:
+    case options::PERSISTENT:
+    case options::GETBUFFERSUBDATA: readback();                                                         break;
+    default:                                                                                            break;
     }
+    recorder.frame();
     glutSwapBuffers();
+    if (latencySlot >= 0) {
+        glQueryCounter(latencyQuery[latencySlot], GL_TIMESTAMP);                                GLCHK;
+        latencyPending[latencySlot] = true;
+    }
+    if (limit) {
+        frameFence[fenceFrame++ % limit] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);       GLCHK;
+    }
 }
 
 // GLUT reshape function.   Make the OpenGL viewport follow the window's size
@@ -210,6 +367,7 @@ void reshape(int w, int h)
     // viewport follows window size
     glViewport(0, 0, (GLsizei)w, (GLsizei)h);
     ::w = w; ::h = h; buffer.resize(w * h);
+    createReadback();
 }
 
 // GLUT keyboard function.  Exit on <esc>, advance to next test item on <space>
@@ -218,6 +376,10 @@ void keyboard(unsigned char key, int, int)
     // end on <esc> keypress
     if (key == 27) exit(0);
     if (key == ' ') swap = true;
+    if (key == 'c') recorder.toggle(capture::DROP);
+    if (key == 'C') recorder.toggle(capture::BLOCK);
+    if (key == 'a') recorder.toggle(capture::DROP, capture::APNG_FILE);
+    if (key == 'A') recorder.toggle(capture::BLOCK, capture::APNG_FILE);
 }
 
 // Static function to print currently selected test item's state.  Called every time the user presses <space>.
@@ -254,7 +416,10 @@ void idle()
         }
         else {
             animating = false;
-            selector = (selector + 1) % options::nOPTS; skip = 0;
+            do {
+                selector = (selector + 1) % options::nOPTS;
+            } while (!supported(options[selector]));
+            createReadback(); resetInFlight(); skip = 0;
             cnt = start = 0;
             print();
         }
@@ -264,6 +429,15 @@ void idle()
     else if (sec >= 2)
     {
         printf("frames rendered = %I64u, uS = %I64u, fps = %f,  milliseconds-per-frame = %f\n", cnt, us, cnt * 1000000. / us, us / (cnt * 1000.));
+        if (latencyCount) {
+            printf("input-to-render latency = %f milliseconds\n", latencySum / (latencyCount * 1000000.));
+            latencyCount = 0; latencySum = 0;
+        }
+        if (readbackCount) {
+            printf("frames read back = %u, readback latency = %f milliseconds, readback throughput = %f MB/s\n",
+                readbackCount, readbackLatency / (readbackCount * 1000.), readbackCount * (w * h * 4.) / us);
+            readbackCount = 0; readbackLatency = 0;
+        }
         if (swap) {
             animating = true; animationStart = now; swap = false;
         } else {
@@ -303,6 +477,8 @@ int main(int argc, char** argv)
         printf("OpenGL renderer string: %s\n", glGetString(GL_RENDERER));
         printf("OpenGL version string: %s\n\n", glGetString(GL_VERSION));
         puts("This lesson compares the performance between using a gpu synchronizing call and not using a gpu synchronizing call.");
+        puts("Press <c> to start or stop capturing frames to PNG files, <C> to capture without dropping frames.");
+        puts("Press <a> to start or stop capturing an animated PNG of the frames, <A> to capture it without dropping frames.");
         puts("Press <esc> to exit; <space bar> to switch between states ...\n");
         print();
         glutMainLoop();
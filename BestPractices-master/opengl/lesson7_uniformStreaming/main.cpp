@@ -0,0 +1,547 @@
+//"Copyright 2016 Intel Corporation.
+//
+//The source code, information and material("Material") contained herein is owned by Intel Corporation or its suppliers or licensors, and title to such Material 
+//remains with Intel Corporation or its suppliers or licensors.The Material contains proprietary information of Intel or its suppliers and licensors.
+//The Material is protected by worldwide copyright laws and treaty provisions.
+//No part of the Material may be used, copied, reproduced, modified, published, uploaded, posted, transmitted,distributed or disclosed in any way without Intel's prior express written permission. 
+//No license under any patent, copyright or other intellectual property rights in the Material is granted to or conferred upon you, either expressly, by implication, inducement, estoppel or otherwise. Any license under such intellectual property rights must be express and approved by Intel in writing.
+//Unless otherwise agreed by Intel in writing, you may not remove or alter this notice or any other notice embedded in 
+//Materials by Intel or Intel's suppliers or licensors in any way."
+
+
+#include <GL/glew.h>
+#include <GL/wglew.h>
+#include <GL/glut.h>
+#include <lodepng.h>
+#include <capture.h>
+#include <streambuffer.h>
+
+#include <vector>
+
+#include <string>
+
+#include <intrin.h>
+
+// This example uses attribute-less rendering, except for the draw index of the PERSISTENT_SSBO option
+
+// Vertex shader specifies vertex position in clip space
+static std::string vertexShader =
+"#version 430 core\n"
+"\n"
+"const vec2 Position[4] = vec2[]\n"
+"(\n"
+"    vec2(-1,  1),\n"
+"    vec2(-1, -1),\n"
+"    vec2( 1,  1),\n"
+"    vec2( 1, -1) \n"
+");"
+"\n"
+"uniform float offset;\n"
+"\n"
+"smooth out vec2 texcoord;\n"
+"\n"
+"void main()\n"
+"{\n"
+"    vec2 pos = Position[ gl_VertexID ];\n"
+"    pos.x += offset * -sign(pos.x);\n"
+"    gl_Position = vec4(pos * 0.5, 0.0, 1.0);\n"
+"    texcoord = pos * vec2(0.5, -0.5) + 0.5;\n"
+"}\n"
+;
+
+// Fragment shader gets output color from a texture
+static std::string fragmentShader =
+    "#version 430 core\n"
+    "\n"
+    "uniform sampler2D texUnit;\n"
+    "\n"
+    "smooth in vec2 texcoord;\n"
+    "\n"
+    "layout(location = 0) out vec4 fragColor;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    fragColor = texture(texUnit, texcoord);\n"
+    "}\n"
+;
+
+// Vertex shader for the test draws, each draw is a small textured quad placed and tinted by its per-draw data.
+// Compiled three ways: UNIFORM reads plain uniforms, UBO reads a uniform block bound per draw, SSBO indexes an array
+// of all draws of the frame with the draw index attribute.
+static std::string drawVertexShader =
+"\n"
+"const vec2 Position[4] = vec2[]\n"
+"(\n"
+"    vec2(-1,  1),\n"
+"    vec2(-1, -1),\n"
+"    vec2( 1,  1),\n"
+"    vec2( 1, -1) \n"
+");"
+"\n"
+"#if defined(UNIFORM)\n"
+"uniform vec4 xform;\n"
+"uniform vec4 tint;\n"
+"#elif defined(UBO)\n"
+"layout(std140, binding = 0) uniform drawData\n"
+"{\n"
+"    vec4 xform;\n"
+"    vec4 tint;\n"
+"};\n"
+"#else\n"
+"struct DrawData\n"
+"{\n"
+"    vec4 xform;\n"
+"    vec4 tint;\n"
+"};\n"
+"layout(std430, binding = 0) readonly buffer drawData\n"
+"{\n"
+"    DrawData draws[];\n"
+"};\n"
+"layout(location = 1) in uint drawId;\n"
+"#endif\n"
+"\n"
+"smooth out vec2 texcoord;\n"
+"smooth out vec4 color;\n"
+"\n"
+"void main()\n"
+"{\n"
+"#ifdef SSBO\n"
+"    vec4 xform = draws[drawId].xform, tint = draws[drawId].tint;\n"
+"#endif\n"
+"    vec2 pos = Position[ gl_VertexID ];\n"
+"    gl_Position = vec4(pos * xform.zw + xform.xy, 0.0, 1.0);\n"
+"    texcoord = pos * vec2(0.5, -0.5) + 0.5;\n"
+"    color = tint;\n"
+"}\n"
+;
+
+// Fragment shader for the test draws, modulates the texture with the draw's tint
+static std::string drawFragmentShader =
+    "#version 430 core\n"
+    "\n"
+    "uniform sampler2D texUnit;\n"
+    "\n"
+    "smooth in vec2 texcoord;\n"
+    "smooth in vec4 color;\n"
+    "\n"
+    "layout(location = 0) out vec4 fragColor;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    fragColor = texture(texUnit, texcoord) * color;\n"
+    "}\n"
+;
+
+// Per-draw data, the same layout in std140 and std430
+struct DrawData {
+    GLfloat xform[4];
+    GLfloat tint[4];
+};
+
+// Static variables, program state
+static GLenum err;
+static GLuint vShader;
+static GLuint fShader;
+static GLuint program;
+static GLuint texture;
+static GLint offset, texUnit;
+static GLfloat animation;
+static unsigned selector;
+static bool swap, animating;
+static capture::Recorder recorder("lesson7");
+
+// Test state: a program per way of reading the per-draw data, the UBO the non-persistent options update, the draw index
+// attribute and the two streaming rings.   CPU submission time of the test draws is accumulated per frame.
+#define maxDraws 16384
+enum { UNIFORM_PROGRAM, UBO_PROGRAM, SSBO_PROGRAM, nPROGRAMS };
+static GLuint drawProgram[nPROGRAMS];
+static GLint xformLoc, tintLoc, drawTexUnit[nPROGRAMS];
+static GLuint ubo, drawIdBuffer;
+static StreamBuffer uboRing, ssboRing;
+static bool persistent;
+static unsigned frame;
+static unsigned __int64 cpuUS;
+
+// Array of structures, one item for each option we're testing
+#define I(x, n) { options:: ## x, #x, n }
+struct options {
+    enum  { UNIFORM, SUBDATA, ORPHAN, PERSISTENT_UBO, PERSISTENT_SSBO, nOPTS } option;
+    const char* optionStr;
+    GLuint draws;
+} options[]
+{
+    I(UNIFORM, 1024),
+        I(SUBDATA, 1024),
+        I(ORPHAN, 1024),
+        I(PERSISTENT_UBO, 1024),
+        I(PERSISTENT_SSBO, 1024),
+        I(UNIFORM, 16384),
+        I(SUBDATA, 16384),
+        I(ORPHAN, 16384),
+        I(PERSISTENT_UBO, 16384),
+        I(PERSISTENT_SSBO, 16384),
+};
+
+// Debug build performs OpenGL error checking, Release does not
+#ifdef _DEBUG
+#define GLCHK { if (GL_NO_ERROR != (err=glGetError())) __debugbreak(); }
+#else
+#define GLCHK
+#define __debugbreak() {}
+#endif
+
+// Static function to compile an OpenGL shader, check and report errors
+static GLuint compileShader(const std::string& src, GLenum type)
+{
+    GLuint shader = glCreateShader(type);														GLCHK;
+    const GLchar* str = src.c_str();  glShaderSource(shader, 1, &str, NULL);					GLCHK;
+    glCompileShader(shader);                                                                    GLCHK;
+    GLint status; glGetShaderiv(shader, GL_COMPILE_STATUS, &status); if (GL_FALSE == status) {  GLCHK;
+        GLint sz; glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &sz);                               GLCHK;
+        std::vector<GLchar> v(sz); glGetShaderInfoLog(shader, sz, &sz, &v[0]);                  GLCHK;
+        const char* msg = &v[0];  __debugbreak();
+        glDeleteShader(shader);                                                                 GLCHK;
+        return 0;
+    }
+    return shader;
+}
+
+// Static function to compile an OpenGL shader, check and report errors
+static GLuint createProgram(std::initializer_list<GLuint> shaders)
+{
+    GLuint program = glCreateProgram();                                                         GLCHK;
+    for (auto shader : shaders) glAttachShader(program, shader);                                GLCHK;
+    glLinkProgram(program);                                                                     GLCHK;
+    GLint status; glGetProgramiv(program, GL_LINK_STATUS, &status); if (GL_FALSE == status) {   GLCHK;
+        GLint sz; glGetProgramiv(program, GL_INFO_LOG_LENGTH, &sz);                             GLCHK;
+        std::vector<GLchar> v(sz); glGetProgramInfoLog(program, sz, &sz, &v[0]);                GLCHK;
+        const char* msg = &v[0];  __debugbreak();
+        glDeleteProgram(program);                                                               GLCHK;
+        for (auto shader : shaders) glDeleteShader(shader);                                     GLCHK;
+        return 0;
+    }
+    for (auto shader : shaders) glDetachShader(program, shader);                                GLCHK;
+    return program;
+}
+
+// Static function to check for minimum OpenGL version (which is 4.3 for now0
+static void versionCheck()
+{
+    const char* s = (const char *)glGetString(GL_VERSION);
+    int v[2]; sscanf_s(s, "%d.%d", &v[0], &v[1]);
+    if (v[0] < 4 || v[1] < 3) {
+        char msg[512]; sprintf_s(msg,
+            "Error, Inadequate OpenGL Version!\n\n"
+            "This lesson requires OpenGL version 4.3 or better.\n\n"
+            "Your version is: %s\n\n"
+            "Press Ok to exit the application.", s);
+        MessageBox(NULL, msg, "Bad OpenGL Version", MB_OK | MB_ICONERROR);
+        exit(0);
+    }
+}
+
+// Static function to check whether the implementation supports an option, the rings need ARB_buffer_storage
+static bool supported(const struct options& o)
+{
+    return (o.option != options::PERSISTENT_UBO && o.option != options::PERSISTENT_SSBO) || persistent;
+}
+
+// Static function to fill in the per-draw data of draw i of n.   Draws are laid out in a grid and move a little every
+// frame, which is about as much work as an application does per draw anyway.
+static void drawData(DrawData& d, GLuint i, GLuint n)
+{
+    GLuint side = 1; while (side * side < n) ++side;
+    GLuint col = i % side, row = i / side;
+    GLfloat cell = 2.f / side;
+    d.xform[0] = -1.f + (col + 0.5f) * cell + ((frame + i) & 15) * cell * 0.01f;
+    d.xform[1] = 1.f - (row + 0.5f) * cell;
+    d.xform[2] = d.xform[3] = cell * 0.4f;
+    d.tint[0] = (GLfloat)col / side;
+    d.tint[1] = (GLfloat)row / side;
+    d.tint[2] = (frame & 255) / 255.f;
+    d.tint[3] = 1.f;
+}
+
+// Static function to compile one variant of the draw program
+static GLuint createDrawProgram(const char* variant)
+{
+    std::string src = std::string("#version 430 core\n#define ") + variant + "\n" + drawVertexShader;
+    GLuint v = compileShader(src, GL_VERTEX_SHADER);
+    GLuint f = compileShader(drawFragmentShader, GL_FRAGMENT_SHADER);
+    GLuint p = createProgram({ v, f });
+    glDeleteShader(v);                                                                          GLCHK;
+    glDeleteShader(f);                                                                          GLCHK;
+    return p;
+}
+
+// Static function to submit the test draws of the selected option
+static void drawTest()
+{
+    const struct options& o = options[selector];
+    DrawData d; GLintptr at; void* p;
+    switch (o.option) {
+    case options::UNIFORM:
+        glUseProgram(drawProgram[UNIFORM_PROGRAM]);                                             GLCHK;
+        for (GLuint i = 0; i < o.draws; ++i) {
+            drawData(d, i, o.draws);
+            glUniform4fv(xformLoc, 1, d.xform);                                                 GLCHK;
+            glUniform4fv(tintLoc, 1, d.tint);                                                   GLCHK;
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                              GLCHK;
+        }
+        break;
+    case options::SUBDATA:
+    case options::ORPHAN:
+        glUseProgram(drawProgram[UBO_PROGRAM]);                                                 GLCHK;
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, ubo);                                            GLCHK;
+        for (GLuint i = 0; i < o.draws; ++i) {
+            drawData(d, i, o.draws);
+            if (options::ORPHAN == o.option) {
+                glBufferData(GL_UNIFORM_BUFFER, sizeof(d), NULL, GL_STREAM_DRAW);               GLCHK;
+            }
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(d), &d);                               GLCHK;
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                              GLCHK;
+        }
+        break;
+    case options::PERSISTENT_UBO:
+        glUseProgram(drawProgram[UBO_PROGRAM]);                                                 GLCHK;
+        uboRing.begin();
+        for (GLuint i = 0; i < o.draws; ++i) {
+            if (!(p = uboRing.alloc(sizeof(d), at)))                                            __debugbreak();
+            drawData(*(DrawData*)p, i, o.draws);
+            glBindBufferRange(GL_UNIFORM_BUFFER, 0, uboRing.name(), at, sizeof(d));             GLCHK;
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                              GLCHK;
+        }
+        uboRing.end();
+        break;
+    case options::PERSISTENT_SSBO:
+        glUseProgram(drawProgram[SSBO_PROGRAM]);                                                GLCHK;
+        ssboRing.begin();
+        if (!(p = ssboRing.alloc(o.draws * sizeof(d), at)))                                     __debugbreak();
+        for (GLuint i = 0; i < o.draws; ++i) drawData(((DrawData*)p)[i], i, o.draws);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, ssboRing.name(), at, o.draws * sizeof(d)); GLCHK;
+        glEnableVertexAttribArray(1);                                                           GLCHK;
+        for (GLuint i = 0; i < o.draws; ++i) {
+            glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, 1, i);                   GLCHK;
+        }
+        glDisableVertexAttribArray(1);                                                          GLCHK;
+        ssboRing.end();
+        break;
+    }
+}
+
+// GLUT initialization function.   Initialize program state as defined in static variables.
+void init()
+{
+    versionCheck();
+
+    // turn off vsync
+    if (!wglSwapIntervalEXT(0))                                                                 __debugbreak();
+
+    // compile and link the shaders into a program, make it active
+    vShader = compileShader(vertexShader, GL_VERTEX_SHADER);
+    fShader = compileShader(fragmentShader, GL_FRAGMENT_SHADER);
+    program = createProgram({ vShader, fShader });
+    offset = glGetUniformLocation(program, "offset");                                           GLCHK;
+    texUnit = glGetUniformLocation(program, "texUnit");                                         GLCHK;
+    glUseProgram(program);                                                                      GLCHK;
+
+    // configure texture unit
+    glActiveTexture(GL_TEXTURE0);                                                               GLCHK;
+    glUniform1i(texUnit, 0);                                                                    GLCHK;
+
+    // compile the test programs, they sample the same texture unit
+    drawProgram[UNIFORM_PROGRAM] = createDrawProgram("UNIFORM");
+    drawProgram[UBO_PROGRAM] = createDrawProgram("UBO");
+    drawProgram[SSBO_PROGRAM] = createDrawProgram("SSBO");
+    xformLoc = glGetUniformLocation(drawProgram[UNIFORM_PROGRAM], "xform");                     GLCHK;
+    tintLoc = glGetUniformLocation(drawProgram[UNIFORM_PROGRAM], "tint");                       GLCHK;
+    for (int i = 0; i < nPROGRAMS; ++i) {
+        drawTexUnit[i] = glGetUniformLocation(drawProgram[i], "texUnit");                       GLCHK;
+        glProgramUniform1i(drawProgram[i], drawTexUnit[i], 0);                                  GLCHK;
+    }
+
+    // the uniform buffer the SUBDATA and ORPHAN options update before every draw
+    glGenBuffers(1, &ubo);                                                                      GLCHK;
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);                                                       GLCHK;
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(DrawData), NULL, GL_STREAM_DRAW);                    GLCHK;
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);                                                         GLCHK;
+
+    // the draw index attribute, advanced once per instance so base instance selects the draw's element of the SSBO
+    std::vector<GLuint> ids(maxDraws); for (GLuint i = 0; i < maxDraws; ++i) ids[i] = i;
+    glGenBuffers(1, &drawIdBuffer);                                                             GLCHK;
+    glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);                                                GLCHK;
+    glBufferData(GL_ARRAY_BUFFER, maxDraws * sizeof(GLuint), &ids[0], GL_STATIC_DRAW);          GLCHK;
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, 0, 0);                                        GLCHK;
+    glVertexAttribDivisor(1, 1);                                                                GLCHK;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);                                                           GLCHK;
+
+    // the streaming rings, a region per frame in flight, sized for the largest option
+    GLint uboAlign, ssboAlign;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlign);                               GLCHK;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssboAlign);                       GLCHK;
+    GLsizeiptr uboStride = (sizeof(DrawData) + uboAlign - 1) / uboAlign * uboAlign;
+    persistent = uboRing.create(maxDraws * uboStride, uboAlign) && ssboRing.create(maxDraws * sizeof(DrawData), ssboAlign);
+
+    // create and configure the textures
+    glGenTextures(1, &texture);                                                                 GLCHK;
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);                               GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);                               GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);                          GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);                          GLCHK;
+
+    // load texture image
+    GLuint w, h;  std::vector<GLubyte> img; if (lodepng::decode(img, w, h, "sample.png"))    __debugbreak();
+
+    // upload the image to vram
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, &img[0]);      GLCHK;
+}
+
+// Static function.  Calculates elapsed time in microseconds.
+static unsigned __int64 elapsedUS(unsigned __int64 now, unsigned __int64 start);
+
+// GLUT display function.   Draw one frame's worth of imagery.
+void display()
+{
+    // attributeless rendering
+    glClear(GL_COLOR_BUFFER_BIT);                                                               GLCHK;
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+    if (animating) {
+        glUseProgram(program);                                                                  GLCHK;
+        glUniform1f(offset, animation);                                                         GLCHK;
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                                  GLCHK;
+    } else {
+        // time only the submission of the test draws
+        unsigned __int64 start, now;
+        if (!QueryPerformanceCounter((PLARGE_INTEGER)&start))                                   __debugbreak();
+        drawTest();
+        if (!QueryPerformanceCounter((PLARGE_INTEGER)&now))                                     __debugbreak();
+        cpuUS += elapsedUS(now, start); ++frame;
+    }
+    recorder.frame();
+    glutSwapBuffers();
+}
+
+// GLUT reshape function.   Make the OpenGL viewport follow the window's size
+void reshape(int w, int h)
+{
+    // viewport follows window size
+    glViewport(0, 0, (GLsizei)w, (GLsizei)h);
+}
+
+// GLUT keyboard function.  Exit on <esc>, advance to next test item on <space>
+void keyboard(unsigned char key, int, int)
+{
+    // end on <esc> keypress
+    if (key == 27) exit(0);
+    if (key == ' ') swap = true;
+    if (key == 'c') recorder.toggle(capture::DROP);
+    if (key == 'C') recorder.toggle(capture::BLOCK);
+    if (key == 'a') recorder.toggle(capture::DROP, capture::APNG_FILE);
+    if (key == 'A') recorder.toggle(capture::BLOCK, capture::APNG_FILE);
+}
+
+// Static function to print currently selected test item's state.  Called every time the user presses <space>.
+void print()
+{
+    printf("\ntesting %s with %u draws per frame ...\n", options[selector].optionStr, options[selector].draws);
+}
+
+// Static function.  Calculates elapsed time in microseconds.
+static unsigned __int64 elapsedUS(unsigned __int64 now, unsigned __int64 start)
+{
+    unsigned __int64 freq; if (!QueryPerformanceFrequency((PLARGE_INTEGER)&freq))                               __debugbreak();
+    unsigned __int64 elapsed = now >= start ? now - start : _UI64_MAX - start + now;
+    unsigned __int64 us = elapsed * 1000000ui64 / freq, sec = elapsed / freq;
+    return us;
+}
+
+// GLUT idle function.  Called once per video frame.  Calculate and print timing reports and handle console input.
+void idle()
+{
+    // Calculate performance
+    static unsigned __int64 skip;  if (++skip < 512) return;
+    static unsigned __int64 start; if (!start && !QueryPerformanceCounter((PLARGE_INTEGER)&start))              __debugbreak();
+    unsigned __int64 now;  if (!QueryPerformanceCounter((PLARGE_INTEGER)&now))                                  __debugbreak();
+    unsigned __int64 us = elapsedUS(now, start), sec = us / 1000000;
+    static unsigned __int64 animationStart;
+    static unsigned __int64 cnt; ++cnt;
+
+    // We're either animating
+    if (animating)
+    {
+        float sec = elapsedUS(now, animationStart) / 1000000.f; if (sec < 1.f) {
+            animation = (sec < 0.5f ? sec : 1.f - sec) / 0.5f;
+        }
+        else {
+            animating = false;
+            do {
+                selector = (selector + 1) % _countof(options);
+            } while (!supported(options[selector]));
+            skip = 0; cpuUS = 0;
+            cnt = start = 0;
+            print();
+        }
+    }
+
+    // Or measuring
+    else if (sec >= 2)
+    {
+        printf("frames rendered = %I64u, uS = %I64u, fps = %f,  milliseconds-per-frame = %f\n", cnt, us, cnt * 1000000. / us, us / (cnt * 1000.));
+        printf("CPU submission = %f microseconds per frame, %f nanoseconds per draw\n",
+            cpuUS / (double)cnt, cpuUS * 1000. / (cnt * options[selector].draws));
+        cpuUS = 0;
+        if (swap) {
+            animating = true; animationStart = now; swap = false;
+        } else {
+            cnt = start = 0;
+        }
+    }
+
+    // Get input from the console too.
+    HANDLE h = GetStdHandle(STD_INPUT_HANDLE); INPUT_RECORD r[128]; DWORD n;
+    if (PeekConsoleInput(h, r, 128, &n) && n)
+        if (ReadConsoleInput(h, r, n, &n))
+            for (DWORD i = 0; i < n; ++i)
+                if (r[i].EventType == KEY_EVENT && r[i].Event.KeyEvent.bKeyDown)
+                    keyboard(r[i].Event.KeyEvent.uChar.AsciiChar, 0, 0);
+
+    // Ask for another frame
+    glutPostRedisplay();
+}
+
+// Main function, program entry.  Configure, initialize then run application.  Catch and report all unexpected errors
+int main(int argc, char** argv)
+{
+    __try {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
+        glutInitWindowSize(640, 480);
+        glutInitWindowPosition(0, 480);
+        glutCreateWindow(argv[0]);
+        GLenum err = glewInit(); if (GLEW_OK != err)                                                        __debugbreak();
+        init();
+        glutDisplayFunc(display);
+        glutReshapeFunc(reshape);
+        glutKeyboardFunc(keyboard);
+        glutIdleFunc(idle);
+        SetWindowPos(GetConsoleWindow(), NULL, 0, 0, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
+        printf("OpenGL vendor string: %s\n", glGetString(GL_VENDOR));
+        printf("OpenGL renderer string: %s\n", glGetString(GL_RENDERER));
+        printf("OpenGL version string: %s\n\n", glGetString(GL_VERSION));
+        puts("This lesson compares the CPU cost of ways to stream per-draw data: glUniform, glBufferSubData, orphaning and a persistently mapped ring.");
+        puts("Press <c> to start or stop capturing frames to PNG files, <C> to capture without dropping frames.");
+        puts("Press <a> to start or stop capturing an animated PNG of the frames, <A> to capture it without dropping frames.");
+        puts("Press <esc> to exit; <space bar> to switch between states ...\n");
+        print();
+        glutMainLoop();
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER) {
+        MessageBox(NULL,
+            "Unhandled Exception!\n\n"
+            "An unknown error occurred.\n\n"
+            "Press OK to exit.", "Unknown Error", MB_OK | MB_ICONERROR);
+    }
+    return 0;
+}
@@ -0,0 +1,619 @@
+//"Copyright 2016 Intel Corporation.
+//
+//The source code, information and material("Material") contained herein is owned by Intel Corporation or its suppliers or licensors, and title to such Material 
+//remains with Intel Corporation or its suppliers or licensors.The Material contains proprietary information of Intel or its suppliers and licensors.
+//The Material is protected by worldwide copyright laws and treaty provisions.
+//No part of the Material may be used, copied, reproduced, modified, published, uploaded, posted, transmitted,distributed or disclosed in any way without Intel's prior express written permission. 
+//No license under any patent, copyright or other intellectual property rights in the Material is granted to or conferred upon you, either expressly, by implication, inducement, estoppel or otherwise. Any license under such intellectual property rights must be express and approved by Intel in writing.
+//Unless otherwise agreed by Intel in writing, you may not remove or alter this notice or any other notice embedded in 
+//Materials by Intel or Intel's suppliers or licensors in any way."
+
+
+#include <GL/glew.h>
+#include <GL/wglew.h>
+#include <GL/glut.h>
+#include <lodepng.h>
+#include <capture.h>
+
+#include <vector>
+
+#include <string>
+
+#include <intrin.h>
+
+// This example uses attribute-less rendering, except for the draw index of the instanced and indirect options
+
+// Vertex shader specifies vertex position in clip space
+static std::string vertexShader =
+"#version 430 core\n"
+"\n"
+"const vec2 Position[4] = vec2[]\n"
+"(\n"
+"    vec2(-1,  1),\n"
+"    vec2(-1, -1),\n"
+"    vec2( 1,  1),\n"
+"    vec2( 1, -1) \n"
+");"
+"\n"
+"uniform float offset;\n"
+"\n"
+"smooth out vec2 texcoord;\n"
+"\n"
+"void main()\n"
+"{\n"
+"    vec2 pos = Position[ gl_VertexID ];\n"
+"    pos.x += offset * -sign(pos.x);\n"
+"    gl_Position = vec4(pos * 0.5, 0.0, 1.0);\n"
+"    texcoord = pos * vec2(0.5, -0.5) + 0.5;\n"
+"}\n"
+;
+
+// Fragment shader gets output color from a texture
+static std::string fragmentShader =
+    "#version 430 core\n"
+    "\n"
+    "uniform sampler2D texUnit;\n"
+    "\n"
+    "smooth in vec2 texcoord;\n"
+    "\n"
+    "layout(location = 0) out vec4 fragColor;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    fragColor = texture(texUnit, texcoord);\n"
+    "}\n"
+;
+
+// Placement of the test quads, shared by the vertex and the culling shader.   Quads are laid out on a grid larger than
+// the window and scroll with time, so some of them are always off-screen.
+static std::string placeShader =
+"\n"
+"layout(std430, binding = 0) readonly buffer quads\n"
+"{\n"
+"    vec4 quad[];\n"
+"};\n"
+"\n"
+"uniform float time;\n"
+"\n"
+"vec4 place(uint i)\n"
+"{\n"
+"    vec4 q = quad[i];\n"
+"    q.xy = mod(q.xy + vec2(time * 0.1, 0.0) + 1.5, 3.0) - 1.5;\n"
+"    return q;\n"
+"}\n"
+;
+
+// Vertex shader for the test draws.   INDIVIDUAL gets the quad index from a uniform set before every draw, the other
+// options from the draw index attribute, which advances once per instance and starts at the draw's base instance.
+static std::string drawVertexShader =
+"\n"
+"const vec2 Position[4] = vec2[]\n"
+"(\n"
+"    vec2(-1,  1),\n"
+"    vec2(-1, -1),\n"
+"    vec2( 1,  1),\n"
+"    vec2( 1, -1) \n"
+");"
+"\n"
+"#ifdef INDIVIDUAL\n"
+"uniform uint drawIndex;\n"
+"#else\n"
+"layout(location = 1) in uint drawId;\n"
+"#define drawIndex drawId\n"
+"#endif\n"
+"\n"
+"smooth out vec2 texcoord;\n"
+"\n"
+"void main()\n"
+"{\n"
+"    vec4 q = place(drawIndex);\n"
+"    vec2 pos = Position[ gl_VertexID ];\n"
+"    gl_Position = vec4(pos * q.zw + q.xy, 0.0, 1.0);\n"
+"    texcoord = pos * vec2(0.5, -0.5) + 0.5;\n"
+"}\n"
+;
+
+// Compute shader for GPU_CULLED, writes one indirect draw command per quad, with no instances if the quad is off-screen
+static std::string cullShader =
+"\n"
+"layout(local_size_x = 64) in;\n"
+"\n"
+"struct Command\n"
+"{\n"
+"    uint count;\n"
+"    uint instanceCount;\n"
+"    uint first;\n"
+"    uint baseInstance;\n"
+"};\n"
+"\n"
+"layout(std430, binding = 1) writeonly buffer commands\n"
+"{\n"
+"    Command command[];\n"
+"};\n"
+"\n"
+"uniform uint quadCount;\n"
+"\n"
+"void main()\n"
+"{\n"
+"    uint i = gl_GlobalInvocationID.x;\n"
+"    if (i >= quadCount) return;\n"
+"    vec4 q = place(i);\n"
+"    bool visible = all(lessThan(abs(q.xy) - q.zw, vec2(1.0)));\n"
+"    command[i] = Command(4u, visible ? 1u : 0u, 0u, i);\n"
+"}\n"
+;
+
+// Indirect draw command, as glMultiDrawArraysIndirect reads it
+struct DrawArraysIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;
+};
+
+// Static variables, program state
+static GLenum err;
+static GLuint vShader;
+static GLuint fShader;
+static GLuint program;
+static GLuint texture;
+static GLint offset, texUnit;
+static GLfloat animation;
+static unsigned selector;
+static bool swap, animating;
+static capture::Recorder recorder("lesson8");
+
+// Test state: the quads, the draw index attribute, the static and the GPU written command buffers and the programs.
+// INDIVIDUAL alternates between two textures so every draw changes state.
+#define maxQuads 100000
+enum { INDIVIDUAL_PROGRAM, DRAWID_PROGRAM, nPROGRAMS };
+static GLuint drawProgram[nPROGRAMS], cullProgram;
+static GLint drawIndexLoc, timeLoc[nPROGRAMS], cullTimeLoc, quadCountLoc;
+static GLuint quadBuffer, drawIdBuffer, commandBuffer, cullBuffer;
+static GLuint drawTexture[2];
+static GLfloat scroll;
+static unsigned __int64 cpuUS;
+
+// GPU time of the test draws, measured with a ring of time elapsed queries that are polled so measuring never stalls
+#define nTimer 8
+static GLuint timerQuery[nTimer];
+static bool timerPending[nTimer];
+static unsigned timerFrame, timerCount;
+static GLuint64 timerSum;
+
+// Array of structures, one item for each option we're testing
+#define I(x, n) { options:: ## x, #x, n }
+struct options {
+    enum  { INDIVIDUAL, INSTANCED, MULTIDRAW_INDIRECT, GPU_CULLED, nOPTS } option;
+    const char* optionStr;
+    GLuint quads;
+} options[]
+{
+    I(INDIVIDUAL, 1),
+        I(INSTANCED, 1),
+        I(MULTIDRAW_INDIRECT, 1),
+        I(GPU_CULLED, 1),
+        I(INDIVIDUAL, 100),
+        I(INSTANCED, 100),
+        I(MULTIDRAW_INDIRECT, 100),
+        I(GPU_CULLED, 100),
+        I(INDIVIDUAL, 10000),
+        I(INSTANCED, 10000),
+        I(MULTIDRAW_INDIRECT, 10000),
+        I(GPU_CULLED, 10000),
+        I(INDIVIDUAL, 100000),
+        I(INSTANCED, 100000),
+        I(MULTIDRAW_INDIRECT, 100000),
+        I(GPU_CULLED, 100000),
+};
+
+// Debug build performs OpenGL error checking, Release does not
+#ifdef _DEBUG
+#define GLCHK { if (GL_NO_ERROR != (err=glGetError())) __debugbreak(); }
+#else
+#define GLCHK
+#define __debugbreak() {}
+#endif
+
+// Static function to compile an OpenGL shader, check and report errors
+static GLuint compileShader(const std::string& src, GLenum type)
+{
+    GLuint shader = glCreateShader(type);														GLCHK;
+    const GLchar* str = src.c_str();  glShaderSource(shader, 1, &str, NULL);					GLCHK;
+    glCompileShader(shader);                                                                    GLCHK;
+    GLint status; glGetShaderiv(shader, GL_COMPILE_STATUS, &status); if (GL_FALSE == status) {  GLCHK;
+        GLint sz; glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &sz);                               GLCHK;
+        std::vector<GLchar> v(sz); glGetShaderInfoLog(shader, sz, &sz, &v[0]);                  GLCHK;
+        const char* msg = &v[0];  __debugbreak();
+        glDeleteShader(shader);                                                                 GLCHK;
+        return 0;
+    }
+    return shader;
+}
+
+// Static function to compile an OpenGL shader, check and report errors
+static GLuint createProgram(std::initializer_list<GLuint> shaders)
+{
+    GLuint program = glCreateProgram();                                                         GLCHK;
+    for (auto shader : shaders) glAttachShader(program, shader);                                GLCHK;
+    glLinkProgram(program);                                                                     GLCHK;
+    GLint status; glGetProgramiv(program, GL_LINK_STATUS, &status); if (GL_FALSE == status) {   GLCHK;
+        GLint sz; glGetProgramiv(program, GL_INFO_LOG_LENGTH, &sz);                             GLCHK;
+        std::vector<GLchar> v(sz); glGetProgramInfoLog(program, sz, &sz, &v[0]);                GLCHK;
+        const char* msg = &v[0];  __debugbreak();
+        glDeleteProgram(program);                                                               GLCHK;
+        for (auto shader : shaders) glDeleteShader(shader);                                     GLCHK;
+        return 0;
+    }
+    for (auto shader : shaders) glDetachShader(program, shader);                                GLCHK;
+    return program;
+}
+
+// Static function to check for minimum OpenGL version (which is 4.3 for now0
+static void versionCheck()
+{
+    const char* s = (const char *)glGetString(GL_VERSION);
+    int v[2]; sscanf_s(s, "%d.%d", &v[0], &v[1]);
+    if (v[0] < 4 || v[1] < 3) {
+        char msg[512]; sprintf_s(msg,
+            "Error, Inadequate OpenGL Version!\n\n"
+            "This lesson requires OpenGL version 4.3 or better.\n\n"
+            "Your version is: %s\n\n"
+            "Press Ok to exit the application.", s);
+        MessageBox(NULL, msg, "Bad OpenGL Version", MB_OK | MB_ICONERROR);
+        exit(0);
+    }
+}
+
+// Static function to lay out n quads on a grid 1.5 times the size of the window in each direction
+static void createQuads(GLuint n)
+{
+    GLuint side = 1; while (side * side < n) ++side;
+    GLfloat cell = 3.f / side;
+    std::vector<GLfloat> q(n * 4);
+    for (GLuint i = 0; i < n; ++i) {
+        q[i * 4 + 0] = -1.5f + (i % side + 0.5f) * cell;
+        q[i * 4 + 1] = 1.5f - (i / side + 0.5f) * cell;
+        q[i * 4 + 2] = q[i * 4 + 3] = cell * 0.4f;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, quadBuffer);                                         GLCHK;
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, n * 4 * sizeof(GLfloat), &q[0]);               GLCHK;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);                                                  GLCHK;
+}
+
+// Static function to compile a program from the placement code and one shader, with a #define selecting its variant
+static GLuint createTestProgram(const std::string& src, GLenum type, const char* variant)
+{
+    std::string s = std::string("#version 430 core\n#define ") + variant + "\n" + placeShader + src;
+    if (GL_COMPUTE_SHADER == type) {
+        GLuint c = compileShader(s, GL_COMPUTE_SHADER);
+        GLuint p = createProgram({ c });
+        glDeleteShader(c);                                                                      GLCHK;
+        return p;
+    }
+    GLuint v = compileShader(s, GL_VERTEX_SHADER);
+    GLuint p = createProgram({ v, fShader });
+    glDeleteShader(v);                                                                          GLCHK;
+    return p;
+}
+
+// Static function to collect the GPU time of finished frames and start timing this one, if its query is free.
+// Returns whether a query was started.
+static bool beginTimer()
+{
+    for (int i = 0; i < nTimer; ++i) if (timerPending[i]) {
+        GLuint available; glGetQueryObjectuiv(timerQuery[i], GL_QUERY_RESULT_AVAILABLE, &available); GLCHK;
+        if (!available) continue;
+        GLuint64 ns; glGetQueryObjectui64v(timerQuery[i], GL_QUERY_RESULT, &ns);                GLCHK;
+        timerSum += ns; ++timerCount;
+        timerPending[i] = false;
+    }
+    int slot = timerFrame % nTimer;
+    if (timerPending[slot]) return false;
+    glBeginQuery(GL_TIME_ELAPSED, timerQuery[slot]);                                            GLCHK;
+    return true;
+}
+
+// Static function to end the query beginTimer() started
+static void endTimer()
+{
+    glEndQuery(GL_TIME_ELAPSED);                                                                GLCHK;
+    timerPending[timerFrame++ % nTimer] = true;
+}
+
+// Static function to throw away the GPU times of the frames still in flight and of the ones collected so far, so
+// a new option's first report doesn't include the previous option's frames
+static void resetTimer()
+{
+    for (int i = 0; i < nTimer; ++i) if (timerPending[i]) {
+        GLuint64 ns; glGetQueryObjectui64v(timerQuery[i], GL_QUERY_RESULT, &ns);                GLCHK;
+        timerPending[i] = false;
+    }
+    timerSum = 0; timerCount = 0;
+}
+
+// Static function to submit the test draws of the selected option
+static void drawTest()
+{
+    const struct options& o = options[selector];
+    switch (o.option) {
+    case options::INDIVIDUAL:
+        glUseProgram(drawProgram[INDIVIDUAL_PROGRAM]);                                          GLCHK;
+        glUniform1f(timeLoc[INDIVIDUAL_PROGRAM], scroll);                                       GLCHK;
+        for (GLuint i = 0; i < o.quads; ++i) {
+            glBindTexture(GL_TEXTURE_2D, drawTexture[i & 1]);                                   GLCHK;
+            glUniform1ui(drawIndexLoc, i);                                                      GLCHK;
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                              GLCHK;
+        }
+        break;
+    case options::INSTANCED:
+        glUseProgram(drawProgram[DRAWID_PROGRAM]);                                              GLCHK;
+        glUniform1f(timeLoc[DRAWID_PROGRAM], scroll);                                           GLCHK;
+        glEnableVertexAttribArray(1);                                                           GLCHK;
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, o.quads);                                GLCHK;
+        glDisableVertexAttribArray(1);                                                          GLCHK;
+        break;
+    case options::MULTIDRAW_INDIRECT:
+    case options::GPU_CULLED:
+        if (options::GPU_CULLED == o.option) {
+            glUseProgram(cullProgram);                                                          GLCHK;
+            glUniform1f(cullTimeLoc, scroll);                                                   GLCHK;
+            glUniform1ui(quadCountLoc, o.quads);                                                GLCHK;
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, cullBuffer);                          GLCHK;
+            glDispatchCompute((o.quads + 63) / 64, 1, 1);                                       GLCHK;
+            glMemoryBarrier(GL_COMMAND_BARRIER_BIT);                                            GLCHK;
+        }
+        glUseProgram(drawProgram[DRAWID_PROGRAM]);                                              GLCHK;
+        glUniform1f(timeLoc[DRAWID_PROGRAM], scroll);                                           GLCHK;
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, options::GPU_CULLED == o.option ? cullBuffer : commandBuffer); GLCHK;
+        glEnableVertexAttribArray(1);                                                           GLCHK;
+        glMultiDrawArraysIndirect(GL_TRIANGLE_STRIP, 0, o.quads, 0);                            GLCHK;
+        glDisableVertexAttribArray(1);                                                          GLCHK;
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);                                               GLCHK;
+        break;
+    }
+}
+
+// GLUT initialization function.   Initialize program state as defined in static variables.
+void init()
+{
+    versionCheck();
+
+    // turn off vsync
+    if (!wglSwapIntervalEXT(0))                                                                 __debugbreak();
+
+    // compile and link the shaders into a program, make it active
+    vShader = compileShader(vertexShader, GL_VERTEX_SHADER);
+    fShader = compileShader(fragmentShader, GL_FRAGMENT_SHADER);
+    program = createProgram({ vShader, fShader });
+    offset = glGetUniformLocation(program, "offset");                                           GLCHK;
+    texUnit = glGetUniformLocation(program, "texUnit");                                         GLCHK;
+    glUseProgram(program);                                                                      GLCHK;
+
+    // configure texture unit
+    glActiveTexture(GL_TEXTURE0);                                                               GLCHK;
+    glUniform1i(texUnit, 0);                                                                    GLCHK;
+
+    // compile the test programs, they share the fragment shader and so the texture unit
+    drawProgram[INDIVIDUAL_PROGRAM] = createTestProgram(drawVertexShader, GL_VERTEX_SHADER, "INDIVIDUAL");
+    drawProgram[DRAWID_PROGRAM] = createTestProgram(drawVertexShader, GL_VERTEX_SHADER, "DRAWID");
+    cullProgram = createTestProgram(cullShader, GL_COMPUTE_SHADER, "CULL");
+    drawIndexLoc = glGetUniformLocation(drawProgram[INDIVIDUAL_PROGRAM], "drawIndex");          GLCHK;
+    for (int i = 0; i < nPROGRAMS; ++i) {
+        timeLoc[i] = glGetUniformLocation(drawProgram[i], "time");                              GLCHK;
+        glProgramUniform1i(drawProgram[i], glGetUniformLocation(drawProgram[i], "texUnit"), 0); GLCHK;
+    }
+    cullTimeLoc = glGetUniformLocation(cullProgram, "time");                                    GLCHK;
+    quadCountLoc = glGetUniformLocation(cullProgram, "quadCount");                              GLCHK;
+
+    // the quads, sized for the largest option and bound for the whole run
+    glGenBuffers(1, &quadBuffer);                                                               GLCHK;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, quadBuffer);                                         GLCHK;
+    glBufferData(GL_SHADER_STORAGE_BUFFER, maxQuads * 4 * sizeof(GLfloat), NULL, GL_STATIC_DRAW); GLCHK;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, quadBuffer);                                  GLCHK;
+    createQuads(options[selector].quads);
+
+    // the draw index attribute, advanced once per instance
+    std::vector<GLuint> ids(maxQuads); for (GLuint i = 0; i < maxQuads; ++i) ids[i] = i;
+    glGenBuffers(1, &drawIdBuffer);                                                             GLCHK;
+    glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);                                                GLCHK;
+    glBufferData(GL_ARRAY_BUFFER, maxQuads * sizeof(GLuint), &ids[0], GL_STATIC_DRAW);          GLCHK;
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, 0, 0);                                        GLCHK;
+    glVertexAttribDivisor(1, 1);                                                                GLCHK;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);                                                           GLCHK;
+
+    // the static commands of MULTIDRAW_INDIRECT, one quad per command selected by its base instance, and the buffer
+    // the culling shader writes the commands of GPU_CULLED to
+    std::vector<DrawArraysIndirectCommand> commands(maxQuads);
+    for (GLuint i = 0; i < maxQuads; ++i) {
+        DrawArraysIndirectCommand c = { 4, 1, 0, i }; commands[i] = c;
+    }
+    glGenBuffers(1, &commandBuffer);                                                            GLCHK;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);                                       GLCHK;
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, maxQuads * sizeof(commands[0]), &commands[0], GL_STATIC_DRAW); GLCHK;
+    glGenBuffers(1, &cullBuffer);                                                               GLCHK;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, cullBuffer);                                          GLCHK;
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, maxQuads * sizeof(commands[0]), NULL, GL_DYNAMIC_COPY); GLCHK;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);                                                   GLCHK;
+
+    // create the GPU timer queries
+    glGenQueries(nTimer, timerQuery);                                                           GLCHK;
+
+    // create and configure the textures
+    glGenTextures(1, &texture);                                                                 GLCHK;
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);                               GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);                               GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);                          GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);                          GLCHK;
+
+    // load texture image
+    GLuint w, h;  std::vector<GLubyte> img; if (lodepng::decode(img, w, h, "sample.png"))    __debugbreak();
+
+    // upload the image to vram
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, &img[0]);      GLCHK;
+
+    // the two textures INDIVIDUAL alternates between, the second one mirrored so the switch is visible
+    for (GLuint y = 0; y < h; ++y) for (GLuint x = 0; x < w / 2; ++x) for (int c = 0; c < 4; ++c)
+        std::swap(img[(y * w + x) * 4 + c], img[(y * w + w - 1 - x) * 4 + c]);
+    drawTexture[0] = texture;
+    glGenTextures(1, &drawTexture[1]);                                                          GLCHK;
+    glBindTexture(GL_TEXTURE_2D, drawTexture[1]);                                               GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);                          GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);                          GLCHK;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, &img[0]);      GLCHK;
+}
+
+// Static function.  Calculates elapsed time in microseconds.
+static unsigned __int64 elapsedUS(unsigned __int64 now, unsigned __int64 start);
+
+// GLUT display function.   Draw one frame's worth of imagery.
+void display()
+{
+    // attributeless rendering
+    glClear(GL_COLOR_BUFFER_BIT);                                                               GLCHK;
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+    if (animating) {
+        glUseProgram(program);                                                                  GLCHK;
+        glUniform1f(offset, animation);                                                         GLCHK;
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                                  GLCHK;
+    } else {
+        // time the submission of the test draws on the CPU and their execution on the GPU
+        unsigned __int64 start, now;
+        bool timing = beginTimer();
+        if (!QueryPerformanceCounter((PLARGE_INTEGER)&start))                                   __debugbreak();
+        drawTest();
+        if (!QueryPerformanceCounter((PLARGE_INTEGER)&now))                                     __debugbreak();
+        if (timing) endTimer();
+        cpuUS += elapsedUS(now, start);
+        scroll += 1.f / 64.f;
+    }
+    recorder.frame();
+    glutSwapBuffers();
+}
+
+// GLUT reshape function.   Make the OpenGL viewport follow the window's size
+void reshape(int w, int h)
+{
+    // viewport follows window size
+    glViewport(0, 0, (GLsizei)w, (GLsizei)h);
+}
+
+// GLUT keyboard function.  Exit on <esc>, advance to next test item on <space>
+void keyboard(unsigned char key, int, int)
+{
+    // end on <esc> keypress
+    if (key == 27) exit(0);
+    if (key == ' ') swap = true;
+    if (key == 'c') recorder.toggle(capture::DROP);
+    if (key == 'C') recorder.toggle(capture::BLOCK);
+    if (key == 'a') recorder.toggle(capture::DROP, capture::APNG_FILE);
+    if (key == 'A') recorder.toggle(capture::BLOCK, capture::APNG_FILE);
+}
+
+// Static function to print currently selected test item's state.  Called every time the user presses <space>.
+void print()
+{
+    printf("\ntesting %s with %u quads ...\n", options[selector].optionStr, options[selector].quads);
+}
+
+// Static function.  Calculates elapsed time in microseconds.
+static unsigned __int64 elapsedUS(unsigned __int64 now, unsigned __int64 start)
+{
+    unsigned __int64 freq; if (!QueryPerformanceFrequency((PLARGE_INTEGER)&freq))                               __debugbreak();
+    unsigned __int64 elapsed = now >= start ? now - start : _UI64_MAX - start + now;
+    unsigned __int64 us = elapsed * 1000000ui64 / freq, sec = elapsed / freq;
+    return us;
+}
+
+// GLUT idle function.  Called once per video frame.  Calculate and print timing reports and handle console input.
+void idle()
+{
+    // Calculate performance
+    static unsigned __int64 skip;  if (++skip < 512) return;
+    static unsigned __int64 start; if (!start && !QueryPerformanceCounter((PLARGE_INTEGER)&start))              __debugbreak();
+    unsigned __int64 now;  if (!QueryPerformanceCounter((PLARGE_INTEGER)&now))                                  __debugbreak();
+    unsigned __int64 us = elapsedUS(now, start), sec = us / 1000000;
+    static unsigned __int64 animationStart;
+    static unsigned __int64 cnt; ++cnt;
+
+    // We're either animating
+    if (animating)
+    {
+        float sec = elapsedUS(now, animationStart) / 1000000.f; if (sec < 1.f) {
+            animation = (sec < 0.5f ? sec : 1.f - sec) / 0.5f;
+        }
+        else {
+            animating = false;
+            selector = (selector + 1) % _countof(options);
+            createQuads(options[selector].quads);
+            skip = 0; cpuUS = 0; resetTimer();
+            cnt = start = 0;
+            print();
+        }
+    }
+
+    // Or measuring
+    else if (sec >= 2)
+    {
+        printf("frames rendered = %I64u, uS = %I64u, fps = %f,  milliseconds-per-frame = %f\n", cnt, us, cnt * 1000000. / us, us / (cnt * 1000.));
+        printf("CPU submission = %f microseconds per frame, %f microseconds per quad\n",
+            cpuUS / (double)cnt, cpuUS / ((double)cnt * options[selector].quads));
+        if (timerCount) {
+            printf("GPU time = %f milliseconds per frame\n", timerSum / (timerCount * 1000000.));
+        }
+        cpuUS = 0; timerSum = 0; timerCount = 0;
+        if (swap) {
+            animating = true; animationStart = now; swap = false;
+        } else {
+            cnt = start = 0;
+        }
+    }
+
+    // Get input from the console too.
+    HANDLE h = GetStdHandle(STD_INPUT_HANDLE); INPUT_RECORD r[128]; DWORD n;
+    if (PeekConsoleInput(h, r, 128, &n) && n)
+        if (ReadConsoleInput(h, r, n, &n))
+            for (DWORD i = 0; i < n; ++i)
+                if (r[i].EventType == KEY_EVENT && r[i].Event.KeyEvent.bKeyDown)
+                    keyboard(r[i].Event.KeyEvent.uChar.AsciiChar, 0, 0);
+
+    // Ask for another frame
+    glutPostRedisplay();
+}
+
+// Main function, program entry.  Configure, initialize then run application.  Catch and report all unexpected errors
+int main(int argc, char** argv)
+{
+    __try {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
+        glutInitWindowSize(640, 480);
+        glutInitWindowPosition(0, 480);
+        glutCreateWindow(argv[0]);
+        GLenum err = glewInit(); if (GLEW_OK != err)                                                        __debugbreak();
+        init();
+        glutDisplayFunc(display);
+        glutReshapeFunc(reshape);
+        glutKeyboardFunc(keyboard);
+        glutIdleFunc(idle);
+        SetWindowPos(GetConsoleWindow(), NULL, 0, 0, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
+        printf("OpenGL vendor string: %s\n", glGetString(GL_VENDOR));
+        printf("OpenGL renderer string: %s\n", glGetString(GL_RENDERER));
+        printf("OpenGL version string: %s\n\n", glGetString(GL_VERSION));
+        puts("This lesson compares the CPU and GPU cost of drawing many quads with individual draws, instancing, multi-draw indirect and GPU culling.");
+        puts("Press <c> to start or stop capturing frames to PNG files, <C> to capture without dropping frames.");
+        puts("Press <a> to start or stop capturing an animated PNG of the frames, <A> to capture it without dropping frames.");
+        puts("Press <esc> to exit; <space bar> to switch between states ...\n");
+        print();
+        glutMainLoop();
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER) {
+        MessageBox(NULL,
+            "Unhandled Exception!\n\n"
+            "An unknown error occurred.\n\n"
+            "Press OK to exit.", "Unknown Error", MB_OK | MB_ICONERROR);
+    }
+    return 0;
+}
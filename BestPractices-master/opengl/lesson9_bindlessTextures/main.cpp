@@ -0,0 +1,574 @@
+//"Copyright 2016 Intel Corporation.
+//
+//The source code, information and material("Material") contained herein is owned by Intel Corporation or its suppliers or licensors, and title to such Material 
+//remains with Intel Corporation or its suppliers or licensors.The Material contains proprietary information of Intel or its suppliers and licensors.
+//The Material is protected by worldwide copyright laws and treaty provisions.
+//No part of the Material may be used, copied, reproduced, modified, published, uploaded, posted, transmitted,distributed or disclosed in any way without Intel's prior express written permission. 
+//No license under any patent, copyright or other intellectual property rights in the Material is granted to or conferred upon you, either expressly, by implication, inducement, estoppel or otherwise. Any license under such intellectual property rights must be express and approved by Intel in writing.
+//Unless otherwise agreed by Intel in writing, you may not remove or alter this notice or any other notice embedded in 
+//Materials by Intel or Intel's suppliers or licensors in any way."
+
+
+#include <GL/glew.h>
+#include <GL/wglew.h>
+#include <GL/glut.h>
+#include <lodepng.h>
+#include <capture.h>
+
+#include <vector>
+
+#include <string>
+
+#include <intrin.h>
+
+// This example uses attribute-less rendering
+
+// Vertex shader specifies vertex position in clip space
+static std::string vertexShader =
+"#version 430 core\n"
+"\n"
+"const vec2 Position[4] = vec2[]\n"
+"(\n"
+"    vec2(-1,  1),\n"
+"    vec2(-1, -1),\n"
+"    vec2( 1,  1),\n"
+"    vec2( 1, -1) \n"
+");"
+"\n"
+"uniform float offset;\n"
+"\n"
+"smooth out vec2 texcoord;\n"
+"\n"
+"void main()\n"
+"{\n"
+"    vec2 pos = Position[ gl_VertexID ];\n"
+"    pos.x += offset * -sign(pos.x);\n"
+"    gl_Position = vec4(pos * 0.5, 0.0, 1.0);\n"
+"    texcoord = pos * vec2(0.5, -0.5) + 0.5;\n"
+"}\n"
+;
+
+// Fragment shader gets output color from a texture
+static std::string fragmentShader =
+    "#version 430 core\n"
+    "\n"
+    "uniform sampler2D texUnit;\n"
+    "\n"
+    "smooth in vec2 texcoord;\n"
+    "\n"
+    "layout(location = 0) out vec4 fragColor;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    fragColor = texture(texUnit, texcoord);\n"
+    "}\n"
+;
+
+// Vertex shader for the test draws, places quad drawIndex of a square grid of quadCount quads
+static std::string drawVertexShader =
+"#version 430 core\n"
+"\n"
+"const vec2 Position[4] = vec2[]\n"
+"(\n"
+"    vec2(-1,  1),\n"
+"    vec2(-1, -1),\n"
+"    vec2( 1,  1),\n"
+"    vec2( 1, -1) \n"
+");"
+"\n"
+"uniform uint drawIndex;\n"
+"uniform uint quadCount;\n"
+"\n"
+"smooth out vec2 texcoord;\n"
+"\n"
+"void main()\n"
+"{\n"
+"    uint side = uint(ceil(sqrt(float(quadCount))));\n"
+"    float cell = 2.0 / float(side);\n"
+"    vec2 center = vec2(-1.0, 1.0) + (vec2(drawIndex % side, -float(drawIndex / side)) + vec2(0.5, -0.5)) * cell;\n"
+"    vec2 pos = Position[ gl_VertexID ];\n"
+"    gl_Position = vec4(pos * cell * 0.45 + center, 0.0, 1.0);\n"
+"    texcoord = pos * vec2(0.5, -0.5) + 0.5;\n"
+"}\n"
+;
+
+// Fragment shader for the test draws, compiled three ways: BIND samples the texture bound to the unit, ARRAY samples
+// the draw's material layer of a texture array, BINDLESS samples through the material's handle read from a buffer.
+static std::string drawFragmentShader =
+"\n"
+"#if defined(BINDLESS)\n"
+"#extension GL_ARB_bindless_texture : require\n"
+"layout(std430, binding = 0) readonly buffer materials\n"
+"{\n"
+"    uvec2 handle[];\n"
+"};\n"
+"#elif defined(ARRAY)\n"
+"uniform sampler2DArray texUnit;\n"
+"#else\n"
+"uniform sampler2D texUnit;\n"
+"#endif\n"
+"\n"
+"uniform uint drawIndex;\n"
+"uniform uint materialCount;\n"
+"\n"
+"smooth in vec2 texcoord;\n"
+"\n"
+"layout(location = 0) out vec4 fragColor;\n"
+"\n"
+"void main()\n"
+"{\n"
+"    uint material = drawIndex % materialCount;\n"
+"#if defined(BINDLESS)\n"
+"    fragColor = texture(sampler2D(handle[material]), texcoord);\n"
+"#elif defined(ARRAY)\n"
+"    fragColor = texture(texUnit, vec3(texcoord, float(material)));\n"
+"#else\n"
+"    fragColor = texture(texUnit, texcoord);\n"
+"#endif\n"
+"}\n"
+;
+
+// Static variables, program state
+static GLenum err;
+static GLuint vShader;
+static GLuint fShader;
+static GLuint program;
+static GLuint texture;
+static GLint offset, texUnit;
+static GLfloat animation;
+static unsigned selector;
+static bool swap, animating;
+static capture::Recorder recorder("lesson9");
+
+// Test state: every material is a different crop of the sample image, stored both as its own texture, which BIND binds
+// and BINDLESS takes a handle of, and as a layer of the texture array ARRAY uses.
+#define nMaterials 64
+#define materialSize 128
+enum { BIND_PROGRAM, ARRAY_PROGRAM, BINDLESS_PROGRAM, nPROGRAMS };
+static GLuint drawProgram[nPROGRAMS];
+static GLint drawIndexLoc[nPROGRAMS], quadCountLoc[nPROGRAMS];
+static GLuint materialTexture[nMaterials], materialArray, handleBuffer;
+static bool bindless;
+static unsigned __int64 cpuUS;
+
+// GPU time of the test draws, measured with a ring of time elapsed queries that are polled so measuring never stalls
+#define nTimer 8
+static GLuint timerQuery[nTimer];
+static bool timerPending[nTimer];
+static unsigned timerFrame, timerCount;
+static GLuint64 timerSum;
+
+// Array of structures, one item for each option we're testing
+#define I(x, n) { options:: ## x, #x, n }
+struct options {
+    enum  { BIND, ARRAY, BINDLESS, nOPTS } option;
+    const char* optionStr;
+    GLuint quads;
+} options[]
+{
+    I(BIND, 1024),
+        I(ARRAY, 1024),
+        I(BINDLESS, 1024),
+        I(BIND, 16384),
+        I(ARRAY, 16384),
+        I(BINDLESS, 16384),
+};
+
+// Debug build performs OpenGL error checking, Release does not
+#ifdef _DEBUG
+#define GLCHK { if (GL_NO_ERROR != (err=glGetError())) __debugbreak(); }
+#else
+#define GLCHK
+#define __debugbreak() {}
+#endif
+
+// Static function to compile an OpenGL shader, check and report errors
+static GLuint compileShader(const std::string& src, GLenum type)
+{
+    GLuint shader = glCreateShader(type);														GLCHK;
+    const GLchar* str = src.c_str();  glShaderSource(shader, 1, &str, NULL);					GLCHK;
+    glCompileShader(shader);                                                                    GLCHK;
+    GLint status; glGetShaderiv(shader, GL_COMPILE_STATUS, &status); if (GL_FALSE == status) {  GLCHK;
+        GLint sz; glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &sz);                               GLCHK;
+        std::vector<GLchar> v(sz); glGetShaderInfoLog(shader, sz, &sz, &v[0]);                  GLCHK;
+        const char* msg = &v[0];  __debugbreak();
+        glDeleteShader(shader);                                                                 GLCHK;
+        return 0;
+    }
+    return shader;
+}
+
+// Static function to compile an OpenGL shader, check and report errors
+static GLuint createProgram(std::initializer_list<GLuint> shaders)
+{
+    GLuint program = glCreateProgram();                                                         GLCHK;
+    for (auto shader : shaders) glAttachShader(program, shader);                                GLCHK;
+    glLinkProgram(program);                                                                     GLCHK;
+    GLint status; glGetProgramiv(program, GL_LINK_STATUS, &status); if (GL_FALSE == status) {   GLCHK;
+        GLint sz; glGetProgramiv(program, GL_INFO_LOG_LENGTH, &sz);                             GLCHK;
+        std::vector<GLchar> v(sz); glGetProgramInfoLog(program, sz, &sz, &v[0]);                GLCHK;
+        const char* msg = &v[0];  __debugbreak();
+        glDeleteProgram(program);                                                               GLCHK;
+        for (auto shader : shaders) glDeleteShader(shader);                                     GLCHK;
+        return 0;
+    }
+    for (auto shader : shaders) glDetachShader(program, shader);                                GLCHK;
+    return program;
+}
+
+// Static function to check for minimum OpenGL version (which is 4.3 for now0
+static void versionCheck()
+{
+    const char* s = (const char *)glGetString(GL_VERSION);
+    int v[2]; sscanf_s(s, "%d.%d", &v[0], &v[1]);
+    if (v[0] < 4 || v[1] < 3) {
+        char msg[512]; sprintf_s(msg,
+            "Error, Inadequate OpenGL Version!\n\n"
+            "This lesson requires OpenGL version 4.3 or better.\n\n"
+            "Your version is: %s\n\n"
+            "Press Ok to exit the application.", s);
+        MessageBox(NULL, msg, "Bad OpenGL Version", MB_OK | MB_ICONERROR);
+        exit(0);
+    }
+}
+
+// Static function to check whether the implementation supports an option, BINDLESS needs ARB_bindless_texture
+static bool supported(const struct options& o)
+{
+    return o.option != options::BINDLESS || bindless;
+}
+
+// Static function to compile one variant of the draw program
+static GLuint createDrawProgram(const char* variant)
+{
+    std::string src = std::string("#version 430 core\n#define ") + variant + "\n" + drawFragmentShader;
+    GLuint v = compileShader(drawVertexShader, GL_VERTEX_SHADER);
+    GLuint f = compileShader(src, GL_FRAGMENT_SHADER);
+    GLuint p = createProgram({ v, f });
+    glDeleteShader(v);                                                                          GLCHK;
+    glDeleteShader(f);                                                                          GLCHK;
+    return p;
+}
+
+// Static function to set the texture parameters of the materials
+static void materialParameters(GLenum target)
+{
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);                               GLCHK;
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);                               GLCHK;
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);                                  GLCHK;
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);                                  GLCHK;
+}
+
+// Static function to create the materials from the sample image, crops on an 8 x 8 grid across it
+static void createMaterials(const std::vector<GLubyte>& img, GLuint w, GLuint h)
+{
+    glGenTextures(nMaterials, materialTexture);                                                 GLCHK;
+    glGenTextures(1, &materialArray);                                                           GLCHK;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, materialArray);                                          GLCHK;
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, materialSize, materialSize, nMaterials);   GLCHK;
+    materialParameters(GL_TEXTURE_2D_ARRAY);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, w);                                                     GLCHK;
+    for (GLuint m = 0; m < nMaterials; ++m) {
+        const GLubyte* crop = &img[((m / 8) * (h - materialSize) / 7 * w + (m % 8) * (w - materialSize) / 7) * 4];
+        glBindTexture(GL_TEXTURE_2D, materialTexture[m]);                                       GLCHK;
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, materialSize, materialSize);                 GLCHK;
+        materialParameters(GL_TEXTURE_2D);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, materialSize, materialSize, GL_RGBA, GL_UNSIGNED_BYTE, crop); GLCHK;
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, m, materialSize, materialSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, crop); GLCHK;
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);                                                     GLCHK;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);                                                      GLCHK;
+
+    // bindless handles of the material textures, made resident for the whole run.   A texture's parameters can't
+    // change once it has a handle, which is why they are all set above.
+    if (!bindless) return;
+    GLuint64 handles[nMaterials];
+    for (GLuint m = 0; m < nMaterials; ++m) {
+        handles[m] = glGetTextureHandleARB(materialTexture[m]);                                 GLCHK;
+        glMakeTextureHandleResidentARB(handles[m]);                                             GLCHK;
+    }
+    glGenBuffers(1, &handleBuffer);                                                             GLCHK;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, handleBuffer);                                       GLCHK;
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(handles), handles, GL_STATIC_DRAW);           GLCHK;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);                                                  GLCHK;
+}
+
+// Static function to collect the GPU time of finished frames and start timing this one, if its query is free.
+// Returns whether a query was started.
+static bool beginTimer()
+{
+    for (int i = 0; i < nTimer; ++i) if (timerPending[i]) {
+        GLuint available; glGetQueryObjectuiv(timerQuery[i], GL_QUERY_RESULT_AVAILABLE, &available); GLCHK;
+        if (!available) continue;
+        GLuint64 ns; glGetQueryObjectui64v(timerQuery[i], GL_QUERY_RESULT, &ns);                GLCHK;
+        timerSum += ns; ++timerCount;
+        timerPending[i] = false;
+    }
+    int slot = timerFrame % nTimer;
+    if (timerPending[slot]) return false;
+    glBeginQuery(GL_TIME_ELAPSED, timerQuery[slot]);                                            GLCHK;
+    return true;
+}
+
+// Static function to end the query beginTimer() started
+static void endTimer()
+{
+    glEndQuery(GL_TIME_ELAPSED);                                                                GLCHK;
+    timerPending[timerFrame++ % nTimer] = true;
+}
+
+// Static function to throw away the GPU times of the frames still in flight and of the ones collected so far, so
+// a new option's first report doesn't include the previous option's frames
+static void resetTimer()
+{
+    for (int i = 0; i < nTimer; ++i) if (timerPending[i]) {
+        GLuint64 ns; glGetQueryObjectui64v(timerQuery[i], GL_QUERY_RESULT, &ns);                GLCHK;
+        timerPending[i] = false;
+    }
+    timerSum = 0; timerCount = 0;
+}
+
+// Static function to submit the test draws of the selected option.   Every option issues one draw per quad, they only
+// differ in how the quad's material is selected.
+static void drawTest()
+{
+    const struct options& o = options[selector];
+    GLuint p = options::BIND == o.option ? BIND_PROGRAM : options::ARRAY == o.option ? ARRAY_PROGRAM : BINDLESS_PROGRAM;
+    glUseProgram(drawProgram[p]);                                                               GLCHK;
+    glUniform1ui(quadCountLoc[p], o.quads);                                                     GLCHK;
+    switch (o.option) {
+    case options::BIND:
+        for (GLuint i = 0; i < o.quads; ++i) {
+            glBindTexture(GL_TEXTURE_2D, materialTexture[i % nMaterials]);                      GLCHK;
+            glUniform1ui(drawIndexLoc[p], i);                                                   GLCHK;
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                              GLCHK;
+        }
+        break;
+    case options::ARRAY:
+        glBindTexture(GL_TEXTURE_2D_ARRAY, materialArray);                                      GLCHK;
+        for (GLuint i = 0; i < o.quads; ++i) {
+            glUniform1ui(drawIndexLoc[p], i);                                                   GLCHK;
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                              GLCHK;
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);                                                  GLCHK;
+        break;
+    case options::BINDLESS:
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, handleBuffer);                            GLCHK;
+        for (GLuint i = 0; i < o.quads; ++i) {
+            glUniform1ui(drawIndexLoc[p], i);                                                   GLCHK;
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                              GLCHK;
+        }
+        break;
+    }
+}
+
+// GLUT initialization function.   Initialize program state as defined in static variables.
+void init()
+{
+    versionCheck();
+
+    // turn off vsync
+    if (!wglSwapIntervalEXT(0))                                                                 __debugbreak();
+
+    // compile and link the shaders into a program, make it active
+    vShader = compileShader(vertexShader, GL_VERTEX_SHADER);
+    fShader = compileShader(fragmentShader, GL_FRAGMENT_SHADER);
+    program = createProgram({ vShader, fShader });
+    offset = glGetUniformLocation(program, "offset");                                           GLCHK;
+    texUnit = glGetUniformLocation(program, "texUnit");                                         GLCHK;
+    glUseProgram(program);                                                                      GLCHK;
+
+    // configure texture unit
+    glActiveTexture(GL_TEXTURE0);                                                               GLCHK;
+    glUniform1i(texUnit, 0);                                                                    GLCHK;
+
+    // compile the test programs, the bindless one only if the extension is there
+    bindless = GLEW_ARB_bindless_texture != 0;
+    drawProgram[BIND_PROGRAM] = createDrawProgram("BIND");
+    drawProgram[ARRAY_PROGRAM] = createDrawProgram("ARRAY");
+    if (bindless) drawProgram[BINDLESS_PROGRAM] = createDrawProgram("BINDLESS");
+    for (int i = 0; i < nPROGRAMS; ++i) if (drawProgram[i]) {
+        drawIndexLoc[i] = glGetUniformLocation(drawProgram[i], "drawIndex");                    GLCHK;
+        quadCountLoc[i] = glGetUniformLocation(drawProgram[i], "quadCount");                    GLCHK;
+        glProgramUniform1ui(drawProgram[i], glGetUniformLocation(drawProgram[i], "materialCount"), nMaterials); GLCHK;
+        if (BINDLESS_PROGRAM != i) {
+            glProgramUniform1i(drawProgram[i], glGetUniformLocation(drawProgram[i], "texUnit"), 0); GLCHK;
+        }
+    }
+
+    // create the GPU timer queries
+    glGenQueries(nTimer, timerQuery);                                                           GLCHK;
+
+    // create and configure the textures
+    glGenTextures(1, &texture);                                                                 GLCHK;
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);                               GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);                               GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);                          GLCHK;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);                          GLCHK;
+
+    // load texture image
+    GLuint w, h;  std::vector<GLubyte> img; if (lodepng::decode(img, w, h, "sample.png"))    __debugbreak();
+
+    // upload the image to vram
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, &img[0]);      GLCHK;
+
+    // the materials are cut from the same image
+    createMaterials(img, w, h);
+}
+
+// Static function.  Calculates elapsed time in microseconds.
+static unsigned __int64 elapsedUS(unsigned __int64 now, unsigned __int64 start);
+
+// GLUT display function.   Draw one frame's worth of imagery.
+void display()
+{
+    // attributeless rendering
+    glClear(GL_COLOR_BUFFER_BIT);                                                               GLCHK;
+    glBindTexture(GL_TEXTURE_2D, texture);                                                      GLCHK;
+    if (animating) {
+        glUseProgram(program);                                                                  GLCHK;
+        glUniform1f(offset, animation);                                                         GLCHK;
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);                                                  GLCHK;
+    } else {
+        // time the submission of the test draws on the CPU and their execution on the GPU
+        unsigned __int64 start, now;
+        bool timing = beginTimer();
+        if (!QueryPerformanceCounter((PLARGE_INTEGER)&start))                                   __debugbreak();
+        drawTest();
+        if (!QueryPerformanceCounter((PLARGE_INTEGER)&now))                                     __debugbreak();
+        if (timing) endTimer();
+        cpuUS += elapsedUS(now, start);
+        glBindTexture(GL_TEXTURE_2D, texture);                                                  GLCHK;
+    }
+    recorder.frame();
+    glutSwapBuffers();
+}
+
+// GLUT reshape function.   Make the OpenGL viewport follow the window's size
+void reshape(int w, int h)
+{
+    // viewport follows window size
+    glViewport(0, 0, (GLsizei)w, (GLsizei)h);
+}
+
+// GLUT keyboard function.  Exit on <esc>, advance to next test item on <space>
+void keyboard(unsigned char key, int, int)
+{
+    // end on <esc> keypress
+    if (key == 27) exit(0);
+    if (key == ' ') swap = true;
+    if (key == 'c') recorder.toggle(capture::DROP);
+    if (key == 'C') recorder.toggle(capture::BLOCK);
+    if (key == 'a') recorder.toggle(capture::DROP, capture::APNG_FILE);
+    if (key == 'A') recorder.toggle(capture::BLOCK, capture::APNG_FILE);
+}
+
+// Static function to print currently selected test item's state.  Called every time the user presses <space>.
+void print()
+{
+    printf("\ntesting %s with %u draws and %u materials ...\n", options[selector].optionStr, options[selector].quads, nMaterials);
+}
+
+// Static function.  Calculates elapsed time in microseconds.
+static unsigned __int64 elapsedUS(unsigned __int64 now, unsigned __int64 start)
+{
+    unsigned __int64 freq; if (!QueryPerformanceFrequency((PLARGE_INTEGER)&freq))                               __debugbreak();
+    unsigned __int64 elapsed = now >= start ? now - start : _UI64_MAX - start + now;
+    unsigned __int64 us = elapsed * 1000000ui64 / freq, sec = elapsed / freq;
+    return us;
+}
+
+// GLUT idle function.  Called once per video frame.  Calculate and print timing reports and handle console input.
+void idle()
+{
+    // Calculate performance
+    static unsigned __int64 skip;  if (++skip < 512) return;
+    static unsigned __int64 start; if (!start && !QueryPerformanceCounter((PLARGE_INTEGER)&start))              __debugbreak();
+    unsigned __int64 now;  if (!QueryPerformanceCounter((PLARGE_INTEGER)&now))                                  __debugbreak();
+    unsigned __int64 us = elapsedUS(now, start), sec = us / 1000000;
+    static unsigned __int64 animationStart;
+    static unsigned __int64 cnt; ++cnt;
+
+    // We're either animating
+    if (animating)
+    {
+        float sec = elapsedUS(now, animationStart) / 1000000.f; if (sec < 1.f) {
+            animation = (sec < 0.5f ? sec : 1.f - sec) / 0.5f;
+        }
+        else {
+            animating = false;
+            do {
+                selector = (selector + 1) % _countof(options);
+            } while (!supported(options[selector]));
+            skip = 0; cpuUS = 0; resetTimer();
+            cnt = start = 0;
+            print();
+        }
+    }
+
+    // Or measuring
+    else if (sec >= 2)
+    {
+        printf("frames rendered = %I64u, uS = %I64u, fps = %f,  milliseconds-per-frame = %f\n", cnt, us, cnt * 1000000. / us, us / (cnt * 1000.));
+        printf("CPU submission = %f microseconds per frame, %f microseconds per draw\n",
+            cpuUS / (double)cnt, cpuUS / ((double)cnt * options[selector].quads));
+        if (timerCount) {
+            printf("GPU time = %f milliseconds per frame\n", timerSum / (timerCount * 1000000.));
+        }
+        cpuUS = 0; timerSum = 0; timerCount = 0;
+        if (swap) {
+            animating = true; animationStart = now; swap = false;
+        } else {
+            cnt = start = 0;
+        }
+    }
+
+    // Get input from the console too.
+    HANDLE h = GetStdHandle(STD_INPUT_HANDLE); INPUT_RECORD r[128]; DWORD n;
+    if (PeekConsoleInput(h, r, 128, &n) && n)
+        if (ReadConsoleInput(h, r, n, &n))
+            for (DWORD i = 0; i < n; ++i)
+                if (r[i].EventType == KEY_EVENT && r[i].Event.KeyEvent.bKeyDown)
+                    keyboard(r[i].Event.KeyEvent.uChar.AsciiChar, 0, 0);
+
+    // Ask for another frame
+    glutPostRedisplay();
+}
+
+// Main function, program entry.  Configure, initialize then run application.  Catch and report all unexpected errors
+int main(int argc, char** argv)
+{
+    __try {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
+        glutInitWindowSize(640, 480);
+        glutInitWindowPosition(0, 480);
+        glutCreateWindow(argv[0]);
+        GLenum err = glewInit(); if (GLEW_OK != err)                                                        __debugbreak();
+        init();
+        glutDisplayFunc(display);
+        glutReshapeFunc(reshape);
+        glutKeyboardFunc(keyboard);
+        glutIdleFunc(idle);
+        SetWindowPos(GetConsoleWindow(), NULL, 0, 0, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
+        printf("OpenGL vendor string: %s\n", glGetString(GL_VENDOR));
+        printf("OpenGL renderer string: %s\n", glGetString(GL_RENDERER));
+        printf("OpenGL version string: %s\n\n", glGetString(GL_VERSION));
+        puts("This lesson compares the cost of switching between many textures with glBindTexture, a texture array and bindless textures.");
+        puts("Press <c> to start or stop capturing frames to PNG files, <C> to capture without dropping frames.");
+        puts("Press <a> to start or stop capturing an animated PNG of the frames, <A> to capture it without dropping frames.");
+        puts("Press <esc> to exit; <space bar> to switch between states ...\n");
+        if (!bindless) puts("GL_ARB_bindless_texture is not supported, skipping BINDLESS.\n");
+        print();
+        glutMainLoop();
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER) {
+        MessageBox(NULL,
+            "Unhandled Exception!\n\n"
+            "An unknown error occurred.\n\n"
+            "Press OK to exit.", "Unknown Error", MB_OK | MB_ICONERROR);
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+//"Copyright 2016 Intel Corporation.
+//
+//The source code, information and material("Material") contained herein is owned by Intel Corporation or its suppliers or licensors, and title to such Material 
+//remains with Intel Corporation or its suppliers or licensors.The Material contains proprietary information of Intel or its suppliers and licensors.
+//The Material is protected by worldwide copyright laws and treaty provisions.
+//No part of the Material may be used, copied, reproduced, modified, published, uploaded, posted, transmitted,distributed or disclosed in any way without Intel's prior express written permission. 
+//No license under any patent, copyright or other intellectual property rights in the Material is granted to or conferred upon you, either expressly, by implication, inducement, estoppel or otherwise. Any license under such intellectual property rights must be express and approved by Intel in writing.
+//Unless otherwise agreed by Intel in writing, you may not remove or alter this notice or any other notice embedded in 
+//Materials by Intel or Intel's suppliers or licensors in any way."
+
+
+
+
+
+// png2ktx: converts a PNG into a GPU-ready KTX 2.0 file with a full mip chain, so the lessons can upload it straight
+// from a memory mapping instead of decoding, converting and mip-mapping at every launch.
+//
+// usage: png2ktx [-zlib] [-srgb] [-nomips] input.png output.ktx2
+
+#include <lodepng.h>
+#include <lodepng_util.h>
+#include <ktx2.h>
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+// Static function to print the chunk layout and IDAT compression statistics of the source PNG
+static void describe(const std::vector<unsigned char>& png)
+{
+    std::vector<std::string> names; std::vector<size_t> sizes;
+    if (lodepng::getChunkInfo(names, sizes, png)) return;
+    printf("chunks:");
+    for (size_t i = 0; i < names.size(); ++i) printf(" %s(%u)", names[i].c_str(), (unsigned)sizes[i]);
+    printf("\n");
+
+    std::vector<lodepng::ZlibBlockInfo> zlibinfo;
+    lodepng::extractZlibInfo(zlibinfo, png);
+    size_t compressed = 0, uncompressed = 0, btype[3] = {};
+    for (size_t i = 0; i < zlibinfo.size(); ++i) {
+        compressed += zlibinfo[i].compressedbits / 8;
+        uncompressed += zlibinfo[i].uncompressedbytes;
+        if (zlibinfo[i].btype >= 0 && zlibinfo[i].btype < 3) ++btype[zlibinfo[i].btype];
+    }
+    printf("zlib: %u blocks (stored %u, fixed %u, dynamic %u), %u -> %u bytes\n", (unsigned)zlibinfo.size(),
+        (unsigned)btype[0], (unsigned)btype[1], (unsigned)btype[2], (unsigned)compressed, (unsigned)uncompressed);
+}
+
+// Static functions to convert an 8-bit sRGB encoded value to linear light and back
+static float toLinear(unsigned char v)
+{
+    static float table[256];
+    static bool init = false;
+    if (!init) {
+        for (int i = 0; i < 256; ++i) {
+            float c = i / 255.f;
+            table[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        }
+        init = true;
+    }
+    return table[v];
+}
+
+static unsigned char toSRGB(float linear)
+{
+    float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1 / 2.4f) - 0.055f;
+    return (unsigned char)(c <= 0.f ? 0 : c >= 1.f ? 255 : c * 255.f + 0.5f);
+}
+
+// Static function to build the next mip level with a 2x2 box filter.   Odd sizes repeat the last row/column.
+// sRGB color is averaged in linear light, averaging the encoded values would darken every level; alpha is linear.
+static std::vector<unsigned char> downsample(const std::vector<unsigned char>& src, unsigned w, unsigned h, bool srgb)
+{
+    unsigned dw = w > 1 ? w / 2 : 1, dh = h > 1 ? h / 2 : 1;
+    std::vector<unsigned char> dst(dw * dh * 4);
+    for (unsigned y = 0; y < dh; ++y) {
+        unsigned y0 = y * 2 < h ? y * 2 : h - 1, y1 = y * 2 + 1 < h ? y * 2 + 1 : h - 1;
+        for (unsigned x = 0; x < dw; ++x) {
+            unsigned x0 = x * 2 < w ? x * 2 : w - 1, x1 = x * 2 + 1 < w ? x * 2 + 1 : w - 1;
+            for (unsigned c = 0; c < 4; ++c) {
+                if (srgb && c < 3) {
+                    float sum = toLinear(src[(y0 * w + x0) * 4 + c]) + toLinear(src[(y0 * w + x1) * 4 + c]) +
+                                toLinear(src[(y1 * w + x0) * 4 + c]) + toLinear(src[(y1 * w + x1) * 4 + c]);
+                    dst[(y * dw + x) * 4 + c] = toSRGB(sum / 4);
+                    continue;
+                }
+                unsigned sum = src[(y0 * w + x0) * 4 + c] + src[(y0 * w + x1) * 4 + c] +
+                               src[(y1 * w + x0) * 4 + c] + src[(y1 * w + x1) * 4 + c];
+                dst[(y * dw + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+// Main function, program entry.
+int main(int argc, char** argv)
+{
+    bool zlib = false, srgb = false, mips = true;
+    const char* files[2] = {}; int nFiles = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-zlib"))        zlib = true;
+        else if (!strcmp(argv[i], "-srgb"))   srgb = true;
+        else if (!strcmp(argv[i], "-nomips")) mips = false;
+        else if (nFiles < 2)                  files[nFiles++] = argv[i];
+    }
+    if (nFiles != 2) {
+        puts("usage: png2ktx [-zlib] [-srgb] [-nomips] input.png output.ktx2");
+        return 1;
+    }
+
+    // load and describe the source
+    std::vector<unsigned char> png;
+    if (lodepng::load_file(png, files[0]) || png.empty()) {
+        printf("error: cannot read %s\n", files[0]);
+        return 1;
+    }
+    describe(png);
+
+    // decode to RGBA8 and build the mip chain
+    ktx2::Texture tex; tex.vkFormat = srgb ? ktx2::R8G8B8A8_SRGB : ktx2::R8G8B8A8_UNORM;
+    tex.levels.resize(1);
+    if (unsigned error = lodepng::decode(tex.levels[0], tex.width, tex.height, png)) {
+        printf("error %u: %s\n", error, lodepng_error_text(error));
+        return 1;
+    }
+    for (unsigned w = tex.width, h = tex.height; mips && (w > 1 || h > 1); w = w > 1 ? w / 2 : 1, h = h > 1 ? h / 2 : 1)
+        tex.levels.push_back(downsample(tex.levels.back(), w, h, srgb));
+    tex.keyValues.push_back(std::make_pair(std::string("KTXwriter"), std::string("png2ktx")));
+
+    // write the container
+    if (unsigned error = ktx2::save(files[1], tex, zlib ? ktx2::ZLIB : ktx2::NONE)) {
+        printf("error %u: cannot write %s\n", error, files[1]);
+        return 1;
+    }
+    size_t raw = 0; for (size_t i = 0; i < tex.levels.size(); ++i) raw += tex.levels[i].size();
+    printf("%s: %ux%u, %u levels, %u bytes of texels%s\n", files[1], tex.width, tex.height,
+        (unsigned)tex.levels.size(), (unsigned)raw, zlib ? ", zlib supercompressed" : "");
+    return 0;
+}
@@ -0,0 +1,429 @@
+//"Copyright 2016 Intel Corporation.
+//
+//The source code, information and material("Material") contained herein is owned by Intel Corporation or its suppliers or licensors, and title to such Material 
+//remains with Intel Corporation or its suppliers or licensors.The Material contains proprietary information of Intel or its suppliers and licensors.
+//The Material is protected by worldwide copyright laws and treaty provisions.
+//No part of the Material may be used, copied, reproduced, modified, published, uploaded, posted, transmitted,distributed or disclosed in any way without Intel's prior express written permission. 
+//No license under any patent, copyright or other intellectual property rights in the Material is granted to or conferred upon you, either expressly, by implication, inducement, estoppel or otherwise. Any license under such intellectual property rights must be express and approved by Intel in writing.
+//Unless otherwise agreed by Intel in writing, you may not remove or alter this notice or any other notice embedded in 
+//Materials by Intel or Intel's suppliers or licensors in any way."
+
+
+
+
+
+// pngoptimize: losslessly recompresses PNG files with the smallest combination of LodePNG encoder settings it finds.
+// The combinations of color model, filter strategy and deflate settings of a file run as separate jobs on one thread
+// pool, so several files are worked on at once.   A job gives up as soon as its compressed data reaches the size of
+// the best result so far, and a file stops trying new combinations when its time budget runs out.
+//
+// usage: pngoptimize [-j threads] [-t seconds] [-o directory] [-q colors [-d]] input.png|directory ...
+//
+// Without -o, a file is only replaced when the result is smaller.   Like lodepng's example_optimize_png, the result
+// keeps the pixels and drops the other chunks.   -q makes it lossy: the image is first quantized to a palette of at
+// most that many colors with lodepng_util's quantizer, dithered with -d, and the search starts from those pixels.
+// Lossy results never replace the inputs, so -q needs -o.
+
+#include <lodepng.h>
+#include <lodepng_util.h>
+#include <threadpool.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+// Error codes of the cancel callback, outside the range lodepng uses
+enum { CANNOT_WIN = 1000, OUT_OF_TIME = 1001 };
+
+// One combination of encoder settings
+struct Candidate
+{
+    unsigned color;                  // index into File::colors
+    LodePNGFilterStrategy filter;
+    unsigned windowsize, minmatch, lazymatching, btype;
+};
+
+// A file being optimized, shared by the jobs of its candidates.   The last job to finish writes the result.
+struct File
+{
+    std::string input, output;
+    std::vector<unsigned char> original;
+    std::vector<unsigned char> image;   // RGBA, 8 or 16 bit
+    unsigned w, h, bitdepth;
+    unsigned quantized;                 // palette size of a lossy image, 0 if lossless
+    std::vector<LodePNGColorMode> colors;
+    std::vector<std::string> colorNames;
+    std::vector<Candidate> candidates;
+    double budget;                      // seconds, 0 for no limit
+    std::once_flag started;
+    Clock::time_point deadline;         // set when the first candidate starts, not while the file waits in the queue
+
+    std::atomic<size_t> best;           // the original size until a candidate beats it
+    std::atomic<unsigned> remaining, cancelled, expired;
+    std::mutex mutex;
+    std::vector<unsigned char> png;     // guarded by mutex, empty while nothing beat the original
+    Candidate chosen;
+
+    File() : w(0), h(0), bitdepth(8), quantized(0), budget(0), best(0), remaining(0), cancelled(0), expired(0) {}
+    ~File() { for (size_t i = 0; i < colors.size(); ++i) lodepng_color_mode_cleanup(&colors[i]); }
+};
+
+static const char* filterName(LodePNGFilterStrategy filter)
+{
+    switch (filter) {
+    case LFS_ZERO:        return "LFS_ZERO";
+    case LFS_MINSUM:      return "LFS_MINSUM";
+    case LFS_ENTROPY:     return "LFS_ENTROPY";
+    case LFS_BRUTE_FORCE: return "LFS_BRUTE_FORCE";
+    default:              return "?";
+    }
+}
+
+static const char* colorTypeName(LodePNGColorType type)
+{
+    switch (type) {
+    case LCT_GREY:       return "grey";
+    case LCT_RGB:        return "RGB";
+    case LCT_PALETTE:    return "palette";
+    case LCT_GREY_ALPHA: return "grey+alpha";
+    default:             return "RGBA";
+    }
+}
+
+// Static callback of the encoder after every deflate block: stops a candidate that can no longer win or ran out of time
+static unsigned cancel(size_t outsize, const LodePNGCompressSettings* settings)
+{
+    const File* file = (const File*)settings->custom_context;
+    if (outsize >= file->best.load()) return CANNOT_WIN;
+    if (file->budget > 0 && Clock::now() > file->deadline) return OUT_OF_TIME;
+    return 0;
+}
+
+// Static function to decide the color models to try: whatever auto_convert chooses, and the other one of palette and
+// truecolor when the image allows both
+static void chooseColors(File& f)
+{
+    LodePNGColorMode raw; lodepng_color_mode_init(&raw); raw.colortype = LCT_RGBA; raw.bitdepth = f.bitdepth;
+    LodePNGColorMode automatic; lodepng_color_mode_init(&automatic);
+    LodePNGColorProfile profile; lodepng_color_profile_init(&profile);
+    bool failed = lodepng_auto_choose_color(&automatic, &f.image[0], f.w, f.h, &raw) ||
+                  lodepng_get_color_profile(&profile, &f.image[0], f.w, f.h, &raw);
+    lodepng_color_mode_cleanup(&raw);
+    f.colors.push_back(automatic);
+    f.colorNames.push_back(std::string("auto_convert ") + colorTypeName(automatic.colortype));
+    if (failed) return;
+
+    LodePNGColorMode other; lodepng_color_mode_init(&other);
+    if (automatic.colortype == LCT_PALETTE) {
+        // truecolor or grey at the depth the colors need, with a color key if that covers the transparency
+        other.bitdepth = profile.bits < 8 && profile.colored ? 8 : profile.bits;
+        other.colortype = profile.alpha ? (profile.colored ? LCT_RGBA : LCT_GREY_ALPHA) : (profile.colored ? LCT_RGB : LCT_GREY);
+        if (profile.alpha && other.bitdepth < 8) other.bitdepth = 8;
+        if (profile.key && !profile.alpha) {
+            unsigned mask = (1u << other.bitdepth) - 1u;
+            other.key_defined = 1;
+            other.key_r = profile.key_r & mask; other.key_g = profile.key_g & mask; other.key_b = profile.key_b & mask;
+        }
+        f.colors.push_back(other);
+        f.colorNames.push_back(colorTypeName(other.colortype));
+    } else if (profile.numcolors <= 256 && profile.bits <= 8) {
+        // auto_convert leaves out a palette that only saves little, but the palette can still compress better
+        for (unsigned i = 0; i < profile.numcolors; ++i) {
+            const unsigned char* c = &profile.palette[i * 4];
+            lodepng_palette_add(&other, c[0], c[1], c[2], c[3]);
+        }
+        unsigned n = profile.numcolors;
+        other.colortype = LCT_PALETTE;
+        other.bitdepth = n <= 2 ? 1 : (n <= 4 ? 2 : (n <= 16 ? 4 : 8));
+        f.colors.push_back(other);
+        f.colorNames.push_back("palette");
+    } else {
+        lodepng_color_mode_cleanup(&other);
+    }
+}
+
+// Static function to list the candidates, those that are fast and usually good first, so the best size drops early and
+// cancels more of the others.   Brute force filtering compresses every row five times, so it goes last.
+static void listCandidates(File& f)
+{
+    static const LodePNGFilterStrategy filters[] = { LFS_MINSUM, LFS_ENTROPY, LFS_ZERO, LFS_BRUTE_FORCE };
+    // window, min match, lazy: min match 6 is similar to zlib's Z_FILTERED, a smaller window sometimes parses better
+    static const unsigned deflates[][3] = { { 32768, 3, 1 }, { 32768, 6, 1 }, { 32768, 3, 0 }, { 8192, 3, 1 } };
+    for (unsigned i = 0; i < sizeof(filters) / sizeof(filters[0]); ++i)
+        for (unsigned j = 0; j < sizeof(deflates) / sizeof(deflates[0]); ++j)
+            for (unsigned c = 0; c < f.colors.size(); ++c)
+                for (unsigned btype = 2; btype >= 1; --btype) {
+                    // the fixed huffman code only pays off when the tree would be a large part of the file
+                    if (btype == 1 && f.original.size() > 4096) continue;
+                    Candidate cand = { c, filters[i], deflates[j][0], deflates[j][1], deflates[j][2], btype };
+                    f.candidates.push_back(cand);
+                }
+}
+
+static std::mutex openMutex;
+static std::condition_variable openChanged;
+static unsigned openFiles = 0;
+static size_t totalBefore = 0, totalAfter = 0;
+
+// Static function to write the best result of a file once all its candidates are done, after checking it decodes to
+// the same pixels
+static void finish(File& f)
+{
+    size_t before = f.original.size();
+    unsigned tried = (unsigned)f.candidates.size() - f.expired, cancelled = f.cancelled;
+
+    std::string verdict;
+    if (!f.png.empty()) {
+        std::vector<unsigned char> check; unsigned w = 0, h = 0;
+        if (lodepng::decode(check, w, h, f.png, LCT_RGBA, f.bitdepth) || check != f.image) {
+            verdict = "result doesn't match the original, kept the original";
+            f.png.clear();
+        }
+    }
+
+    // with -o the original is copied when nothing beat it, so the output directory is complete
+    const std::vector<unsigned char>& result = f.png.empty() ? f.original : f.png;
+    bool write = !f.output.empty() || !f.png.empty();
+    if (write && lodepng::save_file(result, f.output.empty() ? f.input : f.output)) {
+        printf("%s: error: cannot write %s\n", f.input.c_str(), (f.output.empty() ? f.input : f.output).c_str());
+        verdict = "not written";
+    }
+
+    std::lock_guard<std::mutex> lock(openMutex);
+    if (verdict.empty() && f.png.empty()) verdict = "no smaller encoding found";
+    if (verdict.empty()) {
+        const Candidate& c = f.chosen;
+        char lossy[48] = "";
+        if (f.quantized) sprintf(lossy, "quantized to %u colors, ", f.quantized);
+        printf("%s: %u -> %u bytes (%.1f%%), %s%s, %s, window %u, min match %u, %s, btype %u; %u of %u tried, %u cancelled%s\n",
+            f.input.c_str(), (unsigned)before, (unsigned)f.png.size(), 100.0 * ((double)f.png.size() - before) / before,
+            lossy, f.colorNames[c.color].c_str(), filterName(c.filter), c.windowsize, c.minmatch, c.lazymatching ? "lazy" : "greedy",
+            c.btype, tried, (unsigned)f.candidates.size(), cancelled, f.expired ? ", out of time" : "");
+    } else {
+        printf("%s: %u bytes, %s; %u of %u tried, %u cancelled%s\n", f.input.c_str(), (unsigned)before, verdict.c_str(),
+            tried, (unsigned)f.candidates.size(), cancelled, f.expired ? ", out of time" : "");
+    }
+    fflush(stdout);
+    totalBefore += before;
+    totalAfter += f.png.empty() ? before : f.png.size();
+    --openFiles;
+    openChanged.notify_all();
+}
+
+// Static function to encode one candidate and keep it if it is the smallest so far
+static void encode(const std::shared_ptr<File>& file, size_t index)
+{
+    File& f = *file;
+    const Candidate& c = f.candidates[index];
+    std::call_once(f.started, [&f] { f.deadline = Clock::now() + std::chrono::microseconds((long long)(f.budget * 1e6)); });
+    if (f.budget > 0 && Clock::now() > f.deadline) {
+        ++f.expired;
+    } else {
+        lodepng::State state;
+        state.info_raw.colortype = LCT_RGBA;
+        state.info_raw.bitdepth = f.bitdepth;
+        lodepng_color_mode_copy(&state.info_png.color, &f.colors[c.color]);
+        state.encoder.auto_convert = c.color == 0;
+        state.encoder.filter_palette_zero = 0;
+        state.encoder.filter_strategy = c.filter;
+        state.encoder.add_id = 0;
+        state.encoder.zlibsettings.btype = c.btype;
+        state.encoder.zlibsettings.windowsize = c.windowsize;
+        state.encoder.zlibsettings.minmatch = c.minmatch;
+        state.encoder.zlibsettings.nicematch = 258;
+        state.encoder.zlibsettings.lazymatching = c.lazymatching;
+        state.encoder.zlibsettings.cancel = cancel;
+        state.encoder.zlibsettings.custom_context = &f;
+
+        std::vector<unsigned char> png;
+        unsigned error = lodepng::encode(png, f.image, f.w, f.h, state);
+        if (error == CANNOT_WIN) {
+            ++f.cancelled;
+        } else if (error == OUT_OF_TIME) {
+            ++f.expired;
+        } else if (error) {
+            printf("%s: encoder error %u: %s\n", f.input.c_str(), error, lodepng_error_text(error));
+        } else if (png.size() < f.best.load()) {
+            std::lock_guard<std::mutex> lock(f.mutex);
+            if (png.size() < f.best.load()) {
+                f.best = png.size();
+                f.png.swap(png);
+                f.chosen = c;
+            }
+        }
+    }
+    if (--f.remaining == 0) finish(f);
+}
+
+// Static function for QuantizeSettings::custom_parallel: runs the quantizer's tasks on the pool and waits for them.
+// Only called from the main thread, so the workers are free to run the tasks.
+static void runOnPool(void (*task)(void*, size_t), void* context, size_t count, const lodepng::QuantizeSettings* settings)
+{
+    ThreadPool& pool = *(ThreadPool*)settings->custom_context;
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t left = count;
+    for (size_t i = 0; i < count; ++i) {
+        pool.submit([&, i] {
+            task(context, i);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--left == 0) done.notify_all();
+        });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    while (left) done.wait(lock);
+}
+
+// Static function to load and decode a file, quantize it if lossy, then queue a job per candidate
+static void prepare(ThreadPool& pool, const std::string& input, const std::string& output, double seconds,
+                    const lodepng::QuantizeSettings* quantize)
+{
+    std::shared_ptr<File> file(new File);
+    File& f = *file;
+    f.input = input; f.output = output;
+    f.budget = seconds;
+
+    lodepng::State state;
+    unsigned error = lodepng::load_file(f.original, input) || f.original.empty() ? 78 : 0;
+    if (!error) error = lodepng_inspect(&f.w, &f.h, &state, &f.original[0], f.original.size());
+    if (!error) {
+        f.bitdepth = state.info_png.color.bitdepth == 16 && !quantize ? 16 : 8;
+        error = lodepng::decode(f.image, f.w, f.h, f.original, LCT_RGBA, f.bitdepth);
+    }
+    if (!error && quantize) {
+        std::vector<unsigned char> palette, indices;
+        error = lodepng::quantize(palette, indices, &f.image[0], f.w, f.h, *quantize);
+        for (size_t i = 0; !error && i < indices.size(); ++i) memcpy(&f.image[i * 4], &palette[indices[i] * 4], 4);
+        f.quantized = (unsigned)palette.size() / 4;
+    }
+    if (error) {
+        std::lock_guard<std::mutex> lock(openMutex);
+        printf("%s: error %u: %s\n", input.c_str(), error, lodepng_error_text(error));
+        --openFiles;
+        openChanged.notify_all();
+        return;
+    }
+
+    f.best = f.original.size();
+    chooseColors(f);
+    listCandidates(f);
+    f.remaining = (unsigned)f.candidates.size();
+    for (size_t i = 0; i < f.candidates.size(); ++i) pool.submit(std::bind(encode, file, i));
+}
+
+static bool hasPNGExtension(const std::string& name)
+{
+    if (name.size() < 4) return false;
+    std::string ext = name.substr(name.size() - 4);
+    for (size_t i = 0; i < ext.size(); ++i) ext[i] = (char)tolower(ext[i]);
+    return ext == ".png";
+}
+
+// Static function to add the *.png files of a directory in sorted order.   Returns false if it isn't a directory.
+static bool listDirectory(const std::string& dir, std::vector<std::string>& files)
+{
+    std::vector<std::string> names;
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA((dir + "\\*").c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE) return false;
+    do {
+        if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && hasPNGExtension(data.cFileName)) names.push_back(data.cFileName);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+#else
+    DIR* d = opendir(dir.c_str());
+    if (!d) return false;
+    while (dirent* entry = readdir(d)) {
+        struct stat st;
+        if (hasPNGExtension(entry->d_name) && !stat((dir + "/" + entry->d_name).c_str(), &st) && S_ISREG(st.st_mode))
+            names.push_back(entry->d_name);
+    }
+    closedir(d);
+#endif
+    std::sort(names.begin(), names.end());
+    for (size_t i = 0; i < names.size(); ++i) files.push_back(dir + "/" + names[i]);
+    return true;
+}
+
+// Main function, program entry.
+int main(int argc, char** argv)
+{
+    unsigned threads = 0;
+    double seconds = 10;
+    std::string outdir;
+    lodepng::QuantizeSettings quantize;
+    bool lossy = false, badColors = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-j") && i + 1 < argc)      threads = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) outdir = argv[++i];
+        else if (!strcmp(argv[i], "-q") && i + 1 < argc) {
+            char* end;
+            unsigned long colors = strtoul(argv[++i], &end, 10);
+            lossy = true;
+            badColors = end == argv[i] || *end || colors < 1 || colors > 256;
+            quantize.max_colors = (unsigned)colors;
+        }
+        else if (!strcmp(argv[i], "-d"))                 quantize.dither = true;
+        else if (!listDirectory(argv[i], files))         files.push_back(argv[i]);
+    }
+    // lossy results are always written to -o, never over the originals
+    if (files.empty() || (lossy && (badColors || outdir.empty()))) {
+        puts("usage: pngoptimize [-j threads] [-t seconds] [-o directory] [-q colors [-d]] input.png|directory ...");
+        puts("  -j  worker threads, default one per hardware thread");
+        puts("  -t  time budget per file in seconds, 0 for none, default 10");
+        puts("  -o  write the results to this directory instead of replacing the inputs that got smaller");
+        puts("  -q  lossy: quantize to a palette of at most this many colors, 1-256, first; needs -o");
+        puts("  -d  dither when quantizing");
+        return 1;
+    }
+
+    Clock::time_point start = Clock::now();
+    {
+        ThreadPool pool(threads);
+        quantize.custom_parallel = runOnPool;
+        quantize.custom_context = &pool;
+        // a few more files open than threads, so the pool stays busy while the last candidates of a file finish
+        unsigned maxOpen = 2 * (unsigned)pool.threads();
+        for (size_t i = 0; i < files.size(); ++i) {
+            {
+                std::unique_lock<std::mutex> lock(openMutex);
+                while (openFiles >= maxOpen) openChanged.wait(lock);
+                ++openFiles;
+            }
+            std::string output;
+            if (!outdir.empty()) {
+                size_t slash = files[i].find_last_of("/\\");
+                output = outdir + "/" + (slash == std::string::npos ? files[i] : files[i].substr(slash + 1));
+            }
+            prepare(pool, files[i], output, seconds, lossy ? &quantize : 0);
+        }
+        pool.wait();
+    }
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%u files: %u -> %u bytes (%.1f%%) in %.1f s\n", (unsigned)files.size(), (unsigned)totalBefore,
+        (unsigned)totalAfter, totalBefore ? 100.0 * ((double)totalAfter - totalBefore) / totalBefore : 0.0, elapsed);
+    return 0;
+}